@@ -25,9 +25,36 @@ var AudioBase = {
   /**
    * default volume
    */
-  DEFAULT_VOLUME: _getNumber('audio.volume.init', 60)
+  DEFAULT_VOLUME: _getNumber('audio.volume.init', 60),
+  /**
+   * the percentage of ducked volumes
+   */
+  DUCK_LEVEL: _getNumber('audio.duck.level', 30),
+  /**
+   * the duration of ducking ramps in milliseconds
+   */
+  DUCK_DURATION: _getNumber('audio.duck.duration', 300)
+}
+
+/**
+ * The percentage of a ducked stream is kept in the in-memory property of
+ * `audio.ducked.<name>`, shared by all processes, so that the volumes set by
+ * any process while ducked are ducked as well.
+ */
+function _duckKey (stream) {
+  return `audio.ducked.${stream.name}`
+}
+
+function _getDuckFactor (stream) {
+  var level = parseInt(property.get(_duckKey(stream)))
+  return isNaN(level) ? null : level / 100
 }
 
+/**
+ * ramp id -> callback
+ */
+var rampCallbacks = {}
+
 function _getNumber (key, defaults) {
   var num = parseInt(manifest.getDefaultValue(key))
   return isNaN(num) ? defaults : num
@@ -36,7 +63,16 @@ function _getNumber (key, defaults) {
 function _storeVolume (stream, vol) {
   vol = Math.floor(vol)
   property.set(stream.key, vol, 'persist')
-  native.setStreamVolume(stream.id, vol)
+  var factor = _getDuckFactor(stream)
+  native.setStreamVolume(stream.id, factor == null ? vol : Math.floor(vol * factor))
+}
+
+function _onRampEnd (id, stream, volume, completed) {
+  var callback = rampCallbacks[id]
+  delete rampCallbacks[id]
+  if (typeof callback === 'function') {
+    callback(completed, volume)
+  }
 }
 
 function _getVolume (stream) {
@@ -244,29 +280,265 @@ AudioManager.setMute = function (val) {
   return native.setMute(!!val)
 }
 
+/**
+ * The streams in the order of their volumes in `getAllVolumes()`.
+ * @memberof module:@yoda/audio~AudioManager
+ * @member {Number[]} VOLUME_STREAMS
+ */
+AudioManager.VOLUME_STREAMS = native.VOLUME_STREAMS
+
+/**
+ * Get the mute state and all volumes of the mixer in one call. The volumes
+ * are cached natively for at most 500ms, and reloaded once the mixer
+ * changes.
+ * @memberof module:@yoda/audio~AudioManager
+ * @method getAllVolumes
+ * @returns {Int32Array} `[muted, media volume, ...stream volumes]`, where the
+ * stream volumes are in the order of `VOLUME_STREAMS`.
+ * @example
+ * var volumes = AudioManager.getAllVolumes()
+ * var idx = AudioManager.VOLUME_STREAMS.indexOf(AudioManager.STREAM_TTS)
+ * volumes[2 + idx] // the volume of tts
+ */
+AudioManager.getAllVolumes = function getAllVolumes () {
+  return native.getAllVolumes()
+}
+
+var volumeChangeListeners = []
+
+/**
+ * Listen on changes of the mute state and volumes of the mixer, made by any
+ * process. Changes of other processes that the volume control library keeps
+ * apart from the mixer controls are not notified.
+ * @memberof module:@yoda/audio~AudioManager
+ * @method addVolumeChangeListener
+ * @param {Function} listener - invoked with the volumes as `getAllVolumes()`.
+ * @returns {Boolean} if the mixer is being watched, otherwise no change
+ * would be notified.
+ */
+AudioManager.addVolumeChangeListener = function addVolumeChangeListener (listener) {
+  if (typeof listener !== 'function') {
+    throw new TypeError('listener must be a function')
+  }
+  volumeChangeListeners.push(listener)
+  return native.setVolumeChangeListener(onVolumeChange)
+}
+
+/**
+ * @memberof module:@yoda/audio~AudioManager
+ * @method removeVolumeChangeListener
+ * @param {Function} listener
+ */
+AudioManager.removeVolumeChangeListener = function removeVolumeChangeListener (listener) {
+  volumeChangeListeners = volumeChangeListeners.filter(it => it !== listener)
+  if (volumeChangeListeners.length === 0) {
+    native.setVolumeChangeListener(null)
+  }
+}
+
+function onVolumeChange (volumes) {
+  volumeChangeListeners.slice().forEach(it => {
+    try {
+      it(volumes)
+    } catch (err) {
+      logger.error('unexpected error on volume change', err.stack)
+    }
+  })
+}
+
+/**
+ * @memberof module:@yoda/audio~AudioManager
+ * @member {Number} RAMP_CURVE_LINEAR - Ramps the volume linearly.
+ */
+AudioManager.RAMP_CURVE_LINEAR = native.RAMP_CURVE_LINEAR
+
+/**
+ * @memberof module:@yoda/audio~AudioManager
+ * @member {Number} RAMP_CURVE_SMOOTH - Ramps the volume slowest at both ends.
+ */
+AudioManager.RAMP_CURVE_SMOOTH = native.RAMP_CURVE_SMOOTH
+
+/**
+ * Ramp the volume of the given stream from the current one, on a native
+ * timer regardless of the event loop. The volume is not persisted. A ramp
+ * replaces the one being played on the stream, and is canceled by
+ * `setVolume()` on the stream.
+ *
+ * @memberof module:@yoda/audio~AudioManager
+ * @method rampVolume
+ * @param {Number} stream - The stream type.
+ * @param {Number} vol - The volume to ramp to.
+ * @param {Number} duration - The duration in milliseconds.
+ * @param {Object} [options]
+ * @param {Number} [options.curve=AudioManager.RAMP_CURVE_SMOOTH]
+ * @param {Function} [callback] - `(completed, volume)`, `completed` is false
+ * if the ramp was canceled or replaced.
+ * @returns {Number} the id of the ramp.
+ * @throws {TypeError} invalid stream type
+ * @throws {RangeError} invalid volume or duration
+ */
+AudioManager.rampVolume = function rampVolume (stream, vol, duration, options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = null
+  }
+  if (!AudioBase[stream]) {
+    throw new TypeError('invalid stream type')
+  }
+  var curve = options && options.curve != null ? options.curve : native.RAMP_CURVE_SMOOTH
+  var id = native.rampStreamVolume(stream, Math.floor(vol), Math.floor(duration), curve)
+  if (id < 0) {
+    throw new RangeError(`invalid ramp, errno ${-id}`)
+  }
+  native.setRampListener(_onRampEnd)
+  rampCallbacks[id] = callback
+  return id
+}
+
+/**
+ * Duck the streams to a percentage of their volumes with ramps, e.g. while a
+ * transient audio focus is held. Volumes set while ducked are ducked as well,
+ * by any process.
+ *
+ * @memberof module:@yoda/audio~AudioManager
+ * @method duck
+ * @param {Object} [options]
+ * @param {Number[]} [options.streams] - defaults to STREAM_AUDIO and
+ * STREAM_PLAYBACK.
+ * @param {Number} [options.level] - the percentage of ducked volumes.
+ * @param {Number} [options.duration] - the duration of ramps.
+ * @param {Function} [callback] - invoked once all ramps ended.
+ */
+AudioManager.duck = function duck (options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = null
+  }
+  options = options || {}
+  var level = options.level == null ? AudioBase.DUCK_LEVEL : options.level
+  var streams = _duckingStreams(options)
+  streams.forEach(it => {
+    property.set(_duckKey(AudioBase[it]), Math.floor(Math.max(0, Math.min(100, level))))
+  })
+  return _rampStreams(streams, options, callback)
+}
+
+/**
+ * Restore the ducked streams to their volumes with ramps.
+ *
+ * @memberof module:@yoda/audio~AudioManager
+ * @method unduck
+ * @param {Object} [options]
+ * @param {Number[]} [options.streams] - defaults to the ducked streams.
+ * @param {Number} [options.duration] - the duration of ramps.
+ * @param {Function} [callback] - invoked once all ramps ended.
+ */
+AudioManager.unduck = function unduck (options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = null
+  }
+  options = options || {}
+  var streams = options.streams || AudioManager.VOLUME_STREAMS.filter(it =>
+    AudioBase[it] != null && _getDuckFactor(AudioBase[it]) != null)
+  streams.forEach(it => {
+    property.set(_duckKey(AudioBase[it]), '')
+  })
+  return _rampStreams(streams, options, callback)
+}
+
+function _duckingStreams (options) {
+  return options.streams || [ native.STREAM_AUDIO, native.STREAM_PLAYBACK ]
+}
+
+function _rampStreams (streams, options, callback) {
+  var duration = options.duration == null ? AudioBase.DUCK_DURATION : options.duration
+  if (streams.length === 0) {
+    if (typeof callback === 'function') {
+      process.nextTick(callback)
+    }
+    return
+  }
+  var pending = streams.length
+  var done = () => {
+    if (--pending === 0 && typeof callback === 'function') {
+      callback()
+    }
+  }
+  streams.forEach(it => {
+    var vol = _getVolume(AudioBase[it])
+    if (vol === false) {
+      vol = AudioBase.DEFAULT_VOLUME
+    }
+    var factor = _getDuckFactor(AudioBase[it])
+    AudioManager.rampVolume(it, factor == null ? vol : Math.floor(vol * factor),
+      duration, done)
+  })
+}
+
 /**
  * Set the shaper of the volume.
  * @memberof module:@yoda/audio~AudioManager
  * @method setVolumeShaper
- * @param {module:@yoda/audio~Shaper} shaper - The volume shaper function which returns an array with 100 elements.
- * @throws {Error} shaper function should return an array with 100 elements.
+ * @param {module:@yoda/audio~Shaper} shaper - The volume shaper function which returns an array of the curve from level 0 to 100.
+ * @throws {Error} shaper function should return an array.
  * @throws {RangeError} out of range when set volume shape.
  * @example
  * AudioManager.setVolumeShaper(AudioManager.LINEAR_RAMP)
  */
 AudioManager.setVolumeShaper = function setVolumeShaper (shaper) {
-  var max = 100
-  var shape = shaper(max)
-  if (!Array.isArray(shape)) { throw new Error('shaper function should return an array with 100 elements.') }
-
-  for (var i = 0; i <= max; i++) {
-    if (!native.setCurveForVolume(i, shape[i])) {
-      throw new RangeError('out of range when set volume shape.')
-    }
+  var shape = shaper(100)
+  if (!Array.isArray(shape) && !(shape instanceof Int32Array)) {
+    throw new Error('shaper function should return an array.')
   }
+  AudioManager.setVolumeCurve(shape)
   return true
 }
 
+/**
+ * Set the volume curve at once. The curve is of any length of at least 2
+ * points, which are spread evenly from level 0 to 100 and interpolated
+ * linearly in between.
+ * @memberof module:@yoda/audio~AudioManager
+ * @method setVolumeCurve
+ * @param {Int32Array|Number[]} curve - non-decreasing integers.
+ * @throws {RangeError} malformed curve.
+ * @example
+ * AudioManager.setVolumeCurve([ 0, 20, 60, 100 ])
+ */
+AudioManager.setVolumeCurve = function setVolumeCurve (curve) {
+  if (native.setVolumeCurve(curve) !== 0) {
+    throw new RangeError('out of range when set volume shape.')
+  }
+}
+
+/**
+ * Map the levels of the given stream through a curve, e.g. to switch curves
+ * on audio route changes. The points of the curve are levels from 0 to 100,
+ * spread evenly and interpolated as `setVolumeCurve()`. The current volume
+ * of the stream is applied through the new curve at once. The curve applies
+ * to the volumes of the stream set by any process.
+ * @memberof module:@yoda/audio~AudioManager
+ * @method setStreamVolumeCurve
+ * @param {Number} stream - The stream type.
+ * @param {Int32Array|Number[]|null} curve - null to reset the mapping.
+ * @throws {TypeError} invalid stream type
+ * @throws {RangeError} malformed curve.
+ * @throws {Error} the curves are not writable by the process.
+ */
+AudioManager.setStreamVolumeCurve = function setStreamVolumeCurve (stream, curve) {
+  if (!AudioBase[stream]) {
+    throw new TypeError('invalid stream type')
+  }
+  var r = native.setStreamVolumeCurve(stream, curve == null ? null : curve)
+  if (r === -native.EPERM) {
+    throw new Error('volume curves are not writable by the process.')
+  }
+  if (r !== 0) {
+    throw new RangeError('malformed volume curve.')
+  }
+}
+
 /**
  * Modules that will record playing state
  */
@@ -1,8 +1,518 @@
 #include <node_api.h>
 #include <vol_ctrl/volumecontrol.h>
+#include <alsa/asoundlib.h>
+#include <uv.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <common.h>
 #include <string.h>
+#include <vector>
+
+/**
+ * The streams in the order of their slots in the volume cache.
+ */
+static const rk_stream_type_t kStreams[] = {
+  STREAM_AUDIO, STREAM_TTS,      STREAM_RING,  STREAM_VOICE_CALL,
+  STREAM_ALARM, STREAM_PLAYBACK, STREAM_SYSTEM
+};
+#define STREAM_COUNT (sizeof(kStreams) / sizeof(*kStreams))
+/** `[muted, media volume, volume of each stream]` */
+#define VOLUME_SLOT_MUTED 0
+#define VOLUME_SLOT_MEDIA 1
+#define VOLUME_SLOT_STREAMS 2
+#define VOLUME_SLOTS (VOLUME_SLOT_STREAMS + STREAM_COUNT)
+
+/**
+ * The volumes and mute state are cached as long as the mixer is watched, any
+ * mixer change invalidates the cache. Accessed on the loop thread only.
+ *
+ * The volume control library may keep the stream volumes and the mute state
+ * apart from the mixer controls, in which case the changes made by other
+ * processes raise no mixer event. The cache expires after
+ * `VOLUME_CACHE_TTL_MS` hence, so that those changes are read through the
+ * library soon.
+ */
+#define VOLUME_CACHE_TTL_MS 500
+static int32_t volumes[VOLUME_SLOTS];
+static bool volumes_valid = false;
+static uint64_t volumes_loaded_ns = 0;
+static snd_ctl_t* mixer_ctl = NULL;
+static uv_poll_t mixer_poll;
+static napi_env mixer_env = NULL;
+static napi_ref onchange = NULL;
+/**
+ * Serializes the volume control library between the loop thread and the
+ * ramp thread.
+ */
+static uv_mutex_t rk_mutex;
+
+/** the points of volume curves, for levels from 0 to 100 */
+#define CURVE_POINTS 101
+/**
+ * The curves mapping the levels of each stream to the volumes applied to the
+ * library, shared by all processes through a memory mapped file so that the
+ * levels set by any process are mapped alike. Accessed with `rk_mutex` held
+ * and the file locked by `flock()`, shared to map and exclusive to change
+ * curves.
+ */
+#define STREAM_CURVES_PATH "/var/run/yoda-audio.curves"
+typedef struct {
+  /** non-zero if the stream is mapped through its curve */
+  int32_t mapped[STREAM_COUNT];
+  /**
+   * the latest level set of each stream, reported as long as the library
+   * holds the volume it is mapped to
+   */
+  int32_t levels[STREAM_COUNT];
+  int32_t points[STREAM_COUNT][CURVE_POINTS];
+} StreamCurves;
+static StreamCurves* stream_curves = NULL;
+/** -1 if the curves are local to the process */
+static int stream_curves_fd = -1;
+static bool stream_curves_writable = false;
+
+static int get_stream_slot(rk_stream_type_t type) {
+  for (size_t i = 0; i < STREAM_COUNT; ++i) {
+    if (kStreams[i] == type) {
+      return VOLUME_SLOT_STREAMS + i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Maps the curves shared by all processes. The file is writable by its owner
+ * only, the curves are read-only to processes of other users and local to
+ * the process if the file could not be mapped at all.
+ */
+static void map_stream_curves() {
+  static StreamCurves local_curves;
+  stream_curves = &local_curves;
+  stream_curves_writable = true;
+  int fd = open(STREAM_CURVES_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  bool writable = fd >= 0;
+  if (fd < 0) {
+    fd = open(STREAM_CURVES_PATH, O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      ((size_t)st.st_size < sizeof(StreamCurves) &&
+       (!writable || ftruncate(fd, sizeof(StreamCurves)) != 0))) {
+    close(fd);
+    return;
+  }
+  void* addr = mmap(NULL, sizeof(StreamCurves),
+                    writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                    fd, 0);
+  if (addr == MAP_FAILED) {
+    close(fd);
+    return;
+  }
+  stream_curves = (StreamCurves*)addr;
+  stream_curves_fd = fd;
+  stream_curves_writable = writable;
+}
+
+static void lock_stream_curves(int operation) {
+  if (stream_curves_fd >= 0) {
+    while (flock(stream_curves_fd, operation) != 0 && errno == EINTR) {
+    }
+  }
+}
+
+static void unlock_stream_curves() {
+  if (stream_curves_fd >= 0) {
+    flock(stream_curves_fd, LOCK_UN);
+  }
+}
+
+/**
+ * Maps the level of the stream through its curve and records it as the
+ * latest level, with the curves locked.
+ */
+static int map_stream_level(int idx, int level) {
+  if (!stream_curves->mapped[idx] || level < 0 || level >= CURVE_POINTS) {
+    return level;
+  }
+  if (stream_curves_writable) {
+    stream_curves->levels[idx] = level;
+  }
+  return stream_curves->points[idx][level];
+}
+
+/**
+ * Maps the volume of the library back through the curve of the stream, with
+ * the curves locked: to the latest level set by any process if it still maps
+ * to the volume, otherwise to the lowest level mapped to the volume or above.
+ */
+static int unmap_stream_volume(int idx, int volume) {
+  if (!stream_curves->mapped[idx] || volume < 0) {
+    return volume;
+  }
+  const int32_t* curve = stream_curves->points[idx];
+  int32_t latest = stream_curves->levels[idx];
+  if (latest >= 0 && latest < CURVE_POINTS && curve[latest] == volume) {
+    return latest;
+  }
+  for (int level = 0; level < CURVE_POINTS; ++level) {
+    if (curve[level] >= volume) {
+      return level;
+    }
+  }
+  return CURVE_POINTS - 1;
+}
+
+/**
+ * Sets the level of the stream through its curve, with `rk_mutex` held.
+ */
+static int set_stream_level_locked(rk_stream_type_t type, int level) {
+  int idx = get_stream_slot(type) - VOLUME_SLOT_STREAMS;
+  lock_stream_curves(LOCK_SH);
+  int r = rk_set_stream_volume(type, map_stream_level(idx, level));
+  unlock_stream_curves();
+  return r;
+}
+
+/**
+ * Gets the level of the stream before its curve, with `rk_mutex` held.
+ */
+static int get_stream_level_locked(rk_stream_type_t type) {
+  int idx = get_stream_slot(type) - VOLUME_SLOT_STREAMS;
+  lock_stream_curves(LOCK_SH);
+  int level = unmap_stream_volume(idx, rk_get_stream_volume(type));
+  unlock_stream_curves();
+  return level;
+}
+
+/**
+ * Reads a curve of at least 2 points from an Int32Array or an array of
+ * numbers, and resamples it linearly to `CURVE_POINTS` levels. Returns false
+ * if the curve is malformed, not non-decreasing or out of `[min, max]`.
+ */
+static bool read_curve(napi_env env, napi_value value, int32_t min,
+                       int32_t max, std::vector<int32_t>& out) {
+  std::vector<int32_t> points;
+  bool is_typedarray = false;
+  bool is_array = false;
+  napi_is_typedarray(env, value, &is_typedarray);
+  napi_is_array(env, value, &is_array);
+  if (is_typedarray) {
+    napi_typedarray_type type;
+    size_t length;
+    void* data;
+    if (napi_get_typedarray_info(env, value, &type, &length, &data, NULL,
+                                 NULL) != napi_ok ||
+        type != napi_int32_array) {
+      return false;
+    }
+    points.assign((int32_t*)data, (int32_t*)data + length);
+  } else if (is_array) {
+    uint32_t length;
+    if (napi_get_array_length(env, value, &length) != napi_ok) {
+      return false;
+    }
+    points.resize(length);
+    for (uint32_t i = 0; i < length; ++i) {
+      napi_value it;
+      double point;
+      if (napi_get_element(env, value, i, &it) != napi_ok ||
+          napi_get_value_double(env, it, &point) != napi_ok ||
+          point != (int32_t)point) {
+        return false;
+      }
+      points[i] = (int32_t)point;
+    }
+  } else {
+    return false;
+  }
+
+  if (points.size() < 2) {
+    return false;
+  }
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (points[i] < min || points[i] > max ||
+        (i > 0 && points[i] < points[i - 1])) {
+      return false;
+    }
+  }
+  size_t last = points.size() - 1;
+  out.resize(CURVE_POINTS);
+  for (int level = 0; level < CURVE_POINTS; ++level) {
+    /** the position of the level on the points, in 1/100 */
+    size_t pos = level * last;
+    size_t idx = pos / (CURVE_POINTS - 1);
+    size_t frac = pos % (CURVE_POINTS - 1);
+    int32_t from = points[idx];
+    int32_t to = idx < last ? points[idx + 1] : from;
+    out[level] = from + (int32_t)(((int64_t)to - from) * (int64_t)frac /
+                                  (CURVE_POINTS - 1));
+  }
+  return true;
+}
+
+/**
+ * Reads the volumes through the volume control library, it always reads
+ * through if the mixer is not watched.
+ */
+static const int32_t* load_volumes() {
+  uint64_t now = uv_hrtime();
+  if (volumes_valid &&
+      now - volumes_loaded_ns < VOLUME_CACHE_TTL_MS * 1000000ULL) {
+    return volumes;
+  }
+  uv_mutex_lock(&rk_mutex);
+  volumes[VOLUME_SLOT_MUTED] = rk_is_mute() ? 1 : 0;
+  volumes[VOLUME_SLOT_MEDIA] = rk_get_volume();
+  for (size_t i = 0; i < STREAM_COUNT; ++i) {
+    /** streams with a curve report the levels before mapping */
+    volumes[VOLUME_SLOT_STREAMS + i] = get_stream_level_locked(kStreams[i]);
+  }
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = mixer_ctl != NULL;
+  volumes_loaded_ns = now;
+  return volumes;
+}
+
+static napi_value create_volumes_array(napi_env env, const int32_t* values) {
+  napi_value buffer, array;
+  void* data;
+  NAPI_CALL(env, napi_create_arraybuffer(env, sizeof(volumes), &data,
+                                         &buffer));
+  memcpy(data, values, sizeof(volumes));
+  NAPI_CALL(env, napi_create_typedarray(env, napi_int32_array, VOLUME_SLOTS,
+                                        buffer, 0, &array));
+  return array;
+}
+
+/**
+ * Drains the mixer events, reloads the cache and notifies the listener if
+ * any volume has been changed, by this process or the others.
+ */
+static void OnMixerEvent(uv_poll_t* handle, int status, int events) {
+  snd_ctl_event_t* event;
+  snd_ctl_event_alloca(&event);
+  while (snd_ctl_read(mixer_ctl, event) > 0) {
+  }
+  int32_t prev[VOLUME_SLOTS];
+  memcpy(prev, volumes, sizeof(volumes));
+  bool was_valid = volumes_valid;
+  volumes_valid = false;
+  load_volumes();
+  if (onchange == NULL || (was_valid &&
+                           memcmp(prev, volumes, sizeof(volumes)) == 0)) {
+    return;
+  }
+
+  napi_env env = mixer_env;
+  napi_handle_scope scope;
+  napi_value global, cb, argv[1];
+  NAPI_CALL_RETURN_VOID(env, napi_open_handle_scope(env, &scope));
+  NAPI_CALL_RETURN_VOID(env, napi_get_global(env, &global));
+  NAPI_CALL_RETURN_VOID(env, napi_get_reference_value(env, onchange, &cb));
+  argv[0] = create_volumes_array(env, volumes);
+  if (argv[0] != NULL) {
+    NAPI_CALL_RETURN_VOID(env, napi_make_callback(env, nullptr, global, cb, 1,
+                                                  argv, nullptr));
+  }
+  NAPI_CALL_RETURN_VOID(env, napi_close_handle_scope(env, scope));
+}
+
+/**
+ * Watches the control events of the default card, the cache is disabled if
+ * the mixer could not be watched.
+ */
+static void watch_mixer(napi_env env) {
+  uv_loop_t* loop;
+  struct pollfd pfd;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    return;
+  }
+  if (snd_ctl_open(&mixer_ctl, "default", SND_CTL_NONBLOCK) < 0) {
+    mixer_ctl = NULL;
+    fprintf(stderr, "mixer not available, volumes are not cached\n");
+    return;
+  }
+  if (snd_ctl_subscribe_events(mixer_ctl, 1) < 0 ||
+      snd_ctl_poll_descriptors(mixer_ctl, &pfd, 1) != 1) {
+    snd_ctl_close(mixer_ctl);
+    mixer_ctl = NULL;
+    fprintf(stderr, "mixer events not available, volumes are not cached\n");
+    return;
+  }
+  mixer_env = env;
+  uv_poll_init(loop, &mixer_poll, pfd.fd);
+  uv_poll_start(&mixer_poll, UV_READABLE, OnMixerEvent);
+  /** never keeps the loop alive, the watcher lives as long as the process */
+  uv_unref((uv_handle_t*)&mixer_poll);
+}
+/** the interval of volume steps of the ramps */
+#define RAMP_STEP_MS 10
+#define RAMP_CURVE_LINEAR 0
+/** eases in and out, the volume changes slowest at both ends */
+#define RAMP_CURVE_SMOOTH 1
+
+typedef struct {
+  int32_t id;
+  rk_stream_type_t stream;
+  int from;
+  int to;
+  int current;
+  int curve;
+  uint64_t started_ns;
+  uint64_t duration_ns;
+} VolumeRamp;
+
+typedef struct {
+  int32_t id;
+  int32_t stream;
+  int32_t volume;
+  bool completed;
+} VolumeRampEnd;
+
+/**
+ * Ramps the stream volumes on its own thread, at most one ramp per stream.
+ * Volumes are stepped with `ramp_mutex` held, so that no step of a canceled
+ * ramp is applied once the cancellation returns.
+ */
+static uv_mutex_t ramp_mutex;
+static uv_cond_t ramp_cond;
+static uv_thread_t ramp_thread;
+static uv_async_t ramp_handle;
+static bool ramp_started = false;
+static int32_t next_ramp_id = 1;
+static std::vector<VolumeRamp> ramps;
+static std::vector<VolumeRampEnd> ramp_ended;
+static napi_env ramp_env = NULL;
+static napi_ref onrampend = NULL;
+
+/**
+ * Ends the ramp at `idx`, with `ramp_mutex` held.
+ */
+static void end_ramp(size_t idx, bool completed) {
+  VolumeRamp& ramp = ramps[idx];
+  VolumeRampEnd it = { ramp.id, ramp.stream, ramp.current, completed };
+  ramp_ended.push_back(it);
+  ramps.erase(ramps.begin() + idx);
+  uv_async_send(&ramp_handle);
+}
+
+/**
+ * Cancels the ramp of the stream, with `ramp_mutex` held.
+ */
+static bool cancel_ramp_locked(rk_stream_type_t stream) {
+  for (size_t i = 0; i < ramps.size(); ++i) {
+    if (ramps[i].stream == stream) {
+      end_ramp(i, false);
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool cancel_ramp(rk_stream_type_t stream) {
+  if (!ramp_started) {
+    return false;
+  }
+  uv_mutex_lock(&ramp_mutex);
+  bool r = cancel_ramp_locked(stream);
+  uv_mutex_unlock(&ramp_mutex);
+  return r;
+}
+
+static int ramp_volume_at(const VolumeRamp& ramp, uint64_t now) {
+  if (ramp.duration_ns == 0 || now >= ramp.started_ns + ramp.duration_ns) {
+    return ramp.to;
+  }
+  double t = (double)(now - ramp.started_ns) / ramp.duration_ns;
+  if (ramp.curve == RAMP_CURVE_SMOOTH) {
+    t = t * t * (3 - 2 * t);
+  }
+  double vol = ramp.from + (ramp.to - ramp.from) * t;
+  return (int)(vol + (vol < 0 ? -0.5 : 0.5));
+}
+
+static void RunRamps(void* arg) {
+  uv_mutex_lock(&ramp_mutex);
+  while (true) {
+    while (ramps.empty()) {
+      uv_cond_wait(&ramp_cond, &ramp_mutex);
+    }
+    uint64_t now = uv_hrtime();
+    for (size_t i = 0; i < ramps.size();) {
+      VolumeRamp& ramp = ramps[i];
+      int vol = ramp_volume_at(ramp, now);
+      if (vol != ramp.current) {
+        uv_mutex_lock(&rk_mutex);
+        set_stream_level_locked(ramp.stream, vol);
+        uv_mutex_unlock(&rk_mutex);
+        ramp.current = vol;
+      }
+      if (vol == ramp.to && now >= ramp.started_ns + ramp.duration_ns) {
+        end_ramp(i, true);
+        continue;
+      }
+      ++i;
+    }
+    if (!ramps.empty()) {
+      uv_cond_timedwait(&ramp_cond, &ramp_mutex, RAMP_STEP_MS * 1000000ULL);
+    }
+  }
+  uv_mutex_unlock(&ramp_mutex);
+}
+
+static void OnRampEnd(uv_async_t* handle) {
+  std::vector<VolumeRampEnd> ended;
+  uv_mutex_lock(&ramp_mutex);
+  ended.swap(ramp_ended);
+  uv_mutex_unlock(&ramp_mutex);
+  volumes_valid = false;
+  if (onrampend == NULL) {
+    return;
+  }
+
+  napi_env env = ramp_env;
+  napi_handle_scope scope;
+  napi_value global, cb, argv[4];
+  NAPI_CALL_RETURN_VOID(env, napi_open_handle_scope(env, &scope));
+  NAPI_CALL_RETURN_VOID(env, napi_get_global(env, &global));
+  NAPI_CALL_RETURN_VOID(env, napi_get_reference_value(env, onrampend, &cb));
+  for (auto& it : ended) {
+    NAPI_CALL_RETURN_VOID(env, napi_create_int32(env, it.id, &argv[0]));
+    NAPI_CALL_RETURN_VOID(env, napi_create_int32(env, it.stream, &argv[1]));
+    NAPI_CALL_RETURN_VOID(env, napi_create_int32(env, it.volume, &argv[2]));
+    NAPI_CALL_RETURN_VOID(env, napi_get_boolean(env, it.completed, &argv[3]));
+    NAPI_CALL_RETURN_VOID(env, napi_make_callback(env, nullptr, global, cb, 4,
+                                                  argv, nullptr));
+  }
+  NAPI_CALL_RETURN_VOID(env, napi_close_handle_scope(env, scope));
+}
+
+static int start_ramps(napi_env env) {
+  if (ramp_started) {
+    return 0;
+  }
+  uv_loop_t* loop;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    return -EINVAL;
+  }
+  ramp_env = env;
+  uv_mutex_init(&ramp_mutex);
+  uv_cond_init(&ramp_cond);
+  uv_async_init(loop, &ramp_handle, OnRampEnd);
+  /** never keeps the loop alive, the ramps live as long as the process */
+  uv_unref((uv_handle_t*)&ramp_handle);
+  ramp_started = true;
+  return uv_thread_create(&ramp_thread, RunRamps, NULL);
+}
+
 static inline rk_stream_type_t get_stream_type(int stream) {
   if (stream == STREAM_TTS) {
     return STREAM_TTS;
@@ -23,7 +533,7 @@ static inline rk_stream_type_t get_stream_type(int stream) {
 
 static napi_value IsMuted(napi_env env, napi_callback_info info) {
   napi_value index;
-  if (rk_is_mute()) {
+  if (load_volumes()[VOLUME_SLOT_MUTED]) {
     napi_get_boolean(env, true, &index);
   } else {
     napi_get_boolean(env, false, &index);
@@ -40,7 +550,10 @@ static napi_value SetMute(napi_env env, napi_callback_info info) {
   napi_value argv[1];
   napi_get_cb_info(env, info, &argc, argv, 0, 0);
   napi_get_value_bool(env, argv[0], &index);
+  uv_mutex_lock(&rk_mutex);
   rkSetValue = rk_set_mute(index);
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = false;
   napi_create_int32(env, rkSetValue, &returnVal);
   return returnVal;
 }
@@ -56,18 +569,91 @@ static napi_value SetCurveForVolume(napi_env env, napi_callback_info info) {
   napi_get_cb_info(env, info, &argc, argv, 0, 0);
   napi_get_value_int32(env, argv[0], &level);
   napi_get_value_int32(env, argv[1], &vol);
-  if (level > 100) {
+  if (level < 0 || level > 100) {
     napi_get_boolean(env, false, &returnVal);
     return returnVal;
   }
   curve[level] = vol;
   if (level == 100) {
+    uv_mutex_lock(&rk_mutex);
     rk_setCustomVolumeCurve(sizeof(curve), curve);
+    uv_mutex_unlock(&rk_mutex);
   }
   napi_get_boolean(env, true, &returnVal);
   return returnVal;
 }
 
+/**
+ * number setVolumeCurve(curve), applies a curve of any length from level 0
+ * to 100 at once. Returns 0, or -EINVAL if the curve is malformed.
+ */
+static napi_value SetVolumeCurve(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  napi_value returnVal;
+  std::vector<int32_t> curve;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  if (argc < 1 || !read_curve(env, argv[0], 0, INT32_MAX, curve)) {
+    NAPI_CALL(env, napi_create_int32(env, -EINVAL, &returnVal));
+    return returnVal;
+  }
+  std::vector<int> values(curve.begin(), curve.end());
+  uv_mutex_lock(&rk_mutex);
+  int r = rk_setCustomVolumeCurve(values.size() * sizeof(int), values.data());
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = false;
+  NAPI_CALL(env, napi_create_int32(env, r < 0 ? r : 0, &returnVal));
+  return returnVal;
+}
+
+/**
+ * number setStreamVolumeCurve(stream, curve), maps the levels of the stream
+ * through a curve of any length whose points are levels from 0 to 100, or
+ * resets the mapping if `curve` is null. The latest level of the stream is
+ * applied through the new curve at once, curves apply to the streams of all
+ * processes. Returns 0, -EINVAL if the curve is malformed, or -EPERM if the
+ * curves are read-only to the process.
+ */
+static napi_value SetStreamVolumeCurve(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  napi_value returnVal;
+  napi_valuetype type;
+  int32_t stream;
+  std::vector<int32_t> curve;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  if (argc < 2 || napi_get_value_int32(env, argv[0], &stream) != napi_ok) {
+    NAPI_CALL(env, napi_create_int32(env, -EINVAL, &returnVal));
+    return returnVal;
+  }
+  NAPI_CALL(env, napi_typeof(env, argv[1], &type));
+  if (type != napi_null && type != napi_undefined &&
+      !read_curve(env, argv[1], 0, 100, curve)) {
+    NAPI_CALL(env, napi_create_int32(env, -EINVAL, &returnVal));
+    return returnVal;
+  }
+  if (!stream_curves_writable) {
+    NAPI_CALL(env, napi_create_int32(env, -EPERM, &returnVal));
+    return returnVal;
+  }
+  rk_stream_type_t stream_type = get_stream_type(stream);
+  int idx = get_stream_slot(stream_type) - VOLUME_SLOT_STREAMS;
+  uv_mutex_lock(&rk_mutex);
+  lock_stream_curves(LOCK_EX);
+  int level = unmap_stream_volume(idx, rk_get_stream_volume(stream_type));
+  stream_curves->mapped[idx] = curve.empty() ? 0 : 1;
+  if (!curve.empty()) {
+    memcpy(stream_curves->points[idx], curve.data(),
+           sizeof(stream_curves->points[idx]));
+  }
+  rk_set_stream_volume(stream_type, map_stream_level(idx, level));
+  unlock_stream_curves();
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = false;
+  NAPI_CALL(env, napi_create_int32(env, 0, &returnVal));
+  return returnVal;
+}
+
 static napi_value SetMediaVolume(napi_env env, napi_callback_info info) {
   size_t argc = 1;
   napi_value argv[1];
@@ -75,7 +661,10 @@ static napi_value SetMediaVolume(napi_env env, napi_callback_info info) {
   napi_value returnVal;
   napi_get_cb_info(env, info, &argc, argv, 0, 0);
   napi_get_value_int32(env, 0, &vol);
+  uv_mutex_lock(&rk_mutex);
   rk_set_volume(vol);
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = false;
   napi_get_boolean(env, true, &returnVal);
   return returnVal;
 }
@@ -83,7 +672,7 @@ static napi_value SetMediaVolume(napi_env env, napi_callback_info info) {
 
 static napi_value GetMediaVolume(napi_env env, napi_callback_info info) {
   napi_value returnVal;
-  int vol = rk_get_volume();
+  int vol = load_volumes()[VOLUME_SLOT_MEDIA];
   napi_create_int32(env, vol, &returnVal);
   return returnVal;
 }
@@ -99,7 +688,12 @@ static napi_value SetStreamVolume(napi_env env, napi_callback_info info) {
   napi_get_value_int32(env, argv[0], &stream);
   napi_get_value_int32(env, argv[1], &vol);
   rk_stream_type_t type = get_stream_type(stream);
-  rk_set_stream_volume(type, vol);
+  /** an explicit volume overrides the ramp of the stream */
+  cancel_ramp(type);
+  uv_mutex_lock(&rk_mutex);
+  set_stream_level_locked(type, vol);
+  uv_mutex_unlock(&rk_mutex);
+  volumes_valid = false;
   napi_get_boolean(env, true, &returnVal);
   return returnVal;
 }
@@ -113,7 +707,7 @@ static napi_value GetStreamVolume(napi_env env, napi_callback_info info) {
   napi_get_cb_info(env, info, &argc, argv, 0, 0);
   napi_get_value_int32(env, argv[0], &stream);
   rk_stream_type_t type = get_stream_type(stream);
-  int vol = rk_get_stream_volume(type);
+  int vol = load_volumes()[get_stream_slot(type)];
   napi_create_int32(env, vol, &returnVal);
   return returnVal;
 }
@@ -136,16 +730,135 @@ static napi_value GetStreamPlayingStatus(napi_env env,
   return returnVal;
 }
 
+/**
+ * Int32Array getAllVolumes(), `[muted, media volume, volume of each
+ * stream]` in the order of `VOLUME_STREAMS`.
+ */
+static napi_value GetAllVolumes(napi_env env, napi_callback_info info) {
+  return create_volumes_array(env, load_volumes());
+}
+
+/**
+ * setVolumeChangeListener(listener), the listener is invoked with the
+ * volumes as `getAllVolumes()` once any of them has been changed.
+ */
+static napi_value SetVolumeChangeListener(napi_env env,
+                                          napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  napi_valuetype type;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  if (onchange != NULL) {
+    NAPI_CALL(env, napi_delete_reference(env, onchange));
+    onchange = NULL;
+  }
+  NAPI_CALL(env, napi_typeof(env, argv[0], &type));
+  if (type == napi_function) {
+    NAPI_CALL(env, napi_create_reference(env, argv[0], 1, &onchange));
+  }
+  napi_value watching;
+  NAPI_CALL(env, napi_get_boolean(env, mixer_ctl != NULL, &watching));
+  return watching;
+}
+
+/**
+ * number rampStreamVolume(stream, volume, duration, curve), ramps the
+ * volume of the stream from the current one in `duration` milliseconds. The
+ * ramp being played on the stream is ended as not completed. Returns the id
+ * of the ramp, or a negative errno.
+ */
+static napi_value RampStreamVolume(napi_env env, napi_callback_info info) {
+  size_t argc = 4;
+  napi_value argv[4];
+  int32_t stream, vol, duration, curve;
+  napi_value returnVal;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  if (argc < 4 || napi_get_value_int32(env, argv[0], &stream) != napi_ok ||
+      napi_get_value_int32(env, argv[1], &vol) != napi_ok ||
+      napi_get_value_int32(env, argv[2], &duration) != napi_ok ||
+      napi_get_value_int32(env, argv[3], &curve) != napi_ok ||
+      vol < 0 || vol > 100 || duration < 0) {
+    NAPI_CALL(env, napi_create_int32(env, -EINVAL, &returnVal));
+    return returnVal;
+  }
+  int r = start_ramps(env);
+  if (r != 0) {
+    NAPI_CALL(env, napi_create_int32(env, r, &returnVal));
+    return returnVal;
+  }
+  rk_stream_type_t type = get_stream_type(stream);
+  uv_mutex_lock(&ramp_mutex);
+  cancel_ramp_locked(type);
+  uv_mutex_lock(&rk_mutex);
+  int from = get_stream_level_locked(type);
+  uv_mutex_unlock(&rk_mutex);
+  VolumeRamp ramp = { next_ramp_id++,
+                      type,
+                      from,
+                      vol,
+                      from,
+                      curve,
+                      uv_hrtime(),
+                      (uint64_t)duration * 1000000ULL };
+  ramps.push_back(ramp);
+  uv_cond_signal(&ramp_cond);
+  uv_mutex_unlock(&ramp_mutex);
+  NAPI_CALL(env, napi_create_int32(env, ramp.id, &returnVal));
+  return returnVal;
+}
+
+/**
+ * boolean cancelStreamRamp(stream), the volume is left where the ramp was.
+ */
+static napi_value CancelStreamRamp(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  int32_t stream;
+  napi_value returnVal;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  NAPI_CALL(env, napi_get_value_int32(env, argv[0], &stream));
+  NAPI_CALL(env, napi_get_boolean(env, cancel_ramp(get_stream_type(stream)),
+                                  &returnVal));
+  return returnVal;
+}
+
+/**
+ * setRampListener(listener), the listener is invoked with
+ * `(id, stream, volume, completed)` once a ramp ended.
+ */
+static napi_value SetRampListener(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  napi_valuetype type;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, 0, 0));
+  if (onrampend != NULL) {
+    NAPI_CALL(env, napi_delete_reference(env, onrampend));
+    onrampend = NULL;
+  }
+  NAPI_CALL(env, napi_typeof(env, argv[0], &type));
+  if (type == napi_function) {
+    NAPI_CALL(env, napi_create_reference(env, argv[0], 1, &onrampend));
+  }
+  return nullptr;
+}
+
 static napi_value Init(napi_env env, napi_value exports) {
   napi_property_descriptor desc[] = {
     DECLARE_NAPI_PROPERTY("isMuted", IsMuted),
     DECLARE_NAPI_PROPERTY("setMute", SetMute),
     DECLARE_NAPI_PROPERTY("setCurveForVolume", SetCurveForVolume),
+    DECLARE_NAPI_PROPERTY("setVolumeCurve", SetVolumeCurve),
+    DECLARE_NAPI_PROPERTY("setStreamVolumeCurve", SetStreamVolumeCurve),
     DECLARE_NAPI_PROPERTY("setMediaVolume", SetMediaVolume),
     DECLARE_NAPI_PROPERTY("getMediaVolume", GetMediaVolume),
     DECLARE_NAPI_PROPERTY("setStreamVolume", SetStreamVolume),
     DECLARE_NAPI_PROPERTY("getStreamVolume", GetStreamVolume),
-    DECLARE_NAPI_PROPERTY("getStreamPlayingStatus", GetStreamPlayingStatus)
+    DECLARE_NAPI_PROPERTY("getStreamPlayingStatus", GetStreamPlayingStatus),
+    DECLARE_NAPI_PROPERTY("getAllVolumes", GetAllVolumes),
+    DECLARE_NAPI_PROPERTY("setVolumeChangeListener", SetVolumeChangeListener),
+    DECLARE_NAPI_PROPERTY("rampStreamVolume", RampStreamVolume),
+    DECLARE_NAPI_PROPERTY("cancelStreamRamp", CancelStreamRamp),
+    DECLARE_NAPI_PROPERTY("setRampListener", SetRampListener)
   };
   napi_define_properties(env, exports, sizeof(desc) / sizeof(*desc), desc);
   NAPI_SET_CONSTANT(exports, STREAM_AUDIO);
@@ -155,6 +868,22 @@ static napi_value Init(napi_env env, napi_value exports) {
   NAPI_SET_CONSTANT(exports, STREAM_ALARM);
   NAPI_SET_CONSTANT(exports, STREAM_PLAYBACK);
   NAPI_SET_CONSTANT(exports, STREAM_SYSTEM);
+  NAPI_SET_CONSTANT(exports, RAMP_CURVE_LINEAR);
+  NAPI_SET_CONSTANT(exports, RAMP_CURVE_SMOOTH);
+  NAPI_SET_CONSTANT(exports, EPERM);
+
+  napi_value streams;
+  NAPI_CALL(env, napi_create_array_with_length(env, STREAM_COUNT, &streams));
+  for (size_t i = 0; i < STREAM_COUNT; ++i) {
+    napi_value stream;
+    NAPI_CALL(env, napi_create_int32(env, kStreams[i], &stream));
+    NAPI_CALL(env, napi_set_element(env, streams, i, stream));
+  }
+  NAPI_CALL(env, napi_set_named_property(env, exports, "VOLUME_STREAMS",
+                                         streams));
+  uv_mutex_init(&rk_mutex);
+  map_stream_curves();
+  watch_mixer(env);
   return exports;
 }
 
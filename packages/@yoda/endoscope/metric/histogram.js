@@ -18,6 +18,13 @@ class Histogram extends Metric {
     }
     return this._record(slice.labels, Date.now() - slice.start)
   }
+
+  observe (labels, value) {
+    if (typeof value !== 'number' || value < 0) {
+      return
+    }
+    return this._record(labels, value)
+  }
 }
 
 module.exports = Histogram
@@ -5,8 +5,53 @@
  * @module @yoda/httpsession
  */
 
+var Url = require('url')
+var endoscope = require('@yoda/endoscope')
 var native = require('./httpsession.node')
 
+var requestDurationHistogram = new endoscope.Histogram('yodaos:httpsession:request_duration', [ 'host', 'coalesced' ])
+var dispatchDurationHistogram = new endoscope.Histogram('yodaos:httpsession:dispatch_duration', [ 'host' ])
+var queueDurationHistogram = new endoscope.Histogram('yodaos:httpsession:queue_duration', [ 'host', 'priority' ])
+var phaseDurationHistogram = new endoscope.Histogram('yodaos:httpsession:phase_duration', [ 'host', 'phase' ])
+var transactionCounter = new endoscope.Counter('yodaos:httpsession:transactions', [ 'host', 'reused' ])
+var phases = [ 'dns', 'connect', 'tls', 'firstByte', 'transfer' ]
+
+/**
+ * In-flight interactive requests of the process. Transitions are posted to
+ * `yodaos.httpsession.interactive` as `[ pid, count ]` so that background
+ * traffic of other processes, e.g. the ota download, could yield to them.
+ */
+var interactiveCount = 0
+
+function postInteractive () {
+  var flora = require('@yoda/flora')
+  require('@yoda/flora/disposable').post('yodaos.httpsession.interactive',
+    [ process.pid, interactiveCount ], flora.MSGTYPE_INSTANT)
+}
+
+function instrument (url, options, callback) {
+  var priority = (options && options.priority) || 'normal'
+  return function onResponse (err, resp) {
+    if (priority === 'interactive' && --interactiveCount === 0) {
+      postInteractive()
+    }
+    if (resp && resp.timing) {
+      var host = Url.parse(url).host
+      queueDurationHistogram.observe({ host: host, priority: priority }, resp.timing.queue)
+      requestDurationHistogram.observe({ host: host, coalesced: resp.timing.coalesced }, resp.timing.total)
+      dispatchDurationHistogram.observe({ host: host }, resp.timing.dispatch)
+      if (!resp.timing.coalesced) {
+        /** waiters of a shared transaction would count its phases again */
+        phases.forEach(phase => {
+          phaseDurationHistogram.observe({ host: host, phase: phase }, resp.timing[phase])
+        })
+        transactionCounter.inc({ host: host, reused: resp.timing.reused })
+      }
+    }
+    callback(err, resp)
+  }
+}
+
 /**
  * Send a http request.
  * @function request
@@ -16,13 +61,61 @@ var native = require('./httpsession.node')
  * @param {string} [options.body] - the http body to send.
  * @param {number} [options.timeout] - the timeout in seconds.
  * @param {object} [options.headers] - the http headers.
- * @param {function} [callback] - the callback when request is done.
+ * @param {boolean} [options.coalesce=true] - identical idempotent requests
+ * (GET/HEAD without body) in flight at the same time share one network
+ * transaction, pass `false` to always start a new one.
+ * @param {string} [options.priority='normal'] - the priority class, one of
+ * `interactive`, `normal` and `background`. Queued requests are submitted in
+ * priority order once a slot is available.
+ * @param {function} [callback] - the callback when request is done, the
+ * response carries a `timing` object with `queue` (from issuing to submitting
+ * the transaction), `total` (from issuing to settling the transaction),
+ * `dispatch` (from settling to invoking the callback) in milliseconds, and
+ * `coalesced`. It also carries the phases of the transaction measured by
+ * libcurl in milliseconds: `dns`, `connect`, `tls`, `firstByte` (from the
+ * connection being ready to the first byte) and `transfer`, and `reused` if
+ * a cached connection was reused.
+ * @returns {object} the request handle to be passed to `abort`.
  */
-exports.request = native.request
+exports.request = function request (url, options, callback) {
+  if (typeof options === 'function') {
+    return native.request(url, instrument(url, null, options))
+  }
+  if (typeof callback === 'function') {
+    var handle = native.request(url, options, instrument(url, options, callback))
+    if (options && options.priority === 'interactive' && interactiveCount++ === 0) {
+      postInteractive()
+    }
+    return handle
+  }
+  return native.request.apply(native, arguments)
+}
 
 /**
- * Aborting all requests in current process, it closes `uv_async_t` handles in this library,
- * none of callbacks will be invoked after this.
+ * Aborting a request, its callback would be invoked with a canceled error.
+ * If the request is sharing a transaction with others, only the aborted one
+ * is canceled, and the transaction is canceled once no one is waiting for it.
  * @function abort
+ * @param {object} handle - the handle returned by `request`.
  */
 exports.abort = native.abort
+
+/**
+ * Set the concurrency limits of the request scheduler. Interactive requests
+ * are only bounded by their class limit, the per-host limit applies to the
+ * normal and background requests.
+ * @function setLimits
+ * @param {object} limits
+ * @param {number} [limits.interactive=8] - max running interactive requests.
+ * @param {number} [limits.normal=4] - max running normal requests.
+ * @param {number} [limits.background=1] - max running background requests.
+ * @param {number} [limits.host=4] - max running requests per host.
+ */
+exports.setLimits = native.setLimits
+
+/**
+ * Get the running and pending requests count of each priority class.
+ * @function stats
+ * @returns {object} like `{ interactive: { running, pending, limit }, ... }`.
+ */
+exports.stats = native.stats
@@ -0,0 +1,262 @@
+#include "curlsession.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+/** the longest wait of the session thread without any wake up */
+#define CURL_SESSION_WAIT_MS 1000
+
+CurlSession::Ticket::~Ticket() {
+  if (headerList != nullptr) {
+    curl_slist_free_all(headerList);
+  }
+  if (easy != nullptr) {
+    curl_easy_cleanup(easy);
+  }
+  if (request.releaseBody && request.body != nullptr) {
+    free(request.body);
+  }
+}
+
+CurlSession::CurlSession(long timeout_) {
+  timeout = timeout_;
+}
+
+/**
+ * Starts the session thread on the first request, returns false if libcurl
+ * or the thread is not available.
+ */
+bool CurlSession::start() {
+  if (started) {
+    return true;
+  }
+  curl_global_init(CURL_GLOBAL_ALL);
+  multi = curl_multi_init();
+  wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (multi == nullptr || wakeFd < 0 ||
+      uv_thread_create(&thread, CurlSession::Run, this) != 0) {
+    fprintf(stderr, "httpsession: session thread not available\n");
+    if (multi != nullptr) {
+      curl_multi_cleanup(multi);
+      multi = nullptr;
+    }
+    if (wakeFd >= 0) {
+      close(wakeFd);
+      wakeFd = -1;
+    }
+    return false;
+  }
+  started = true;
+  return true;
+}
+
+void CurlSession::wake() {
+  uint64_t one = 1;
+  ssize_t r = write(wakeFd, &one, sizeof(one));
+  (void)r;
+}
+
+size_t CurlSession::OnWrite(char* data, size_t size, size_t nmemb,
+                            void* arg) {
+  auto ticket = static_cast<Ticket*>(arg);
+  ticket->response.body.append(data, size * nmemb);
+  return size * nmemb;
+}
+
+/**
+ * Collects the headers of the last response, the headers of interim and
+ * redirected responses are discarded by their status lines.
+ */
+size_t CurlSession::OnHeader(char* data, size_t size, size_t nmemb,
+                             void* arg) {
+  auto ticket = static_cast<Ticket*>(arg);
+  size_t length = size * nmemb;
+  string line(data, length);
+  while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+    line.pop_back();
+  }
+  if (line.compare(0, 5, "HTTP/") == 0) {
+    ticket->response.headers.clear();
+    return length;
+  }
+  size_t colon = line.find(':');
+  if (colon == string::npos) {
+    return length;
+  }
+  size_t start = line.find_first_not_of(" \t", colon + 1);
+  ticket->response.headers[line.substr(0, colon)] =
+      start == string::npos ? string() : line.substr(start);
+  return length;
+}
+
+shared_ptr<CurlSession::Ticket> CurlSession::request(Request& req,
+                                                     Listener* listener) {
+  auto ticket = make_shared<Ticket>();
+  ticket->request = req;
+  /** the body is owned by the ticket from now on */
+  req.releaseBody = false;
+  ticket->listener = listener;
+
+  CURL* easy = curl_easy_init();
+  if (!start() || easy == nullptr) {
+    if (easy != nullptr) {
+      curl_easy_cleanup(easy);
+    }
+    ticket->error = CURLE_FAILED_INIT;
+    snprintf(ticket->errorBuffer, sizeof(ticket->errorBuffer), "%s",
+             curl_easy_strerror(CURLE_FAILED_INIT));
+    Response response;
+    listener->onRequestFinished(this, ticket.get(), &response);
+    return ticket;
+  }
+  ticket->easy = easy;
+  const Request& r = ticket->request;
+  curl_easy_setopt(easy, CURLOPT_URL, r.url.c_str());
+  curl_easy_setopt(easy, CURLOPT_PRIVATE, ticket.get());
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(easy, CURLOPT_TIMEOUT, r.timeout > 0 ? r.timeout : timeout);
+  curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, ticket->errorBuffer);
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, CurlSession::OnWrite);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, ticket.get());
+  curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, CurlSession::OnHeader);
+  curl_easy_setopt(easy, CURLOPT_HEADERDATA, ticket.get());
+  if (r.method == "HEAD") {
+    curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+  } else if (r.method == "POST") {
+    curl_easy_setopt(easy, CURLOPT_POST, 1L);
+  } else if (!r.method.empty() && r.method != "GET") {
+    curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, r.method.c_str());
+  }
+  if (r.body != nullptr) {
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, r.body);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, (long)r.length);
+  } else if (r.method == "POST") {
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, 0L);
+  }
+  for (auto it = r.headers.begin(); it != r.headers.end(); ++it) {
+    string header = it->first + ": " + it->second;
+    ticket->headerList = curl_slist_append(ticket->headerList, header.c_str());
+  }
+  if (ticket->headerList != nullptr) {
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, ticket->headerList);
+  }
+
+  {
+    lock_guard<mutex> lock(queueMutex);
+    incoming.push_back(ticket);
+  }
+  wake();
+  return ticket;
+}
+
+void CurlSession::cancel(shared_ptr<Ticket> ticket) {
+  if (!ticket || !started) {
+    return;
+  }
+  {
+    lock_guard<mutex> lock(queueMutex);
+    canceling.push_back(ticket);
+  }
+  wake();
+}
+
+static double phaseMs(double from, double to) {
+  return to > from ? (to - from) * 1000 : 0;
+}
+
+/**
+ * Notifies the listener of a transaction done, with its response and the
+ * phase timings on success.
+ */
+void CurlSession::finish(shared_ptr<Ticket> ticket, CURLcode code) {
+  Response& response = ticket->response;
+  if (code != CURLE_OK) {
+    ticket->error = code;
+    if (ticket->errorBuffer[0] == '\0') {
+      snprintf(ticket->errorBuffer, sizeof(ticket->errorBuffer), "%s",
+               curl_easy_strerror(code));
+    }
+  } else {
+    CURL* easy = ticket->easy;
+    long status = 0;
+    double namelookup = 0, connect = 0, appconnect = 0, starttransfer = 0,
+           total = 0;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME, &namelookup);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME, &connect);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME, &appconnect);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME, &starttransfer);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME, &total);
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &response.timing.connects);
+    response.code = (int)status;
+    /** APPCONNECT is 0 without TLS, the connection is ready once connected */
+    double ready = appconnect > 0 ? appconnect : connect;
+    response.timing.dns = phaseMs(0, namelookup);
+    response.timing.connect = phaseMs(namelookup, connect);
+    response.timing.tls = appconnect > 0 ? phaseMs(connect, appconnect) : 0;
+    response.timing.firstByte = phaseMs(ready, starttransfer);
+    response.timing.transfer = phaseMs(starttransfer, total);
+    response.timing.total = phaseMs(0, total);
+  }
+  ticket->listener->onRequestFinished(this, ticket.get(), &response);
+}
+
+void CurlSession::Run(void* arg) {
+  auto session = static_cast<CurlSession*>(arg);
+  CURLM* multi = session->multi;
+  struct curl_waitfd wakeup = { session->wakeFd, CURL_WAIT_POLLIN, 0 };
+  while (true) {
+    list<shared_ptr<Ticket>> added, canceled;
+    {
+      lock_guard<mutex> lock(session->queueMutex);
+      added.swap(session->incoming);
+      canceled.swap(session->canceling);
+    }
+    for (auto& ticket : added) {
+      session->active[ticket->easy] = ticket;
+      curl_multi_add_handle(multi, ticket->easy);
+    }
+    /** tickets finished already are not notified again */
+    for (auto& ticket : canceled) {
+      auto it = session->active.find(ticket->easy);
+      if (it == session->active.end()) {
+        continue;
+      }
+      curl_multi_remove_handle(multi, ticket->easy);
+      session->active.erase(it);
+      ticket->listener->onRequestCanceled(session, ticket.get());
+    }
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+    CURLMsg* msg;
+    int queued;
+    while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      auto it = session->active.find(msg->easy_handle);
+      if (it == session->active.end()) {
+        continue;
+      }
+      auto ticket = it->second;
+      CURLcode code = msg->data.result;
+      curl_multi_remove_handle(multi, ticket->easy);
+      session->active.erase(it);
+      session->finish(ticket, code);
+    }
+
+    curl_multi_wait(multi, &wakeup, 1, CURL_SESSION_WAIT_MS, nullptr);
+    if (wakeup.revents != 0) {
+      uint64_t count;
+      ssize_t r = read(session->wakeFd, &count, sizeof(count));
+      (void)r;
+      wakeup.revents = 0;
+    }
+  }
+}
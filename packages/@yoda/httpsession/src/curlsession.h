@@ -0,0 +1,126 @@
+#ifndef CURL_SESSION_H
+#define CURL_SESSION_H
+
+#include <curl/curl.h>
+#include <uv.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Runs http transactions on a libcurl multi handle driven by a dedicated
+ * thread. Connections are cached by the multi handle and reused by later
+ * transactions to the same host, and each response carries the timings of
+ * the phases libcurl measured for its transaction.
+ */
+class CurlSession {
+ public:
+  struct Request {
+    std::string url;
+    /** GET if empty */
+    std::string method;
+    char* body = nullptr;
+    size_t length = 0;
+    /** if the body is malloc-ed and owned by the session once submitted */
+    bool releaseBody = false;
+    /** in seconds, the timeout of the session if 0 */
+    long timeout = 0;
+    std::map<std::string, std::string> headers;
+    void* userdata = nullptr;
+  };
+
+  /**
+   * Phase durations in milliseconds, measured by libcurl from
+   * CURLINFO_NAMELOOKUP/CONNECT/APPCONNECT/STARTTRANSFER/TOTAL_TIME.
+   * `connects` is CURLINFO_NUM_CONNECTS, 0 if a cached connection has been
+   * reused.
+   */
+  struct Timing {
+    double dns = 0;
+    double connect = 0;
+    double tls = 0;
+    /** from the connection being ready to the first byte received */
+    double firstByte = 0;
+    /** from the first byte to the last one */
+    double transfer = 0;
+    double total = 0;
+    long connects = 0;
+  };
+
+  struct Response {
+    int code = 0;
+    std::string body;
+    std::map<std::string, std::string> headers;
+    Timing timing;
+  };
+
+  class Ticket;
+
+  class Listener {
+   public:
+    virtual ~Listener() {
+    }
+    /** invoked on the session thread, check `errorCode()` of the ticket */
+    virtual void onRequestFinished(CurlSession* session, Ticket* ticket,
+                                   Response* response) = 0;
+    virtual void onRequestCanceled(CurlSession* session, Ticket* ticket) = 0;
+  };
+
+  class Ticket {
+   public:
+    ~Ticket();
+
+    /** the CURLcode of a failed transaction, 0 on success */
+    int errorCode() const {
+      return error;
+    }
+    const char* errorMessage() const {
+      return errorBuffer[0] ? errorBuffer : nullptr;
+    }
+
+    Request request;
+
+   private:
+    friend class CurlSession;
+    Listener* listener = nullptr;
+    CURL* easy = nullptr;
+    struct curl_slist* headerList = nullptr;
+    Response response;
+    int error = 0;
+    char errorBuffer[CURL_ERROR_SIZE] = { 0 };
+  };
+
+  /** `timeout` in seconds applies to requests without a timeout */
+  explicit CurlSession(long timeout);
+
+  std::shared_ptr<Ticket> request(Request& req, Listener* listener);
+  /** the listener is notified by `onRequestCanceled` unless finished */
+  void cancel(std::shared_ptr<Ticket> ticket);
+
+ private:
+  static void Run(void* arg);
+  static size_t OnWrite(char* data, size_t size, size_t nmemb, void* arg);
+  static size_t OnHeader(char* data, size_t size, size_t nmemb, void* arg);
+
+  bool start();
+  void wake();
+  void finish(std::shared_ptr<Ticket> ticket, CURLcode code);
+
+  long timeout;
+  CURLM* multi = nullptr;
+  /** eventfd waking the session thread from `curl_multi_wait` */
+  int wakeFd = -1;
+  uv_thread_t thread;
+  bool started = false;
+
+  /** guards `incoming` and `canceling` */
+  std::mutex queueMutex;
+  std::list<std::shared_ptr<Ticket>> incoming;
+  std::list<std::shared_ptr<Ticket>> canceling;
+  /** only accessed on the session thread */
+  std::map<CURL*, std::shared_ptr<Ticket>> active;
+};
+
+#endif // CURL_SESSION_H
@@ -1,4 +1,4 @@
-#include <HttpSession.h>
+#include "curlsession.h"
 #include <mutex>
 #include <list>
 #include <common.h>
@@ -8,22 +8,50 @@
 
 using namespace std;
 
-struct HttpSessionAsyncTask {
-  /** initialization fields */
-  napi_env env = nullptr;
-  napi_ref callback = nullptr;
-  uv_async_t async;
+enum HttpSessionPriority {
+  HTTPSESSION_PRIORITY_INTERACTIVE = 0,
+  HTTPSESSION_PRIORITY_NORMAL,
+  HTTPSESSION_PRIORITY_BACKGROUND,
+  HTTPSESSION_PRIORITY_COUNT
+};
+
+static const char* priorityNames[HTTPSESSION_PRIORITY_COUNT] = {
+  "interactive", "normal", "background"
+};
 
-  /** result fields */
+struct HttpSessionResult {
   int code = 0;
   string body;
   int error = 0;
   string errorMessage;
   map<string, string> headers;
+  /** the phases of the transaction measured by libcurl */
+  CurlSession::Timing phases;
+  /** when the transaction is submitted, 0 if it never left the queue */
+  uint64_t startedAt = 0;
+  /** when the transaction is settled, in `uv_hrtime` nanoseconds */
+  uint64_t settledAt = 0;
+};
+
+struct HttpSessionAsyncTask {
+  /** initialization fields */
+  napi_env env = nullptr;
+  napi_ref callback = nullptr;
+  uv_async_t async;
+  /** keeps the task alive until its async handle is closed */
+  shared_ptr<HttpSessionAsyncTask> self;
+  /** when the request is issued, in `uv_hrtime` nanoseconds */
+  uint64_t requestedAt = 0;
+  /** whether the request joined an in-flight transaction */
+  bool coalesced = false;
+
+  /** result fields, guarded by `inflightMutex` until the async is sent */
+  bool settled = false;
+  shared_ptr<HttpSessionResult> result;
 
   static void OnDrop(uv_handle_t* handle) {
     auto task = reinterpret_cast<HttpSessionAsyncTask*>(handle->data);
-    delete task;
+    auto self = std::move(task->self);
   }
 
   void drop() {
@@ -38,50 +66,267 @@ struct HttpSessionAsyncTask {
   }
 };
 
-class NodeHttpSessionRequestListener
-    : public HttpSessionRequestListenerInterface {
+/**
+ * One network transaction. Identical idempotent requests issued while it is
+ * in flight are coalesced into it, each of them is a waiter of the
+ * transaction and gets the result fanned out.
+ */
+struct HttpSessionInflight {
+  /** the coalescing key, empty if the request is not coalescable */
+  string key;
+  /** the request to be submitted, released once it is submitted */
+  unique_ptr<CurlSession::Request> req;
+  string host;
+  int priority = HTTPSESSION_PRIORITY_NORMAL;
+  /** waiting in `pending` for a free slot */
+  bool queued = false;
+  /** submitted to the session and occupying a slot */
+  bool running = false;
+  uint64_t startedAt = 0;
+  shared_ptr<CurlSession::Ticket> ticket;
+  list<shared_ptr<HttpSessionAsyncTask>> waiters;
+  bool done = false;
+  /** keeps the transaction alive until the listener is notified */
+  shared_ptr<HttpSessionInflight> self;
+};
+
+/**
+ * The object wrapped in the value returned by `request`.
+ */
+struct HttpSessionRequestHandle {
+  shared_ptr<HttpSessionInflight> inflight;
+  shared_ptr<HttpSessionAsyncTask> task;
+};
+
+/**
+ * Concurrency limits of the scheduler. Interactive requests are only bounded
+ * by their class limit, so that they are never held back by normal or
+ * background requests to the same host.
+ */
+struct HttpSessionLimits {
+  int perClass[HTTPSESSION_PRIORITY_COUNT] = { 8, 4, 1 };
+  int perHost = 4;
+};
+
+static mutex inflightMutex;
+static map<string, shared_ptr<HttpSessionInflight>> inflights;
+
+/** scheduler states, guarded by `inflightMutex` */
+static HttpSessionLimits limits;
+static list<shared_ptr<HttpSessionInflight>>
+    pending[HTTPSESSION_PRIORITY_COUNT];
+static int running[HTTPSESSION_PRIORITY_COUNT] = { 0 };
+static map<string, int> runningByHost;
+static uv_async_t scheduleAsync;
+static bool scheduleAsyncInitialized = false;
+
+static shared_ptr<HttpSessionResult> canceledResult() {
+  auto result = make_shared<HttpSessionResult>();
+  result->error = -1;
+  result->errorMessage.assign("Request has been canceled.");
+  return result;
+}
+
+static bool hasPending() {
+  for (int i = 0; i < HTTPSESSION_PRIORITY_COUNT; ++i) {
+    if (!pending[i].empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Releases the slot occupied by the transaction, must be called with
+ * `inflightMutex` held.
+ */
+static void releaseSlot(HttpSessionInflight* inflight) {
+  if (!inflight->running) {
+    return;
+  }
+  inflight->running = false;
+  running[inflight->priority]--;
+  auto it = runningByHost.find(inflight->host);
+  if (it != runningByHost.end() && --it->second <= 0) {
+    runningByHost.erase(it);
+  }
+  if (scheduleAsyncInitialized && hasPending()) {
+    uv_async_send(&scheduleAsync);
+  }
+}
+
+static void settleInflight(HttpSessionInflight* inflight,
+                           shared_ptr<HttpSessionResult> result) {
+  shared_ptr<HttpSessionInflight> self;
+  lock_guard<mutex> lock(inflightMutex);
+  result->startedAt = inflight->startedAt;
+  result->settledAt = uv_hrtime();
+  releaseSlot(inflight);
+  inflight->done = true;
+  auto it = inflights.find(inflight->key);
+  if (it != inflights.end() && it->second.get() == inflight) {
+    inflights.erase(it);
+  }
+  for (auto& task : inflight->waiters) {
+    task->settled = true;
+    task->result = result;
+    uv_async_send(&task->async);
+  }
+  inflight->waiters.clear();
+  self = std::move(inflight->self);
+}
+
+class NodeHttpSessionRequestListener : public CurlSession::Listener {
  public:
   // cppcheck-suppress unusedFunction
-  virtual void onRequestFinished(HttpSession* session, HttpSession::Ticket* tic,
-                                 HttpSession::Response* resp) {
-    auto task = static_cast<HttpSessionAsyncTask*>(tic->request.userdata);
-    if (!task) {
+  virtual void onRequestFinished(CurlSession* session, CurlSession::Ticket* tic,
+                                 CurlSession::Response* resp) {
+    auto inflight = static_cast<HttpSessionInflight*>(tic->request.userdata);
+    if (!inflight) {
       return;
     }
 
+    auto result = make_shared<HttpSessionResult>();
     if (tic->errorCode()) {
-      task->error = tic->errorCode();
+      result->error = tic->errorCode();
       if (tic->errorMessage()) {
-        task->errorMessage.assign(tic->errorMessage());
+        result->errorMessage.assign(tic->errorMessage());
       }
     } else {
-      task->code = resp->code;
-      if (resp->body) {
-        task->body.assign(resp->body, resp->contentLength);
-      }
-      task->headers = resp->headers;
+      result->code = resp->code;
+      result->body.swap(resp->body);
+      result->headers.swap(resp->headers);
+      result->phases = resp->timing;
     }
-
-    uv_async_send(&task->async);
+    settleInflight(inflight, result);
   }
 
   // cppcheck-suppress unusedFunction
-  virtual void onRequestCanceled(HttpSession* session,
-                                 HttpSession::Ticket* tic) {
-    auto task = static_cast<HttpSessionAsyncTask*>(tic->request.userdata);
-    if (!task) {
+  virtual void onRequestCanceled(CurlSession* session,
+                                 CurlSession::Ticket* tic) {
+    auto inflight = static_cast<HttpSessionInflight*>(tic->request.userdata);
+    if (!inflight) {
       return;
     }
-    task->error = -1;
-    char errMsg[] = "Request has been canceled.";
-    task->errorMessage.assign(errMsg, sizeof(errMsg) / sizeof(char));
-    uv_async_send(&task->async);
+    settleInflight(inflight, canceledResult());
   }
 };
 
-static HttpSession* session = new HttpSession({ "", 60, true });
+static CurlSession* session = new CurlSession(60);
 static NodeHttpSessionRequestListener listener;
 
+static void submitInflight(shared_ptr<HttpSessionInflight> inflight) {
+  inflight->req->userdata = inflight.get();
+  auto ticket = session->request(*inflight->req, &listener);
+  lock_guard<mutex> lock(inflightMutex);
+  inflight->req.reset();
+  if (!inflight->done) {
+    inflight->ticket = ticket;
+  }
+}
+
+/**
+ * Submits queued transactions in priority order as long as slots are
+ * available, an interactive request therefore always goes ahead of queued
+ * normal and background requests.
+ */
+static void schedule() {
+  list<shared_ptr<HttpSessionInflight>> ready;
+  {
+    lock_guard<mutex> lock(inflightMutex);
+    for (int i = 0; i < HTTPSESSION_PRIORITY_COUNT; ++i) {
+      auto it = pending[i].begin();
+      while (it != pending[i].end() && running[i] < limits.perClass[i]) {
+        auto inflight = *it;
+        auto host = runningByHost.find(inflight->host);
+        if (i != HTTPSESSION_PRIORITY_INTERACTIVE &&
+            host != runningByHost.end() && host->second >= limits.perHost) {
+          ++it;
+          continue;
+        }
+        it = pending[i].erase(it);
+        inflight->queued = false;
+        inflight->running = true;
+        inflight->startedAt = uv_hrtime();
+        running[i]++;
+        runningByHost[inflight->host]++;
+        ready.push_back(inflight);
+      }
+    }
+  }
+  for (auto& inflight : ready) {
+    submitInflight(inflight);
+  }
+}
+
+static void onSchedule(uv_async_t* handle) {
+  schedule();
+}
+
+static string hostOf(const string& url) {
+  size_t start = url.find("://");
+  start = start == string::npos ? 0 : start + 3;
+  size_t end = url.find_first_of("/?#", start);
+  return url.substr(start, end == string::npos ? string::npos : end - start);
+}
+
+static double elapsedMs(uint64_t from, uint64_t to) {
+  return to > from ? (to - from) / 1e6 : 0;
+}
+
+/**
+ * Builds the timing object of a response, durations are in milliseconds:
+ * - `queue`: from the request being issued to the transaction being
+ *   submitted to the session.
+ * - `total`: from the request being issued to the transaction being settled.
+ * - `dispatch`: from the transaction being settled to the callback being
+ *   invoked on the event loop.
+ * - `coalesced`: if the request joined an in-flight transaction.
+ * - `dns`, `connect`, `tls`, `firstByte` and `transfer`: the phases of the
+ *   transaction measured by libcurl, `tls` is 0 for plain http and the
+ *   connection phases are 0 if a cached connection has been reused.
+ * - `reused`: if the transaction reused a cached connection.
+ */
+static napi_value createTiming(napi_env env, HttpSessionAsyncTask* task) {
+  napi_value timing, value;
+  uint64_t now = uv_hrtime();
+  uint64_t startedAt = task->result->startedAt;
+  uint64_t settledAt = task->result->settledAt;
+
+  NAPI_CALL(env, napi_create_object(env, &timing));
+  NAPI_CALL(env, napi_create_double(env,
+                                    elapsedMs(task->requestedAt,
+                                              startedAt ? startedAt
+                                                        : settledAt),
+                                    &value));
+  NAPI_CALL(env, napi_set_named_property(env, timing, "queue", value));
+  NAPI_CALL(env, napi_create_double(env,
+                                    elapsedMs(task->requestedAt, settledAt),
+                                    &value));
+  NAPI_CALL(env, napi_set_named_property(env, timing, "total", value));
+  NAPI_CALL(env, napi_create_double(env, elapsedMs(settledAt, now), &value));
+  NAPI_CALL(env, napi_set_named_property(env, timing, "dispatch", value));
+  NAPI_CALL(env, napi_get_boolean(env, task->coalesced, &value));
+  NAPI_CALL(env, napi_set_named_property(env, timing, "coalesced", value));
+
+  const CurlSession::Timing& phases = task->result->phases;
+  const struct {
+    const char* name;
+    double value;
+  } durations[] = { { "dns", phases.dns },
+                    { "connect", phases.connect },
+                    { "tls", phases.tls },
+                    { "firstByte", phases.firstByte },
+                    { "transfer", phases.transfer } };
+  for (auto& it : durations) {
+    NAPI_CALL(env, napi_create_double(env, it.value, &value));
+    NAPI_CALL(env, napi_set_named_property(env, timing, it.name, value));
+  }
+  NAPI_CALL(env, napi_get_boolean(env, phases.connects == 0, &value));
+  NAPI_CALL(env, napi_set_named_property(env, timing, "reused", value));
+  return timing;
+}
+
 static void handleFinishedTickets(uv_async_t* handle) {
   auto task = static_cast<HttpSessionAsyncTask*>(handle->data);
   if (!task) {
@@ -96,10 +341,11 @@ static void handleFinishedTickets(uv_async_t* handle) {
 
   env = task->env;
 
-  int error = task->error;
-  int code = task->code;
-  string* message = &task->errorMessage;
-  string* body = &task->body;
+  auto result = task->result;
+  int error = result->error;
+  int code = result->code;
+  const string* message = &result->errorMessage;
+  const string* body = &result->body;
 
   NAPI_CALL_RETURN_VOID(env, napi_open_handle_scope(env, &scope));
   NAPI_CALL_RETURN_VOID(env,
@@ -144,7 +390,8 @@ static void handleFinishedTickets(uv_async_t* handle) {
     NAPI_CALL_RETURN_VOID(env, napi_set_property(env, argv[1], key, value));
 
     NAPI_CALL_RETURN_VOID(env, napi_create_object(env, &headersObj));
-    for (auto ite = task->headers.begin(); ite != task->headers.end(); ++ite) {
+    for (auto ite = result->headers.begin(); ite != result->headers.end();
+         ++ite) {
       NAPI_CALL_RETURN_VOID(env,
                             napi_create_string_utf8(env, ite->first.c_str(),
                                                     ite->first.size(), &key));
@@ -160,6 +407,13 @@ static void handleFinishedTickets(uv_async_t* handle) {
                                                        NAPI_AUTO_LENGTH, &key));
     NAPI_CALL_RETURN_VOID(env,
                           napi_set_property(env, argv[1], key, headersObj));
+
+    NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(env, "timing",
+                                                       NAPI_AUTO_LENGTH, &key));
+    if ((value = createTiming(env, task)) == nullptr) {
+      return;
+    }
+    NAPI_CALL_RETURN_VOID(env, napi_set_property(env, argv[1], key, value));
   }
 
   NAPI_CALL_RETURN_VOID(env, napi_make_callback(env, ctx, recv, cb, argc, argv,
@@ -194,8 +448,8 @@ static int appendHeaders(map<string, string>& target, napi_env env,
   return appended;
 }
 
-static bool buildRequest(HttpSession::Request& req, napi_env env,
-                         napi_value options) {
+static bool buildRequest(CurlSession::Request& req, bool& coalesce,
+                         int& priority, napi_env env, napi_value options) {
   napi_value value;
 
   value = NAPI_GET_PROPERTY(env, options, "body", nullptr, napi_string);
@@ -224,14 +478,58 @@ static bool buildRequest(HttpSession::Request& req, napi_env env,
     return false;
   }
 
+  value = NAPI_GET_PROPERTY(env, options, "coalesce", nullptr, napi_boolean);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_bool(env, value, &coalesce), false);
+  }
+
+  value = NAPI_GET_PROPERTY(env, options, "priority", nullptr, napi_string);
+  if (value) {
+    string name;
+    NAPI_ASSIGN_STD_STRING(env, name, value);
+    for (priority = 0; priority < HTTPSESSION_PRIORITY_COUNT; ++priority) {
+      if (name == priorityNames[priority]) {
+        break;
+      }
+    }
+    if (priority == HTTPSESSION_PRIORITY_COUNT) {
+      return false;
+    }
+  }
+
   return true;
 }
 
-static void finalizeRequestTicket(napi_env env, void* finalize_data,
+/**
+ * Only idempotent requests without a body could share a transaction, the key
+ * is built from the method, the url, the timeout and the headers, so that a
+ * request never waits on a transaction with a longer timeout.
+ */
+static string coalescingKey(const CurlSession::Request& req) {
+  string key;
+  if (req.body != nullptr ||
+      !(req.method.empty() || req.method == "GET" || req.method == "HEAD")) {
+    return key;
+  }
+  key.append(req.method.empty() ? "GET" : req.method);
+  key.append(" ");
+  key.append(req.url);
+  char timeout[32];
+  snprintf(timeout, sizeof(timeout), " %ld", (long)req.timeout);
+  key.append(timeout);
+  for (auto ite = req.headers.begin(); ite != req.headers.end(); ++ite) {
+    key.append("\n");
+    key.append(ite->first);
+    key.append(": ");
+    key.append(ite->second);
+  }
+  return key;
+}
+
+static void finalizeRequestHandle(napi_env env, void* finalize_data,
                                   void* finalize_hint) {
-  auto acq_ticket =
-      static_cast<shared_ptr<HttpSession::Ticket>*>(finalize_data);
-  delete acq_ticket;
+  auto handle = static_cast<HttpSessionRequestHandle*>(finalize_data);
+  delete handle;
 }
 
 static napi_value abort(napi_env env, napi_callback_info info) {
@@ -249,8 +547,48 @@ static napi_value abort(napi_env env, napi_callback_info info) {
   if (wrapped == nullptr) {
     return nullptr;
   }
-  auto acq_ticket = static_cast<shared_ptr<HttpSession::Ticket>*>(wrapped);
-  session->cancel(*acq_ticket);
+  auto handle = static_cast<HttpSessionRequestHandle*>(wrapped);
+  auto inflight = handle->inflight;
+  auto task = handle->task;
+
+  shared_ptr<CurlSession::Ticket> ticket;
+  {
+    lock_guard<mutex> lock(inflightMutex);
+    if (task) {
+      if (task->settled) {
+        return nullptr;
+      }
+      /**
+       * Aborting a waiter only settles the waiter itself, the shared
+       * transaction is canceled once no one is waiting for it.
+       */
+      inflight->waiters.remove(task);
+      task->settled = true;
+      task->result = canceledResult();
+      task->result->startedAt = inflight->startedAt;
+      task->result->settledAt = uv_hrtime();
+      uv_async_send(&task->async);
+      if (!inflight->waiters.empty()) {
+        return nullptr;
+      }
+      auto it = inflights.find(inflight->key);
+      if (it != inflights.end() && it->second == inflight) {
+        inflights.erase(it);
+      }
+    }
+    if (inflight->queued) {
+      /** never submitted, no one would settle it but us */
+      pending[inflight->priority].remove(inflight);
+      inflight->queued = false;
+      inflight->done = true;
+      inflight->self.reset();
+    } else if (!inflight->done) {
+      ticket = inflight->ticket;
+    }
+  }
+  if (ticket) {
+    session->cancel(ticket);
+  }
 
   return nullptr;
 }
@@ -265,7 +603,9 @@ static napi_value request(napi_env env, napi_callback_info info) {
     return nullptr;
   }
 
-  HttpSession::Request req;
+  unique_ptr<CurlSession::Request> req(new CurlSession::Request());
+  bool coalesce = true;
+  int priority = HTTPSESSION_PRIORITY_NORMAL;
 
   napi_valuetype type;
   napi_value value;
@@ -282,7 +622,7 @@ static napi_value request(napi_env env, napi_callback_info info) {
                                      "Argument type error, expect a string."));
           return nullptr;
         }
-        if (!NAPI_ASSIGN_STD_STRING(env, req.url, value)) {
+        if (!NAPI_ASSIGN_STD_STRING(env, req->url, value)) {
           NAPI_CALL(env, napi_throw_error(env, nullptr, "Get URL failed"));
           return nullptr;
         }
@@ -298,7 +638,7 @@ static napi_value request(napi_env env, napi_callback_info info) {
                                      "Argument type error, expect an object."));
           return nullptr;
         }
-        if (!buildRequest(req, env, value)) {
+        if (!buildRequest(*req, coalesce, priority, env, value)) {
           NAPI_CALL(env,
                     napi_throw_error(env, nullptr, "Build request failed"));
           return nullptr;
@@ -318,34 +658,137 @@ static napi_value request(napi_env env, napi_callback_info info) {
     }
   }
 
-  if (callback) {
-    uv_loop_t* loop;
-    NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+  uv_loop_t* loop;
+  NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+  if (!scheduleAsyncInitialized) {
+    uv_async_init(loop, &scheduleAsync, onSchedule);
+    uv_unref(reinterpret_cast<uv_handle_t*>(&scheduleAsync));
+    scheduleAsyncInitialized = true;
+  }
 
-    auto task = new HttpSessionAsyncTask();
+  auto handle = new HttpSessionRequestHandle();
+  if (callback) {
+    auto task = make_shared<HttpSessionAsyncTask>();
     task->env = env;
     task->callback = callback;
-    task->async.data = task;
-    req.userdata = task;
+    task->async.data = task.get();
+    task->self = task;
+    task->requestedAt = uv_hrtime();
     uv_async_init(loop, &task->async, handleFinishedTickets);
+    handle->task = task;
   }
-  auto ticket = session->request(req, &listener);
-  shared_ptr<HttpSession::Ticket>* acq_ticket =
-      new shared_ptr<HttpSession::Ticket>(ticket);
+
+  /**
+   * Requests without a callback are fire-and-forget, and neither start nor
+   * join a shared transaction.
+   */
+  string key;
+  if (coalesce && handle->task) {
+    key = coalescingKey(*req);
+  }
+
+  {
+    lock_guard<mutex> lock(inflightMutex);
+    auto it = key.empty() ? inflights.end() : inflights.find(key);
+    if (it != inflights.end()) {
+      auto inflight = it->second;
+      inflight->waiters.push_back(handle->task);
+      handle->task->coalesced = true;
+      if (inflight->queued && priority < inflight->priority) {
+        /** promotes the queued transaction to the joiner's priority */
+        pending[inflight->priority].remove(inflight);
+        inflight->priority = priority;
+        pending[priority].push_back(inflight);
+      }
+      handle->inflight = inflight;
+    } else {
+      auto inflight = make_shared<HttpSessionInflight>();
+      inflight->key = key;
+      inflight->host = hostOf(req->url);
+      inflight->priority = priority;
+      inflight->req = std::move(req);
+      inflight->self = inflight;
+      if (handle->task) {
+        inflight->waiters.push_back(handle->task);
+      }
+      if (!key.empty()) {
+        inflights[key] = inflight;
+      }
+      inflight->queued = true;
+      pending[priority].push_back(inflight);
+      handle->inflight = inflight;
+    }
+  }
+  schedule();
 
   napi_value nval_ret;
   napi_ref weak_ref;
   NAPI_CALL(env, napi_create_object(env, &nval_ret));
-  NAPI_CALL(env, napi_wrap(env, nval_ret, static_cast<void*>(acq_ticket),
-                           finalizeRequestTicket, nullptr, &weak_ref));
+  NAPI_CALL(env, napi_wrap(env, nval_ret, static_cast<void*>(handle),
+                           finalizeRequestHandle, nullptr, &weak_ref));
 
   return nval_ret;
 }
 
+static napi_value setLimits(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[argc];
+
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+  if (argc != 1) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr, "Wrong arguments number"));
+    return nullptr;
+  }
+
+  napi_value value;
+  int32_t limit;
+  {
+    lock_guard<mutex> lock(inflightMutex);
+    for (int i = 0; i < HTTPSESSION_PRIORITY_COUNT; ++i) {
+      value = NAPI_GET_PROPERTY(env, argv[0], priorityNames[i], nullptr,
+                                napi_number);
+      if (value && napi_get_value_int32(env, value, &limit) == napi_ok &&
+          limit > 0) {
+        limits.perClass[i] = limit;
+      }
+    }
+    value = NAPI_GET_PROPERTY(env, argv[0], "host", nullptr, napi_number);
+    if (value && napi_get_value_int32(env, value, &limit) == napi_ok &&
+        limit > 0) {
+      limits.perHost = limit;
+    }
+  }
+  /** raised limits could unblock queued requests */
+  schedule();
+
+  return nullptr;
+}
+
+static napi_value stats(napi_env env, napi_callback_info info) {
+  napi_value result, klass, value;
+  NAPI_CALL(env, napi_create_object(env, &result));
+
+  lock_guard<mutex> lock(inflightMutex);
+  for (int i = 0; i < HTTPSESSION_PRIORITY_COUNT; ++i) {
+    NAPI_CALL(env, napi_create_object(env, &klass));
+    NAPI_CALL(env, napi_create_int32(env, running[i], &value));
+    NAPI_CALL(env, napi_set_named_property(env, klass, "running", value));
+    NAPI_CALL(env, napi_create_int32(env, pending[i].size(), &value));
+    NAPI_CALL(env, napi_set_named_property(env, klass, "pending", value));
+    NAPI_CALL(env, napi_create_int32(env, limits.perClass[i], &value));
+    NAPI_CALL(env, napi_set_named_property(env, klass, "limit", value));
+    NAPI_CALL(env,
+              napi_set_named_property(env, result, priorityNames[i], klass));
+  }
+  return result;
+}
+
 static napi_value Init(napi_env env, napi_value exports) {
   napi_property_descriptor desc[] = {
     DECLARE_NAPI_PROPERTY("abort", abort),
     DECLARE_NAPI_PROPERTY("request", request),
+    DECLARE_NAPI_PROPERTY("setLimits", setLimits),
+    DECLARE_NAPI_PROPERTY("stats", stats),
   };
   size_t property_count = sizeof(desc) / sizeof(*desc);
   NAPI_CALL(env, napi_define_properties(env, exports, property_count, desc));
@@ -7,9 +7,20 @@
  * we support `keyup`, `keydown` and `longpress` events.
  */
 
-var InputWrap = require('./input.node').InputWrap
+var InputWrap
+try {
+  InputWrap = require('./input.node').InputWrap
+} catch (err) {
+  if (process.env.YODA_RUN_MODE !== 'host') {
+    throw err
+  }
+  /** replays traces on hosts without the input devices */
+  InputWrap = require('./trace').StandInWrap
+}
 var EventEmitter = require('events').EventEmitter
 var inherits = require('util').inherits
+var latency = require('./latency')
+var resolver = require('./resolver')
 
 var handler = null
 var events = [
@@ -22,6 +33,11 @@ var ACTION_LONG_CLICK = 3
 // eslint-disable-next-line no-unused-vars
 var ACTION_SLIDE = 4
 
+var EVENT_TYPE_KEY = 0
+var EVENT_TYPE_GESTURE = 1
+/** int32 fields of each packed event */
+var EVENT_STRIDE = 9
+
 /**
  * Common base class for input events.
  * @constructor
@@ -56,21 +72,64 @@ function InputEvent (options) {
   if (this._options.selectTimeout === 0) {
     throw new Error('selectTimeout must not be 0')
   }
+  /**
+   * events dropped by the native ring under overload.
+   * @type {Number}
+   */
+  this.droppedEvents = 0
+  /**
+   * if debounce, long press timing and preventSubsequent are resolved by the
+   * native handler, see {@link module:@yoda/input~InputEvent#configure}.
+   * @type {Boolean}
+   */
+  this.resolved = false
   this._handle = new InputWrap()
-  this._handle.onevent = this.onevent.bind(this)
-  this._handle.ongesture = this.ongesture.bind(this)
+  this._handle.onevents = this.onevents.bind(this)
 }
 inherits(InputEvent, EventEmitter)
 
+/**
+ * Dispatches a batch of packed events. The batch is reused by the native
+ * side once this returns, so it must be consumed synchronously.
+ *
+ * @param {Int32Array} batch - the packed events
+ * @param {Number} count - the count of events in the batch
+ * @param {Number} dropped - the total count of dropped events
+ * @param {Number} dispatchedAt - the monotonic time the batch is dispatched at
+ * @private
+ */
+InputEvent.prototype.onevents = function (batch, count, dropped, dispatchedAt) {
+  if (dropped > this.droppedEvents) {
+    console.error(`input events dropped: ${dropped - this.droppedEvents}`)
+    this.droppedEvents = dropped
+  }
+  for (var i = 0; i < count; ++i) {
+    var offset = i * EVENT_STRIDE
+    var type = batch[offset]
+    var monotonicTime = batch[offset + 6] * 1000 + batch[offset + 7] / 1000
+    if (type === EVENT_TYPE_KEY) {
+      this.onevent(batch[offset + 1], batch[offset + 2], batch[offset + 3],
+        batch[offset + 4] * 1000 + Math.floor(batch[offset + 5] / 1000),
+        monotonicTime, dispatchedAt, batch[offset + 8])
+    } else if (type === EVENT_TYPE_GESTURE) {
+      this.ongesture(batch[offset + 1], batch[offset + 2], batch[offset + 3],
+        batch[offset + 4], batch[offset + 5], monotonicTime, dispatchedAt)
+    }
+  }
+}
+
 /**
  * event trigger
  * @param {Number} state - the event state
  * @param {Number} action - the event action
  * @param {Number} code - the event code
  * @param {Number} time - the event time
+ * @param {Number} [monotonicTime] - the event time on the monotonic clock
+ * @param {Number} [dispatchedAt] - the monotonic time of the dispatch
+ * @param {Number} [timeDelta] - the time since keydown of a resolved long press
  * @private
  */
-InputEvent.prototype.onevent = function (state, action, code, time) {
+InputEvent.prototype.onevent = function (state, action, code, time, monotonicTime, dispatchedAt, timeDelta) {
   var name = events[state]
   if (!name) {
     this.emit('error', new Error(`unknown event name ${state}`))
@@ -82,6 +141,7 @@ InputEvent.prototype.onevent = function (state, action, code, time) {
    * @type {Object}
    * @property {Number} keyCode - the key code
    * @property {Number} keyTime - the key time
+   * @property {Number} monotonicTime - the key time on the monotonic clock
    */
   /**
    * keydown event
@@ -89,6 +149,7 @@ InputEvent.prototype.onevent = function (state, action, code, time) {
    * @type {Object}
    * @property {Number} keyCode - the key code
    * @property {Number} keyTime - the key time
+   * @property {Number} monotonicTime - the key time on the monotonic clock
    */
   /**
    * long press event
@@ -96,11 +157,22 @@ InputEvent.prototype.onevent = function (state, action, code, time) {
    * @type {Object}
    * @property {Number} keyCode - the key code
    * @property {Number} keyTime - the key time
+   * @property {Number} monotonicTime - the key time on the monotonic clock
+   * @property {Boolean} resolved - if resolved by the native handler
+   * @property {Number} [timeDelta] - the time since keydown in multiples of
+   * the long press window, if resolved
    */
-  this.emit(name, {
+  var event = {
     keyCode: code,
-    keyTime: time
-  })
+    keyTime: time,
+    monotonicTime: monotonicTime,
+    resolved: this.resolved
+  }
+  if (this.resolved && name === 'longpress') {
+    event.timeDelta = timeDelta
+  }
+  latency.observe('native', name, event, dispatchedAt)
+  this.emit(name, event)
 }
 
 /**
@@ -110,47 +182,60 @@ InputEvent.prototype.onevent = function (state, action, code, time) {
  * @param {Number} slideValue - slide orientation if action is ACTION_SLIDE
  * @param {Number} clickCount - click count if action is ACTION_CLICK or ACTION_DB_CLICK
  * @param {Number} longpressTime - longpress duration if action is ACTION_LONGPRESSED
+ * @param {Number} [monotonicTime] - the gesture time on the monotonic clock
+ * @param {Number} [dispatchedAt] - the monotonic time of the dispatch
  */
-InputEvent.prototype.ongesture = function (action, code, slideValue, clickCount, longpressTime) {
+InputEvent.prototype.ongesture = function (action, code, slideValue, clickCount, longpressTime, monotonicTime, dispatchedAt) {
+  var name
   if (action === ACTION_CLICK) {
     /**
      * click event
      * @event module:@yoda/input~InputEvent#click
      * @type {Object}
      * @property {Number} keyCode - the key code
+     * @property {Number} monotonicTime - the gesture time on the monotonic clock
      */
-    this.emit('click', { keyCode: code })
+    name = 'click'
   } else if (action === ACTION_DB_CLICK) {
     /**
      * double click event
      * @event module:@yoda/input~InputEvent#dbclick
      * @type {Object}
      * @property {Number} keyCode - the key code
+     * @property {Number} monotonicTime - the gesture time on the monotonic clock
      */
-    this.emit('dbclick', { keyCode: code })
+    name = 'dbclick'
   } else if (action === ACTION_LONG_CLICK) {
     /**
      * click event
      * @event module:@yoda/input~InputEvent#longpressed
      * @type {Object}
      * @property {Number} keyCode - the key code
+     * @property {Number} monotonicTime - the gesture time on the monotonic clock
      */
-    this.emit('longpressed', { keyCode: code })
+    name = 'longpressed'
   } else if (action === ACTION_SLIDE) {
     /**
      * clockwise slide event
      * @event module:@yoda/input~InputEvent#slide-clockwise
      * @type {Object}
      * @property {Number} keyCode - the key code
+     * @property {Number} monotonicTime - the gesture time on the monotonic clock
      */
     /**
      * counter clockwise slide event
      * @event module:@yoda/input~InputEvent#slide-counter-clockwise
      * @type {Object}
      * @property {Number} keyCode - the key code
+     * @property {Number} monotonicTime - the gesture time on the monotonic clock
      */
-    this.emit(slideValue === 1 ? 'slide-clockwise' : 'slide-counter-clockwise', { keyCode: code })
+    name = slideValue === 1 ? 'slide-clockwise' : 'slide-counter-clockwise'
+  } else {
+    return
   }
+  var event = { keyCode: code, monotonicTime: monotonicTime, resolved: this.resolved }
+  latency.observe('native', name, event, dispatchedAt)
+  this.emit(name, event)
 }
 
 /**
@@ -165,6 +250,80 @@ InputEvent.prototype.start = function () {
     this._options.slideTimeout)
 }
 
+/**
+ * Resolve debounce, long press timing and preventSubsequent of the keyboard
+ * config on the native listener thread. Once configured, debounced and
+ * prevented events are never emitted, and `longpress` is emitted every
+ * `config.longpressWindow` milliseconds of a held key with its `timeDelta`.
+ *
+ * @param {Object} config - the keyboard config, see
+ * {@link module:@yoda/input/resolver.compile}
+ * @returns {Boolean} false if the native handler could not resolve events,
+ * which are emitted as read from the devices
+ */
+InputEvent.prototype.configure = function (config) {
+  if (typeof this._handle.configure !== 'function') {
+    return false
+  }
+  var compiled = resolver.compile(config)
+  var r = this._handle.configure(compiled.longpressWindow, compiled.rules)
+  if (r < 0) {
+    console.error(`failed to configure input resolution, errno ${-r}`)
+    return false
+  }
+  this.resolved = true
+  return true
+}
+
+/**
+ * Record raw events read from the devices into a binary trace with their
+ * original timings, see {@link module:@yoda/input/trace}.
+ *
+ * @param {string|null} path - the trace path, `null` to stop recording
+ * @throws {Error} failed to open the trace
+ */
+InputEvent.prototype.record = function (path) {
+  var r = this._handle.record(path)
+  if (r < 0) {
+    throw new Error(`failed to record input trace, errno ${-r}`)
+  }
+}
+
+/**
+ * @typedef ReplayResult
+ * @property {Number} injected - events injected into the ring
+ * @property {Number} dropped - events dropped by the ring during the replay
+ */
+
+/**
+ * Replay a trace through the native event ring, events are dispatched as if
+ * they were read from the devices.
+ *
+ * @param {string} path - the trace path
+ * @param {Object} [options]
+ * @param {Number} [options.speed=1] - scales the recorded timings, 0 to replay
+ * as fast as possible
+ * @param {Function} callback - `(err, result: ReplayResult)`
+ */
+InputEvent.prototype.replay = function (path, options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = {}
+  }
+  var speed = options && typeof options.speed === 'number' ? options.speed : 1
+  var dropped = this.droppedEvents
+  this._handle.onreplay = (injected, droppedTotal) => {
+    this._handle.onreplay = null
+    this.droppedEvents = Math.max(this.droppedEvents, droppedTotal)
+    callback(null, { injected: injected, dropped: droppedTotal - dropped })
+  }
+  var r = this._handle.replay(path, speed)
+  if (r < 0) {
+    this._handle.onreplay = null
+    process.nextTick(callback, new Error(`failed to replay input trace, errno ${-r}`))
+  }
+}
+
 /**
  * disconnect from event handler
  */
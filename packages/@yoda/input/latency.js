@@ -0,0 +1,47 @@
+'use strict'
+
+/**
+ * @module @yoda/input/latency
+ * @description End-to-end latency of input events. Events carry
+ * `monotonicTime`, the time of the event on the system monotonic clock which
+ * is shared by all processes, so that each stage of the keyboard pipeline
+ * could measure the latency since the event was raised by the kernel.
+ */
+
+var endoscope = require('@yoda/endoscope')
+
+var keyLatencyHistogram = new endoscope.Histogram('yodaos:input:key_latency', [ 'stage', 'event' ])
+
+/**
+ * Get the current time on the monotonic clock in milliseconds.
+ * @returns {Number}
+ */
+function monotonicNow () {
+  var time = process.hrtime()
+  return time[0] * 1000 + time[1] / 1e6
+}
+
+/**
+ * Record the latency of the event at the stage.
+ *
+ * - `native`: the event has been dispatched by the input addon.
+ * - `keyboard`: the keyboard component has received the event.
+ * - `app`: the app has received the event.
+ *
+ * @param {string} stage
+ * @param {string} name - the event name
+ * @param {object} event - the event, skipped if it has no `monotonicTime`
+ * @param {Number} [now] - the monotonic time of the stage
+ */
+function observe (stage, name, event, now) {
+  if (event == null || typeof event.monotonicTime !== 'number') {
+    return
+  }
+  if (now == null) {
+    now = monotonicNow()
+  }
+  keyLatencyHistogram.observe({ stage: stage, event: name }, now - event.monotonicTime)
+}
+
+module.exports.monotonicNow = monotonicNow
+module.exports.observe = observe
@@ -0,0 +1,115 @@
+'use strict'
+
+/**
+ * @module @yoda/input/resolver
+ * @description Compiles the keyboard config into the rules the native
+ * handler resolves events by on its listener thread, so that debounced and
+ * prevented events never reach JavaScript, and long presses are raised on
+ * the monotonic clock with their time delta since keydown.
+ */
+
+var RULE_DEBOUNCE = 0
+var RULE_PREVENT_AT = 1
+var RULE_PREVENT_FROM = 2
+var ANY_KEY = -1
+
+/** events of the keyboard config, in the order of `INPUT_RESOLVE_*` */
+var Events = {
+  keyup: 0,
+  keydown: 1,
+  longpress: 2,
+  click: 3,
+  dbclick: 4,
+  longpressed: 5,
+  'slide-clockwise': 6,
+  'slide-counter-clockwise': 7
+}
+var DebouncedEvents = [
+  'keyup', 'keydown', 'click', 'dbclick', 'slide-clockwise', 'slide-counter-clockwise'
+]
+
+/**
+ * @typedef CompiledRules
+ * @property {Number} longpressWindow
+ * @property {Number[]} rules - flat `[kind, keyCode, event, value]`
+ */
+
+/**
+ * Compile the keyboard config, i.e. `/etc/yoda/keyboard.json`.
+ *
+ * - debounce: `descriptor.debounce`, or `config.debounce`, of keyup,
+ *   keydown and gestures of each key, and of the `fallbacks` gestures for
+ *   keys without their own descriptor.
+ * - prevent subsequent: `longpress` descriptors, or `longpress-<timeDelta>`
+ *   ones if a key has no `longpress` descriptor, with `preventSubsequent`.
+ *
+ * @param {Object} config
+ * @returns {CompiledRules}
+ */
+function compile (config) {
+  config = config || {}
+  var globals = config.config || {}
+  var debounce = globals.debounce || 0
+  var result = {
+    longpressWindow: globals.longpressWindow || 500,
+    rules: []
+  }
+  var push = function (kind, keyCode, event, value) {
+    result.rules.push(kind, keyCode, Events[event], value)
+  }
+  var pushDebounce = function (keyCode, event, descriptor) {
+    var value = typeof descriptor.debounce === 'number' ? descriptor.debounce : debounce
+    if (value > 0) {
+      push(RULE_DEBOUNCE, keyCode, event, value)
+    }
+  }
+
+  Object.keys(config).forEach(key => {
+    if (key === 'config') {
+      return
+    }
+    var descriptors = config[key]
+    if (descriptors == null || typeof descriptors !== 'object') {
+      return
+    }
+    var keyCode = key === 'fallbacks' ? ANY_KEY : Number(key)
+    if (isNaN(keyCode)) {
+      return
+    }
+    DebouncedEvents.forEach(event => {
+      if (descriptors[event] != null && typeof descriptors[event] === 'object') {
+        pushDebounce(keyCode, event, descriptors[event])
+      }
+    })
+    if (keyCode === ANY_KEY) {
+      return
+    }
+
+    var longpress = descriptors.longpress
+    if (longpress != null && typeof longpress === 'object') {
+      if (longpress.preventSubsequent) {
+        push(longpress.repeat ? RULE_PREVENT_FROM : RULE_PREVENT_AT, keyCode,
+          'longpress', longpress.timeDelta || 0)
+      }
+      return
+    }
+    Object.keys(descriptors).forEach(event => {
+      var match = /^longpress-(\d+)$/.exec(event)
+      var descriptor = descriptors[event]
+      if (match == null || descriptor == null || !descriptor.preventSubsequent) {
+        return
+      }
+      var timeDelta = Number(match[1])
+      var expected = descriptor.timeDelta || 0
+      /** mirrors the matching of the keyboard component */
+      if (timeDelta < expected || (!descriptor.repeat && timeDelta > expected)) {
+        return
+      }
+      push(RULE_PREVENT_AT, keyCode, 'longpress', timeDelta)
+    })
+  })
+  return result
+}
+
+module.exports.compile = compile
+module.exports.Events = Events
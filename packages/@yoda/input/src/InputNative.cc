@@ -1,6 +1,13 @@
 #include "InputNative.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #ifdef HAS_TOUCHPAD
 #define IOTJS_INPUT_HAS_TOUCH true
@@ -60,7 +67,12 @@ class InputInitializer {
 
     if (status == 0 /* success */ &&
         _this->event_handler != NULL /* not canceled */) {
-      _this->event_handler->start();
+      int linger_ms = initializer->timeout_select;
+      if (initializer->timeout_dbclick > linger_ms)
+        linger_ms = initializer->timeout_dbclick;
+      if (initializer->timeout_slide > linger_ms)
+        linger_ms = initializer->timeout_slide;
+      _this->event_handler->start(linger_ms + INPUT_LISTENER_LINGER_MS);
     } else {
       // iotjs_input_onerror(_this);
     }
@@ -86,70 +98,609 @@ InputEventHandler::InputEventHandler(iotjs_input_t* inputwrap_) {
   keyevent_ = { 0 };
   gesture_ = { 0 };
   need_destroy_ = false;
-  req.data = this;
+  replay_done = false;
+  replay_injected = 0;
+  jbatch = jerry_create_undefined();
+  uv_mutex_init(&trace_mutex);
+  uv_mutex_init(&rules_mutex);
+  uv_mutex_init(&replay_mutex);
+  uv_cond_init(&replay_cond);
 }
 
 InputEventHandler::~InputEventHandler() {
   // TODO
 }
 
-int InputEventHandler::start() {
+int InputEventHandler::start(int linger_ms_) {
+  linger_ms = linger_ms_;
   event_handle.data = (void*)this;
   uv_async_init(uv_default_loop(), &event_handle, InputEventHandler::OnEvent);
-  uv_mutex_init(&event_mutex);
+  /**
+   * The batch is exposed to JavaScript as an Int32Array over the handler
+   * owned memory, which is valid until the handler is stopped.
+   */
+  jerry_value_t jbuffer =
+      jerry_create_arraybuffer_external(sizeof(batch), (uint8_t*)batch, NULL);
+  jbatch = jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_INT32,
+                                                   jbuffer);
+  jerry_release_value(jbuffer);
+  if (!watchDevices()) {
+    fprintf(stderr, "evdev readiness not available, polling the listener\n");
+    closeDevices();
+  }
   this->started = true;
-  return uv_queue_work(uv_default_loop(), &req, InputEventHandler::DoStart,
-                       InputEventHandler::AfterStart);
+  return uv_thread_create(&thread, InputEventHandler::Run, this);
 }
 
 int InputEventHandler::stop() {
-  int r = uv_cancel((uv_req_t*)&req);
   this->need_destroy_ = true;
   if (this->started) {
+    if (wakeup_fd >= 0) {
+      uint64_t one = 1;
+      ssize_t r = write(wakeup_fd, &one, sizeof(one));
+      (void)r;
+    }
+    /** the listener returns in at most one select timeout */
+    uv_thread_join(&thread);
+    if (replaying) {
+      uv_mutex_lock(&replay_mutex);
+      uv_cond_signal(&replay_cond);
+      uv_mutex_unlock(&replay_mutex);
+      uv_thread_join(&replay_thread);
+    }
+    record(NULL);
+    closeDevices();
     uv_close((uv_handle_t*)&event_handle, InputEventHandler::OnStop);
   }
-  return r;
+  return 0;
 }
 
-void InputEventHandler::DoStart(uv_work_t* req) {
-  InputEventHandler* handler = (InputEventHandler*)req->data;
-  while (true) {
-    if (handler->need_destroy_ == true) {
+/**
+ * Opens every evdev device on its own. Each open file has its own event
+ * queue, so reading them here never steals events from the listener, they
+ * are only drained to learn about readiness.
+ */
+bool InputEventHandler::watchDevices() {
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  inject_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epoll_fd < 0 || wakeup_fd < 0 || inject_fd < 0) {
+    return false;
+  }
+  struct epoll_event ev = { 0 };
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeup_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) != 0) {
+    return false;
+  }
+  ev.data.fd = inject_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inject_fd, &ev) != 0) {
+    return false;
+  }
+
+  DIR* dir = opendir("/dev/input");
+  if (dir == NULL) {
+    return false;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strncmp(entry->d_name, "event", 5) != 0) {
+      continue;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      close(fd);
+      continue;
+    }
+    device_fds.push_back(fd);
+  }
+  closedir(dir);
+  return !device_fds.empty();
+}
+
+void InputEventHandler::closeDevices() {
+  for (auto fd : device_fds) {
+    close(fd);
+  }
+  device_fds.clear();
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+    epoll_fd = -1;
+  }
+  if (wakeup_fd >= 0) {
+    close(wakeup_fd);
+    wakeup_fd = -1;
+  }
+  if (inject_fd >= 0) {
+    close(inject_fd);
+    inject_fd = -1;
+  }
+}
+
+/**
+ * Waits for evdev readiness or replayed events, returns a mask of
+ * `INPUT_READY_*`, 0 on timeout and -1 if the handler is being stopped.
+ */
+int InputEventHandler::waitReadiness(int timeout) {
+  struct epoll_event events[8];
+  int n = epoll_wait(epoll_fd, events, 8, timeout);
+  if (n < 0) {
+    return errno == EINTR ? 0 : -1;
+  }
+  int ready = 0;
+  char drain[512];
+  for (int i = 0; i < n; ++i) {
+    if (events[i].data.fd == wakeup_fd) {
+      return -1;
+    }
+    while (read(events[i].data.fd, drain, sizeof(drain)) > 0) {
+    }
+    ready |= events[i].data.fd == inject_fd ? INPUT_READY_INJECTED
+                                            : INPUT_READY_DEVICES;
+  }
+  return ready;
+}
+
+/**
+ * Polls the listener once and hands the raw events to the resolution.
+ */
+void InputEventHandler::listen() {
+  keyevent_.new_action = false;
+  gesture_.new_action = false;
+  daemon_start_listener(&keyevent_, &gesture_);
+  uint64_t mono_us = uv_hrtime() / 1000;
+  // Send key event
+  if (keyevent_.new_action) {
+    /**
+     * evdev stamps events with the realtime clock, translates the timestamp
+     * to the monotonic clock by the delay measured on the realtime clock.
+     */
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t delay_us = (now.tv_sec - keyevent_.key_timeval.tv_sec) * 1000000LL +
+                       (now.tv_usec - keyevent_.key_timeval.tv_usec);
+    uint64_t key_mono_us = mono_us;
+    if (delay_us > 0 && (uint64_t)delay_us < mono_us) {
+      key_mono_us -= delay_us;
+    }
+    InputEventRecord record = {
+      INPUT_EVENT_TYPE_KEY,
+      { keyevent_.value, keyevent_.action, keyevent_.key_code,
+        (int32_t)keyevent_.key_timeval.tv_sec,
+        (int32_t)keyevent_.key_timeval.tv_usec,
+        (int32_t)(key_mono_us / 1000000), (int32_t)(key_mono_us % 1000000),
+        0 }
+    };
+    intake(record, false);
+  }
+  // Send gesture event
+  if (gesture_.new_action) {
+    InputEventRecord record = {
+      INPUT_EVENT_TYPE_GESTURE,
+      { gesture_.action, gesture_.key_code, gesture_.slide_value,
+        gesture_.click_count, gesture_.long_press_time,
+        (int32_t)(mono_us / 1000000), (int32_t)(mono_us % 1000000), 0 }
+    };
+    intake(record, false);
+  }
+}
+
+static inline uint64_t iotjs_input_record_mono_us(
+    const InputEventRecord& record) {
+  return (uint64_t)record.fields[5] * 1000000ULL + record.fields[6];
+}
+
+void InputEventHandler::wakeInjected() {
+  if (inject_fd >= 0) {
+    uint64_t one = 1;
+    ssize_t r = write(inject_fd, &one, sizeof(one));
+    (void)r;
+  }
+}
+
+/**
+ * Resolves the replayed events handed over by the replay thread, polled
+ * with the listener if evdev readiness is not available.
+ */
+void InputEventHandler::drainInjected() {
+  InputEventRecord records[32];
+  uint32_t count;
+  while ((count = inject_ring.drain(records, 32)) > 0) {
+    for (uint32_t i = 0; i < count; ++i) {
+      intake(records[i], true);
+    }
+  }
+}
+
+/**
+ * Appends a raw event read from the devices to the trace if recording, and
+ * resolves it.
+ */
+void InputEventHandler::intake(const InputEventRecord& record, bool injected) {
+  if (!injected) {
+    uv_mutex_lock(&trace_mutex);
+    if (trace_file != NULL) {
+      uint64_t mono_us = iotjs_input_record_mono_us(record);
+      if (trace_start_us == 0) {
+        trace_start_us = mono_us;
+      }
+      uint64_t elapsed =
+          mono_us > trace_start_us ? mono_us - trace_start_us : 0;
+      InputTraceEntry entry = { (int32_t)(elapsed / 1000000),
+                                (int32_t)(elapsed % 1000000), record };
+      fwrite(&entry, sizeof(entry), 1, trace_file);
+      fflush(trace_file);
+    }
+    uv_mutex_unlock(&trace_mutex);
+  }
+  uv_mutex_lock(&rules_mutex);
+  if (longpress_window <= 0) {
+    /** not configured, delivers the raw events as is */
+    emit(record);
+  } else if (record.type == INPUT_EVENT_TYPE_KEY) {
+    resolveKey(record);
+  } else {
+    resolveGesture(record);
+  }
+  uv_mutex_unlock(&rules_mutex);
+}
+
+/**
+ * Tracks held keys for long presses and discards debounced and prevented
+ * key events. Long presses of the library are discarded, they are raised
+ * by `tickKeys` on the monotonic clock instead.
+ */
+void InputEventHandler::resolveKey(const InputEventRecord& record) {
+  int32_t value = record.fields[0];
+  int32_t key_code = record.fields[2];
+  uint64_t mono_us = iotjs_input_record_mono_us(record);
+  int idx = -1;
+  for (int i = 0; i < held_count; ++i) {
+    if (held[i].key_code == key_code) {
+      idx = i;
+      break;
+    }
+  }
+
+  if (value == INPUT_KEY_VALUE_DOWN) {
+    if (idx >= 0) {
+      /** auto repeat of a held key */
+      return;
+    }
+    if (held_count < INPUT_HELD_KEYS_MAX) {
+      InputHeldKey* key = &held[held_count++];
+      key->key_code = key_code;
+      key->prevented = false;
+      key->ticks = 0;
+      key->down_us = mono_us;
+      key->down_tv.tv_sec = record.fields[3];
+      key->down_tv.tv_usec = record.fields[4];
+    }
+    if (!debounced(key_code, INPUT_RESOLVE_KEYDOWN, mono_us)) {
+      emit(record);
+    }
+  } else if (value == INPUT_KEY_VALUE_UP) {
+    bool prevented = false;
+    if (idx >= 0) {
+      prevented = held[idx].prevented;
+      held[idx] = held[--held_count];
+    }
+    if (!prevented && !debounced(key_code, INPUT_RESOLVE_KEYUP, mono_us)) {
+      emit(record);
+    }
+  }
+}
+
+void InputEventHandler::resolveGesture(const InputEventRecord& record) {
+  int32_t event;
+  switch (record.fields[0]) {
+    case 1: /** click */
+      event = INPUT_RESOLVE_CLICK;
+      break;
+    case 2: /** double click */
+      event = INPUT_RESOLVE_DBCLICK;
+      break;
+    case 3: /** long click */
+      event = INPUT_RESOLVE_LONGPRESSED;
+      break;
+    case 4: /** slide */
+      event = record.fields[2] == 1 ? INPUT_RESOLVE_SLIDE_CLOCKWISE
+                                    : INPUT_RESOLVE_SLIDE_COUNTER_CLOCKWISE;
+      break;
+    default:
+      emit(record);
+      return;
+  }
+  if (!debounced(record.fields[1], event,
+                 iotjs_input_record_mono_us(record))) {
+    emit(record);
+  }
+}
+
+/**
+ * Returns true if the event is within the debounce of the last delivered
+ * one, or marks the event as delivered otherwise.
+ */
+bool InputEventHandler::debounced(int32_t key_code, int32_t event,
+                                  uint64_t mono_us) {
+  InputKeyRule* rule = NULL;
+  for (auto& it : rules) {
+    if (it.kind != INPUT_RULE_DEBOUNCE || it.event != event) {
+      continue;
+    }
+    if (it.key_code == key_code) {
+      rule = &it;
       break;
     }
-    daemon_start_listener(&handler->keyevent_, &handler->gesture_);
-    // Send InputKeyEvent
-    if (handler->keyevent_.new_action) {
-      InputKeyEvent* event = new InputKeyEvent();
-      event->data.new_action = handler->keyevent_.new_action;
-      event->data.value = handler->keyevent_.value;
-      event->data.action = handler->keyevent_.action;
-      event->data.key_code = handler->keyevent_.key_code;
-      event->data.key_timeval = handler->keyevent_.key_timeval;
+    if (it.key_code == INPUT_RULE_ANY_KEY && rule == NULL) {
+      rule = &it;
+    }
+  }
+  if (rule == NULL || rule->value <= 0) {
+    return false;
+  }
+  if (rule->last_us != 0 && mono_us >= rule->last_us &&
+      mono_us - rule->last_us < (uint64_t)rule->value * 1000) {
+    return true;
+  }
+  rule->last_us = mono_us;
+  return false;
+}
+
+bool InputEventHandler::prevents(int32_t key_code, int32_t time_delta) {
+  for (auto& it : rules) {
+    if (it.key_code != key_code || it.event != INPUT_RESOLVE_LONGPRESS) {
+      continue;
+    }
+    if ((it.kind == INPUT_RULE_PREVENT_AT && time_delta == it.value) ||
+        (it.kind == INPUT_RULE_PREVENT_FROM && time_delta >= it.value)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-      uv_mutex_lock(&handler->event_mutex);
-      handler->key_events.push_back(event);
-      uv_mutex_unlock(&handler->event_mutex);
+/**
+ * Raises a long press of each held key every `longpress_window`
+ * milliseconds since its keydown.
+ */
+void InputEventHandler::tickKeys(uint64_t now_us) {
+  uv_mutex_lock(&rules_mutex);
+  uint64_t window_us = (uint64_t)longpress_window * 1000;
+  for (int i = 0; window_us > 0 && i < held_count; ++i) {
+    InputHeldKey* key = &held[i];
+    uint64_t due_us;
+    while ((due_us = key->down_us + (key->ticks + 1) * window_us) <= now_us) {
+      key->ticks++;
+      if (key->prevented) {
+        continue;
+      }
+      int32_t time_delta = (int32_t)(key->ticks * longpress_window);
+      struct timeval tv = key->down_tv;
+      tv.tv_sec += time_delta / 1000;
+      tv.tv_usec += (time_delta % 1000) * 1000;
+      if (tv.tv_usec >= 1000000) {
+        tv.tv_sec++;
+        tv.tv_usec -= 1000000;
+      }
+      InputEventRecord record = {
+        INPUT_EVENT_TYPE_KEY,
+        { INPUT_KEY_VALUE_LONGPRESS, 0, key->key_code, (int32_t)tv.tv_sec,
+          (int32_t)tv.tv_usec, (int32_t)(due_us / 1000000),
+          (int32_t)(due_us % 1000000), time_delta }
+      };
+      emit(record);
+      key->prevented = prevents(key->key_code, time_delta);
     }
-    // Send InputGestureEvent
-    if (handler->gesture_.new_action) {
-      InputGestureEvent* event = new InputGestureEvent();
-      event->data.new_action = handler->gesture_.new_action;
-      event->data.action = handler->gesture_.action;
-      event->data.key_code = handler->gesture_.key_code;
-      event->data.slide_value = handler->gesture_.slide_value;
-      event->data.click_count = handler->gesture_.click_count;
-      event->data.long_press_time = handler->gesture_.long_press_time;
+  }
+  uv_mutex_unlock(&rules_mutex);
+}
 
-      uv_mutex_lock(&handler->event_mutex);
-      handler->gesture_events.push_back(event);
-      uv_mutex_unlock(&handler->event_mutex);
+/**
+ * Returns the milliseconds until the next long press is due, or -1 if no
+ * key is being held.
+ */
+int InputEventHandler::nextTimeout(uint64_t now_ms) {
+  uv_mutex_lock(&rules_mutex);
+  int timeout = -1;
+  for (int i = 0; longpress_window > 0 && i < held_count; ++i) {
+    uint64_t due_ms = (held[i].down_us + 999) / 1000 +
+                      (uint64_t)(held[i].ticks + 1) * longpress_window;
+    int remaining = due_ms > now_ms ? (int)(due_ms - now_ms) : 0;
+    if (timeout < 0 || remaining < timeout) {
+      timeout = remaining;
     }
-    uv_async_send(&handler->event_handle);
   }
+  uv_mutex_unlock(&rules_mutex);
+  return timeout;
 }
 
-void InputEventHandler::AfterStart(uv_work_t* req, int status) {
+void InputEventHandler::emit(const InputEventRecord& record) {
+  if (ring.push(record)) {
+    signal_pending = true;
+  }
+}
+
+/**
+ * Signals JavaScript once for all events resolved in an iteration.
+ */
+void InputEventHandler::flush() {
+  if (signal_pending) {
+    signal_pending = false;
+    uv_async_send(&event_handle);
+  }
+}
+
+/**
+ * Replaces the resolution rules, events are delivered as read from the
+ * devices until the handler is configured with a positive
+ * `longpress_window`.
+ */
+int InputEventHandler::configure(int longpress_window_,
+                                 const std::vector<InputKeyRule>& rules_) {
+  if (longpress_window_ < 0) {
+    return -EINVAL;
+  }
+  uv_mutex_lock(&rules_mutex);
+  longpress_window = longpress_window_;
+  rules = rules_;
+  uv_mutex_unlock(&rules_mutex);
+  return 0;
+}
+
+/**
+ * Starts recording raw events read from the devices to the trace at `path`,
+ * or stops recording if `path` is NULL.
+ */
+int InputEventHandler::record(const char* path) {
+  FILE* file = NULL;
+  if (path != NULL) {
+    file = fopen(path, "wb");
+    if (file == NULL) {
+      return -errno;
+    }
+    int32_t header[2] = { (int32_t)INPUT_TRACE_MAGIC, INPUT_TRACE_STRIDE };
+    fwrite(header, sizeof(header), 1, file);
+  }
+  uv_mutex_lock(&trace_mutex);
+  FILE* prev = trace_file;
+  trace_file = file;
+  trace_start_us = 0;
+  uv_mutex_unlock(&trace_mutex);
+  if (prev != NULL) {
+    fclose(prev);
+  }
+  return 0;
+}
+
+/**
+ * Replays the trace at `path` through the resolution and the ring as if the
+ * events were read from the devices. `speed` scales the recorded timings, 0
+ * replays the events as fast as possible. `onreplay(injected, dropped)` is
+ * invoked once all events have been injected and delivered.
+ */
+int InputEventHandler::replay(const char* path, double speed) {
+  if (!started || replaying) {
+    return -EBUSY;
+  }
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return -errno;
+  }
+  int32_t header[2];
+  if (fread(header, sizeof(header), 1, file) != 1 ||
+      header[0] != (int32_t)INPUT_TRACE_MAGIC ||
+      header[1] != (int32_t)INPUT_TRACE_STRIDE) {
+    fclose(file);
+    return -EINVAL;
+  }
+  replay_entries.clear();
+  InputTraceEntry entry;
+  while (fread(&entry, sizeof(entry), 1, file) == 1) {
+    replay_entries.push_back(entry);
+  }
+  fclose(file);
+
+  replay_speed = speed;
+  replay_injected = 0;
+  replaying = true;
+  return uv_thread_create(&replay_thread, InputEventHandler::Replay, this);
+}
+
+/**
+ * Waits on the replay thread until the monotonic `until_us`, or until the
+ * handler is being stopped.
+ */
+void InputEventHandler::waitReplay(uint64_t until_us) {
+  uv_mutex_lock(&replay_mutex);
+  while (!need_destroy_) {
+    uint64_t now_us = uv_hrtime() / 1000;
+    if (now_us >= until_us) {
+      break;
+    }
+    uv_cond_timedwait(&replay_cond, &replay_mutex,
+                      (until_us - now_us) * 1000);
+  }
+  uv_mutex_unlock(&replay_mutex);
+}
+
+void InputEventHandler::Replay(void* arg) {
+  InputEventHandler* handler = (InputEventHandler*)arg;
+  uint64_t start_us = uv_hrtime() / 1000;
+  for (auto& entry : handler->replay_entries) {
+    if (handler->need_destroy_) {
+      break;
+    }
+    uint64_t mono_us = uv_hrtime() / 1000;
+    if (handler->replay_speed > 0) {
+      uint64_t offset = entry.sec * 1000000ULL + entry.usec;
+      uint64_t target = start_us + (uint64_t)(offset / handler->replay_speed);
+      if (target > mono_us) {
+        handler->waitReplay(target);
+        mono_us = target;
+      }
+    }
+    /** stamps the event as if it has just been raised */
+    InputEventRecord record = entry.record;
+    record.fields[5] = (int32_t)(mono_us / 1000000);
+    record.fields[6] = (int32_t)(mono_us % 1000000);
+    /** waits for the listener thread rather than dropping on hand over */
+    while (handler->inject_ring.size() >= INPUT_EVENT_RING_SIZE &&
+           !handler->need_destroy_) {
+      handler->waitReplay(uv_hrtime() / 1000 + 1000);
+    }
+    handler->inject_ring.push(record);
+    handler->replay_injected++;
+    handler->wakeInjected();
+  }
+  while (handler->inject_ring.size() > 0 && !handler->need_destroy_) {
+    handler->waitReplay(uv_hrtime() / 1000 + 1000);
+  }
+  handler->replay_done = true;
+  uv_async_send(&handler->event_handle);
+}
+
+void InputEventHandler::Run(void* arg) {
+  InputEventHandler* handler = (InputEventHandler*)arg;
+  /** events might be queued before the devices were opened */
+  uint64_t linger_until = uv_hrtime() / 1000000 + handler->linger_ms;
+  while (!handler->need_destroy_) {
+    if (handler->epoll_fd >= 0) {
+      /**
+       * Blocks until a device is ready or a long press is due while idle,
+       * and keeps polling the listener for pending gestures resolved by
+       * timeouts.
+       */
+      uint64_t now = uv_hrtime() / 1000000;
+      bool lingering = now < linger_until;
+      int timeout = lingering ? 0 : handler->nextTimeout(now);
+      int ready = handler->waitReadiness(timeout);
+      if (ready < 0) {
+        break;
+      }
+      if (ready & INPUT_READY_DEVICES) {
+        linger_until = uv_hrtime() / 1000000 + handler->linger_ms;
+        lingering = true;
+      }
+      handler->drainInjected();
+      handler->tickKeys(uv_hrtime() / 1000);
+      if (!lingering) {
+        handler->flush();
+        continue;
+      }
+    } else {
+      handler->drainInjected();
+    }
+    handler->listen();
+    handler->tickKeys(uv_hrtime() / 1000);
+    handler->flush();
+  }
   fprintf(stdout, "input event handler stopped\n");
 }
 
@@ -158,61 +709,50 @@ void InputEventHandler::OnEvent(uv_async_t* async) {
   iotjs_input_t* input = event_handler->inputwrap;
   IOTJS_VALIDATED_STRUCT_METHOD(iotjs_input_t, input);
 
-  list<InputKeyEvent*> key_event_list;
-  list<InputGestureEvent*> gesture_event_list;
-  uv_mutex_lock(&event_handler->event_mutex);
-  key_event_list.swap(event_handler->key_events);
-  gesture_event_list.swap(event_handler->gesture_events);
-  uv_mutex_unlock(&event_handler->event_mutex);
-
   jerry_value_t jthis = iotjs_jobjectwrap_jobject(&_this->jobjectwrap);
-  jerry_value_t onevent = iotjs_jval_get_property(jthis, "onevent");
-  if (!jerry_value_is_function(onevent)) {
-    fprintf(stderr, "no onevent function is registered\n");
-  } else {
-    for (auto it = key_event_list.begin(); it != key_event_list.end(); ++it) {
-      auto event = *it;
-
+  uint32_t count = event_handler->ring.drain(event_handler->batch);
+  if (count > 0) {
+    jerry_value_t onevents = iotjs_jval_get_property(jthis, "onevents");
+    if (!jerry_value_is_function(onevents)) {
+      fprintf(stderr, "no onevents function is registered\n");
+    } else {
       iotjs_jargs_t jargs = iotjs_jargs_create(4);
-      iotjs_jargs_append_number(&jargs, (double)event->data.value);
-      iotjs_jargs_append_number(&jargs, (double)event->data.action);
-      iotjs_jargs_append_number(&jargs, (double)event->data.key_code);
-
-      struct timeval key_time = event->data.key_timeval;
-      double jkey_time = static_cast<double>(key_time.tv_sec * 1000.0 +
-                                             key_time.tv_usec / 1000);
-      iotjs_jargs_append_number(&jargs, jkey_time);
-      iotjs_make_callback(onevent, jerry_create_undefined(), &jargs);
+      iotjs_jargs_append_jval(&jargs, event_handler->jbatch);
+      iotjs_jargs_append_number(&jargs, (double)count);
+      iotjs_jargs_append_number(&jargs,
+                                (double)event_handler->ring.droppedCount());
+      /** the monotonic time in milliseconds the batch is dispatched at */
+      iotjs_jargs_append_number(&jargs, (double)uv_hrtime() / 1e6);
+      iotjs_make_callback(onevents, jerry_create_undefined(), &jargs);
       iotjs_jargs_destroy(&jargs);
     }
+    jerry_release_value(onevents);
   }
-  jerry_release_value(onevent);
 
-  onevent = iotjs_jval_get_property(jthis, "ongesture");
-  if (!jerry_value_is_function(onevent)) {
-    fprintf(stderr, "no ongesture function is registered\n");
-  } else {
-    for (auto it = gesture_event_list.begin(); it != gesture_event_list.end();
-         ++it) {
-      auto event = *it;
-
-      iotjs_jargs_t jargs = iotjs_jargs_create(5);
-      iotjs_jargs_append_number(&jargs, (double)event->data.action);
-      iotjs_jargs_append_number(&jargs, (double)event->data.key_code);
-      iotjs_jargs_append_number(&jargs, (double)event->data.slide_value);
-      iotjs_jargs_append_number(&jargs, (double)event->data.click_count);
-      iotjs_jargs_append_number(&jargs, (double)event->data.long_press_time);
-      iotjs_make_callback(onevent, jerry_create_undefined(), &jargs);
+  if (event_handler->replay_done.exchange(false)) {
+    uv_thread_join(&event_handler->replay_thread);
+    event_handler->replaying = false;
+    event_handler->replay_entries.clear();
+    jerry_value_t onreplay = iotjs_jval_get_property(jthis, "onreplay");
+    if (jerry_value_is_function(onreplay)) {
+      iotjs_jargs_t jargs = iotjs_jargs_create(2);
+      iotjs_jargs_append_number(&jargs,
+                                (double)event_handler->replay_injected);
+      iotjs_jargs_append_number(&jargs,
+                                (double)event_handler->ring.droppedCount());
+      iotjs_make_callback(onreplay, jerry_create_undefined(), &jargs);
       iotjs_jargs_destroy(&jargs);
     }
+    jerry_release_value(onreplay);
   }
-  jerry_release_value(onevent);
 }
 
 void InputEventHandler::OnStop(uv_handle_t* handle) {
   uv_async_t* async = (uv_async_t*)handle;
   auto event_handler = static_cast<InputEventHandler*>(async->data);
-  uv_mutex_destroy(&event_handler->event_mutex);
+  jerry_release_value(event_handler->jbatch);
+  uv_mutex_destroy(&event_handler->trace_mutex);
+  uv_mutex_destroy(&event_handler->rules_mutex);
   delete event_handler;
 }
 
@@ -266,6 +806,71 @@ JS_FUNCTION(Disconnect) {
   return jerry_create_boolean(true);
 }
 
+JS_FUNCTION(Record) {
+  JS_DECLARE_THIS_PTR(input, input);
+  IOTJS_VALIDATED_STRUCT_METHOD(iotjs_input_t, input);
+
+  if (_this->event_handler == NULL) {
+    return jerry_create_number(-EINVAL);
+  }
+  if (jargc == 0 || !jerry_value_is_string(jargv[0])) {
+    return jerry_create_number(_this->event_handler->record(NULL));
+  }
+  iotjs_string_t path = JS_GET_ARG(0, string);
+  int r = _this->event_handler->record(iotjs_string_data(&path));
+  iotjs_string_destroy(&path);
+  return jerry_create_number(r);
+}
+
+JS_FUNCTION(Replay) {
+  JS_DECLARE_THIS_PTR(input, input);
+  IOTJS_VALIDATED_STRUCT_METHOD(iotjs_input_t, input);
+  DJS_CHECK_ARGS(2, string, number);
+
+  if (_this->event_handler == NULL) {
+    return jerry_create_number(-EINVAL);
+  }
+  iotjs_string_t path = JS_GET_ARG(0, string);
+  double speed = JS_GET_ARG(1, number);
+  int r = _this->event_handler->replay(iotjs_string_data(&path), speed);
+  iotjs_string_destroy(&path);
+  return jerry_create_number(r);
+}
+
+/**
+ * `configure(longpressWindow, rules)`, `rules` is a flat array of
+ * `[kind, keyCode, event, value]`, see `INPUT_RULE_*`.
+ */
+JS_FUNCTION(Configure) {
+  JS_DECLARE_THIS_PTR(input, input);
+  IOTJS_VALIDATED_STRUCT_METHOD(iotjs_input_t, input);
+  DJS_CHECK_ARGS(2, number, array);
+
+  if (_this->event_handler == NULL) {
+    return jerry_create_number(-EINVAL);
+  }
+  int longpress_window = JS_GET_ARG(0, number);
+  uint32_t length = jerry_get_array_length(jargv[1]);
+  if (length % INPUT_RULE_STRIDE != 0) {
+    return jerry_create_number(-EINVAL);
+  }
+  std::vector<InputKeyRule> rules;
+  for (uint32_t i = 0; i < length; i += INPUT_RULE_STRIDE) {
+    int32_t fields[INPUT_RULE_STRIDE];
+    for (uint32_t j = 0; j < INPUT_RULE_STRIDE; ++j) {
+      jerry_value_t jval = jerry_get_property_by_index(jargv[1], i + j);
+      fields[j] =
+          jerry_value_is_number(jval) ? (int32_t)jerry_get_number_value(jval)
+                                      : 0;
+      jerry_release_value(jval);
+    }
+    InputKeyRule rule = { fields[0], fields[1], fields[2], fields[3], 0 };
+    rules.push_back(rule);
+  }
+  return jerry_create_number(
+      _this->event_handler->configure(longpress_window, rules));
+}
+
 void init(jerry_value_t exports) {
   jerry_value_t jconstructor = jerry_create_external_function(Input);
   iotjs_jval_set_property_jval(exports, "InputWrap", jconstructor);
@@ -273,6 +878,9 @@ void init(jerry_value_t exports) {
   jerry_value_t proto = jerry_create_object();
   iotjs_jval_set_method(proto, "start", Start);
   iotjs_jval_set_method(proto, "disconnect", Disconnect);
+  iotjs_jval_set_method(proto, "record", Record);
+  iotjs_jval_set_method(proto, "replay", Replay);
+  iotjs_jval_set_method(proto, "configure", Configure);
   iotjs_jval_set_property_jval(jconstructor, "prototype", proto);
 
   jerry_release_value(proto);
@@ -2,7 +2,10 @@
 #define INPUT_NATIVE_H
 
 #include <stdio.h>
-#include <list>
+#include <stdint.h>
+#include <sys/time.h>
+#include <atomic>
+#include <vector>
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,14 +32,169 @@ typedef struct {
 static iotjs_input_t* iotjs_input_create(const jerry_value_t jinput);
 static void iotjs_input_destroy(iotjs_input_t* input);
 
-class InputKeyEvent {
- public:
-  struct keyevent data;
-};
+#define INPUT_EVENT_TYPE_KEY 0
+#define INPUT_EVENT_TYPE_GESTURE 1
+
+/**
+ * Capacity of the event ring, events are dropped and counted once the ring
+ * is full.
+ */
+#define INPUT_EVENT_RING_SIZE 256
+
+/**
+ * A packed event as delivered to JavaScript in an Int32Array:
+ *
+ * - key: `[type, value, action, key_code, tv_sec, tv_usec, mono_sec,
+ *   mono_usec, time_delta]`
+ * - gesture: `[type, action, key_code, slide_value, click_count,
+ *   long_press_time, mono_sec, mono_usec, 0]`
+ *
+ * `mono_*` is the time of the event on the monotonic clock of `uv_hrtime`,
+ * translated from the kernel timestamp for key events, and the time the
+ * gesture has been resolved for gesture events. `time_delta` is the time in
+ * milliseconds since keydown of a long press resolved by the handler.
+ */
+typedef struct {
+  int32_t type;
+  int32_t fields[8];
+} InputEventRecord;
+
+#define INPUT_KEY_VALUE_UP 0
+#define INPUT_KEY_VALUE_DOWN 1
+#define INPUT_KEY_VALUE_LONGPRESS 2
+
+#define INPUT_EVENT_STRIDE (sizeof(InputEventRecord) / sizeof(int32_t))
+
+/**
+ * A trace is a header of `[magic, stride]` followed by entries of `stride`
+ * int32, all in host byte order. `sec` and `usec` of an entry are relative
+ * to the first entry.
+ */
+#define INPUT_TRACE_MAGIC 0x31544959 /* YIT1 */
+
+typedef struct {
+  int32_t sec;
+  int32_t usec;
+  InputEventRecord record;
+} InputTraceEntry;
+
+#define INPUT_TRACE_STRIDE (sizeof(InputTraceEntry) / sizeof(int32_t))
+
+/**
+ * The listener keeps being polled for this long after the last evdev
+ * readiness on top of the gesture timeouts, so that clicks, double clicks
+ * and slides resolved by timeouts are still delivered.
+ */
+#define INPUT_LISTENER_LINGER_MS 100
+
+/** readiness reported by `InputEventHandler::waitReadiness` */
+#define INPUT_READY_DEVICES 0x1
+#define INPUT_READY_INJECTED 0x2
+
+/**
+ * Events the resolution rules apply to, the same as the event names of the
+ * keyboard config.
+ */
+#define INPUT_RESOLVE_KEYUP 0
+#define INPUT_RESOLVE_KEYDOWN 1
+#define INPUT_RESOLVE_LONGPRESS 2
+#define INPUT_RESOLVE_CLICK 3
+#define INPUT_RESOLVE_DBCLICK 4
+#define INPUT_RESOLVE_LONGPRESSED 5
+#define INPUT_RESOLVE_SLIDE_CLOCKWISE 6
+#define INPUT_RESOLVE_SLIDE_COUNTER_CLOCKWISE 7
 
-class InputGestureEvent {
+/**
+ * Kinds of the resolution rules, configured as `[kind, key_code, event,
+ * value]`:
+ *
+ * - debounce: events within `value` milliseconds since the last delivered
+ *   one are discarded.
+ * - prevent at/from: once a long press reaches exactly/at least `value`
+ *   milliseconds, its subsequent long presses and keyup are discarded.
+ *
+ * `key_code` of `INPUT_RULE_ANY_KEY` applies to keys without a rule of
+ * their own.
+ */
+#define INPUT_RULE_DEBOUNCE 0
+#define INPUT_RULE_PREVENT_AT 1
+#define INPUT_RULE_PREVENT_FROM 2
+#define INPUT_RULE_STRIDE 4
+#define INPUT_RULE_ANY_KEY -1
+
+typedef struct {
+  int32_t kind;
+  int32_t key_code;
+  int32_t event;
+  int32_t value;
+  /** the monotonic time of the last delivered event, for debounce */
+  uint64_t last_us;
+} InputKeyRule;
+
+/** Keys held at the same time tracked for long presses */
+#define INPUT_HELD_KEYS_MAX 8
+
+typedef struct {
+  int32_t key_code;
+  bool prevented;
+  uint32_t ticks;
+  uint64_t down_us;
+  struct timeval down_tv;
+} InputHeldKey;
+
+/**
+ * Single-producer single-consumer ring, each instance shall be pushed by one
+ * thread only and drained by another one.
+ */
+class InputEventRing {
  public:
-  struct gesture data;
+  InputEventRing() : head(0), tail(0), dropped(0) {
+  }
+
+  bool push(const InputEventRecord& record) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= INPUT_EVENT_RING_SIZE) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    records[h % INPUT_EVENT_RING_SIZE] = record;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * copies at most `max` pending records into `out` and returns the count
+   */
+  uint32_t drain(InputEventRecord* out,
+                 uint32_t max = INPUT_EVENT_RING_SIZE) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    uint32_t count = h - t;
+    if (count > max) {
+      count = max;
+      h = t + max;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      out[i] = records[(t + i) % INPUT_EVENT_RING_SIZE];
+    }
+    tail.store(h, std::memory_order_release);
+    return count;
+  }
+
+  uint32_t size() {
+    return head.load(std::memory_order_acquire) -
+           tail.load(std::memory_order_acquire);
+  }
+
+  uint32_t droppedCount() {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  InputEventRecord records[INPUT_EVENT_RING_SIZE];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
 };
 
 class InputEventHandler {
@@ -46,12 +204,15 @@ class InputEventHandler {
   ~InputEventHandler();
 
  public:
-  int start();
+  int start(int linger_ms);
   int stop();
+  int record(const char* path);
+  int replay(const char* path, double speed);
+  int configure(int longpress_window, const std::vector<InputKeyRule>& rules);
 
  public:
-  static void DoStart(uv_work_t* req);
-  static void AfterStart(uv_work_t* req, int status);
+  static void Run(void* arg);
+  static void Replay(void* arg);
   static void OnEvent(uv_async_t* async);
   static void OnStop(uv_handle_t* handle);
 
@@ -60,12 +221,68 @@ class InputEventHandler {
   struct keyevent keyevent_;
   struct gesture gesture_;
   bool started = false;
-  bool need_destroy_;
-  uv_work_t req;
+  std::atomic<bool> need_destroy_;
+  uv_thread_t thread;
+  /**
+   * epoll over the evdev devices, `wakeup_fd` and `inject_fd`, -1 if not
+   * available
+   */
+  int epoll_fd = -1;
+  int wakeup_fd = -1;
+  int inject_fd = -1;
+  std::vector<int> device_fds;
+  int linger_ms = 0;
   uv_async_t event_handle;
-  list<InputKeyEvent*> key_events;
-  list<InputGestureEvent*> gesture_events;
-  uv_mutex_t event_mutex;
+  /** pushed by the listener thread only, drained on the loop thread */
+  InputEventRing ring;
+  /** set once an event is pushed to `ring`, signaled once per iteration */
+  bool signal_pending = false;
+  /** the resolution rules, guarded by `rules_mutex` */
+  uv_mutex_t rules_mutex;
+  int longpress_window = 0;
+  std::vector<InputKeyRule> rules;
+  /** keys being held, only accessed on the listener thread */
+  InputHeldKey held[INPUT_HELD_KEYS_MAX];
+  int held_count = 0;
+  /** backing store of `jbatch`, reused by each delivery */
+  InputEventRecord batch[INPUT_EVENT_RING_SIZE];
+  jerry_value_t jbatch;
+  /** the trace being recorded, guarded by `trace_mutex` */
+  uv_mutex_t trace_mutex;
+  FILE* trace_file = NULL;
+  uint64_t trace_start_us = 0;
+  /** the trace being replayed */
+  bool replaying = false;
+  uv_thread_t replay_thread;
+  std::vector<InputTraceEntry> replay_entries;
+  /**
+   * replayed events, pushed by the replay thread only and drained by the
+   * listener thread, which is the only producer of `ring`
+   */
+  InputEventRing inject_ring;
+  double replay_speed = 1;
+  /** signaled by `stop()` to cut the waits of the replay thread short */
+  uv_mutex_t replay_mutex;
+  uv_cond_t replay_cond;
+  std::atomic<bool> replay_done;
+  std::atomic<uint32_t> replay_injected;
+
+  bool watchDevices();
+  void closeDevices();
+  int waitReadiness(int timeout);
+  void listen();
+  void wakeInjected();
+  void waitReplay(uint64_t until_us);
+  void drainInjected();
+  void intake(const InputEventRecord& record, bool injected);
+  void resolveKey(const InputEventRecord& record);
+  void resolveGesture(const InputEventRecord& record);
+  bool debounced(int32_t key_code, int32_t event, uint64_t mono_us);
+  bool prevents(int32_t key_code, int32_t time_delta);
+  void tickKeys(uint64_t now_us);
+  int nextTimeout(uint64_t now_ms);
+  void emit(const InputEventRecord& record);
+  void flush();
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,173 @@
+'use strict'
+
+/**
+ * @module @yoda/input/trace
+ * @description Binary traces of input events. A trace is a header of
+ * `[magic, stride]` followed by entries of `stride` int32 in host byte order:
+ * `[sec, usec]` relative to the first entry and the packed raw event as
+ * read from the devices. Traces are recorded and replayed by
+ * {@link module:@yoda/input~InputEvent#record} and
+ * {@link module:@yoda/input~InputEvent#replay}.
+ */
+
+var fs = require('fs')
+
+var TRACE_MAGIC = 0x31544959 /** YIT1 */
+var TRACE_STRIDE = 11
+var EVENT_STRIDE = 9
+/** the capacity of the native event ring */
+var RING_SIZE = 256
+
+/**
+ * @typedef TraceEntry
+ * @property {Number} time - milliseconds since the first entry
+ * @property {Number[]} event - the packed event
+ */
+
+/**
+ * Decode a trace.
+ * @param {Buffer} buffer
+ * @returns {TraceEntry[]}
+ * @throws {Error} malformed trace
+ */
+function decode (buffer) {
+  if (buffer.length < 8 || buffer.readInt32LE(0) !== TRACE_MAGIC ||
+    buffer.readInt32LE(4) !== TRACE_STRIDE) {
+    throw new Error('malformed input trace')
+  }
+  var entries = []
+  var size = TRACE_STRIDE * 4
+  for (var offset = 8; offset + size <= buffer.length; offset += size) {
+    var event = []
+    for (var i = 0; i < EVENT_STRIDE; ++i) {
+      event.push(buffer.readInt32LE(offset + 8 + i * 4))
+    }
+    entries.push({
+      time: buffer.readInt32LE(offset) * 1000 + buffer.readInt32LE(offset + 4) / 1000,
+      event: event
+    })
+  }
+  return entries
+}
+
+/**
+ * Encode entries into a trace.
+ * @param {TraceEntry[]} entries
+ * @returns {Buffer}
+ */
+function encode (entries) {
+  var size = TRACE_STRIDE * 4
+  var buffer = Buffer.alloc(8 + entries.length * size)
+  buffer.writeInt32LE(TRACE_MAGIC, 0)
+  buffer.writeInt32LE(TRACE_STRIDE, 4)
+  entries.forEach((entry, idx) => {
+    var offset = 8 + idx * size
+    var us = Math.round(entry.time * 1000)
+    buffer.writeInt32LE(Math.floor(us / 1e6), offset)
+    buffer.writeInt32LE(us % 1e6, offset + 4)
+    for (var i = 0; i < EVENT_STRIDE; ++i) {
+      buffer.writeInt32LE(entry.event[i] || 0, offset + 8 + i * 4)
+    }
+  })
+  return buffer
+}
+
+function monotonicNow () {
+  var time = process.hrtime()
+  return time[0] * 1000 + time[1] / 1e6
+}
+
+/**
+ * A stand-in of the native `InputWrap` on hosts without input devices. It
+ * replays traces through the same `onevents` batches as the native ring,
+ * events pending over the ring capacity are dropped.
+ *
+ * @private
+ * @constructor
+ */
+function StandInWrap () {
+  this.onevents = null
+  this.onreplay = null
+  this._ring = []
+  this._dropped = 0
+  this._replaying = false
+  this._draining = false
+}
+
+StandInWrap.prototype.start = function start () {
+  return 0
+}
+
+StandInWrap.prototype.disconnect = function disconnect () {
+  return true
+}
+
+StandInWrap.prototype.record = function record () {
+  /** no events are read on hosts */
+  return 0
+}
+
+StandInWrap.prototype.replay = function replay (path, speed) {
+  if (this._replaying) {
+    return -16 /** EBUSY */
+  }
+  var entries
+  try {
+    entries = decode(fs.readFileSync(path))
+  } catch (err) {
+    return -22 /** EINVAL */
+  }
+  this._replaying = true
+  var injected = 0
+  var startedAt = monotonicNow()
+  var idx = 0
+  var inject = () => {
+    var now = monotonicNow()
+    while (idx < entries.length) {
+      var due = speed > 0 ? startedAt + entries[idx].time / speed : now
+      if (due > now) {
+        setTimeout(inject, due - now)
+        return
+      }
+      var event = entries[idx++].event.slice()
+      event[6] = Math.floor(now / 1000)
+      event[7] = Math.round((now % 1000) * 1000)
+      if (this._ring.length >= RING_SIZE) {
+        this._dropped++
+      } else {
+        this._ring.push(event)
+        injected++
+      }
+      this._scheduleDrain()
+    }
+    setImmediate(() => {
+      this._replaying = false
+      if (typeof this.onreplay === 'function') {
+        this.onreplay(injected, this._dropped)
+      }
+    })
+  }
+  inject()
+  return 0
+}
+
+StandInWrap.prototype._scheduleDrain = function _scheduleDrain () {
+  if (this._draining) {
+    return
+  }
+  this._draining = true
+  setImmediate(() => {
+    this._draining = false
+    var events = this._ring
+    this._ring = []
+    var batch = new Int32Array(events.length * EVENT_STRIDE)
+    events.forEach((it, idx) => batch.set(it, idx * EVENT_STRIDE))
+    if (events.length > 0 && typeof this.onevents === 'function') {
+      this.onevents(batch, events.length, this._dropped, monotonicNow())
+    }
+  })
+}
+
+module.exports.decode = decode
+module.exports.encode = encode
+module.exports.StandInWrap = StandInWrap
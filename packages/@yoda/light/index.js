@@ -17,10 +17,15 @@
  * - `fill()`: fill the color on all the lights, and write immediately.
  * - `pixel()`: fill the color on the given light by index.
  * - `write()`: write the current buffer.
+ *
+ * The current buffer is shared with the native renderer as `frame`, so that
+ * a whole frame could be composed with typed-array operations and rendered
+ * by one `write()`.
  */
 
 var native = require('./light.node')
 var logger = require('logger')('light')
+var program = require('./program')
 
 /**
  * Describe the hardware features for the current light.
@@ -33,15 +38,70 @@ var logger = require('logger')('light')
 
 var config = native.getProfile()
 
-var enabled = false;
+var enabled = false
+var frame = null
+/** id -> callback of the programs being played */
+var animations = {}
+/** layers of the native compositor */
+var LAYERS = 8
+var layers = []
+var correction = { alphaFactor: 1, gamma: 1, color: [ 1, 1, 1 ] };
 
 (function bootstrap () {
   native.enable()
   enabled = true
+  frame = new Uint8Array(native.getFrame())
+  native.onanimationend = function onanimationend (id, completed) {
+    var callback = animations[id]
+    delete animations[id]
+    if (typeof callback === 'function') {
+      callback(completed)
+    }
+  }
 })()
 
+function checkRendered (r) {
+  if (r !== 0) {
+    if (r === -16) {
+      // FIXME(Yorkie): this should moved to native libs.
+      logger.info('the current rendering is busy, lost this frame')
+    } else {
+      throw new Error('light value write error.')
+    }
+  }
+}
+
+function setPixel (index, red, green, blue) {
+  var pos = (index | 0) * config.format
+  frame[pos] = red
+  frame[pos + 1] = green
+  frame[pos + 2] = blue
+}
+
+function fillFrame (red, green, blue) {
+  if (red === green && green === blue) {
+    frame.fill(red)
+    return
+  }
+  for (var pos = 0; pos < frame.length; pos += config.format) {
+    frame[pos] = red
+    frame[pos + 1] = green
+    frame[pos + 2] = blue
+  }
+}
+
 module.exports = {
 
+  /**
+   * The current buffer of `leds * format` bytes, rendered by `write()`
+   * without copying.
+   * @member {Uint8Array} frame
+   * @example
+   * light.frame.set([ 255, 0, 0 ], 0) // the first led in red
+   * light.write()
+   */
+  frame: frame,
+
   /**
    * Enable the light write
    * @function enable
@@ -78,17 +138,97 @@ module.exports = {
     } else {
       r = native.render()
     }
-    if (r !== 0) {
-      if (r === -16) {
-        // FIXME(Yorkie): this should moved to native libs.
-        logger.info('the current rendering is busy, lost this frame')
-      } else {
-        throw new Error('light value write error.')
-      }
+    checkRendered(r)
+    return this
+  },
+
+  /**
+   * The number of compositor layers.
+   * @member {Number} LAYERS
+   */
+  LAYERS: LAYERS,
+
+  /**
+   * Get the RGBA buffer of `leds * 4` bytes of a compositor layer. Layers
+   * are alpha-blended in ascending order over black by `compose()`, only
+   * the layer 0 is visible by default.
+   * @function getLayer
+   * @param {Number} index - from 0 to `LAYERS - 1`.
+   * @returns {Uint8Array}
+   */
+  getLayer: function getLayer (index) {
+    if (layers[index] == null) {
+      layers[index] = new Uint8Array(native.getLayer(index))
     }
+    return layers[index]
+  },
+
+  /**
+   * Show or hide a compositor layer.
+   * @function setLayerVisible
+   * @param {Number} index
+   * @param {Boolean} visible
+   */
+  setLayerVisible: function setLayerVisible (index, visible) {
+    native.setLayerVisible(index, !!visible)
     return this
   },
 
+  /**
+   * Set the correction applied by `compose()` in the same pass as blending.
+   * @function setCorrection
+   * @param {Object} options
+   * @param {Number} [options.alphaFactor] - the global alpha factor.
+   * @param {Number} [options.gamma] - the gamma of the leds, 1 for linear.
+   * @param {Number[]} [options.color] - the factors of red, green and blue.
+   */
+  setCorrection: function setCorrection (options) {
+    correction = Object.assign({}, correction, options)
+    var color = correction.color
+    native.setCorrection(correction.alphaFactor, correction.gamma,
+      color[0], color[1], color[2])
+    return this
+  },
+
+  /**
+   * Compose the visible layers into the current buffer and render it.
+   * @function compose
+   */
+  compose: function compose () {
+    checkRendered(native.compose())
+    return this
+  },
+
+  /**
+   * @typedef DrawStats
+   * @property {Number} submitted - frames drawn by the driver.
+   * @property {Number} skipped - frames skipped as identical to the last
+   * drawn one.
+   * @property {Number} dirtyLeds - leds from the first to the last changed
+   * one, summed over the submitted frames.
+   * @property {Number} late - frames of the animator, or of a sequence
+   * paced at `maximumFps`, arrived later than `1 / maximumFps` since the
+   * previous one.
+   * @property {Number} dropped - frames missed by the late frames.
+   */
+
+  /**
+   * Get the counters of frames rendered by `write()`, `compose()` and the
+   * animator since the process started.
+   * @function getDrawStats
+   * @returns {module:@yoda/light~DrawStats}
+   */
+  getDrawStats: native.getDrawStats,
+
+  /**
+   * Get the pacing trace of the latest frames, see
+   * {@link module:@yoda/light/pacing}.
+   * @function getPacingTrace
+   * @private
+   * @returns {Float64Array}
+   */
+  getPacingTrace: native.getPacingTrace,
+
   /**
    * Get the hardware profile data
    * @function getProfile
@@ -112,7 +252,7 @@ module.exports = {
       green = Math.floor(alpha * green)
       blue = Math.floor(alpha * blue)
     }
-    native.fill(red, green, blue)
+    fillFrame(red, green, blue)
     return this
   },
 
@@ -150,7 +290,54 @@ module.exports = {
       green = Math.floor(alpha * green)
       blue = Math.floor(alpha * blue)
     }
-    native.pixel(index, red, green, blue)
+    if (index >= config.leds || index < 0) {
+      throw new RangeError('The position of the led is out of range')
+    }
+    setPixel(index, red, green, blue)
+  },
+
+  /**
+   * Play a program on the native animator, paced at `maximumFps` of the
+   * light and regardless of the event loop. A program replaces the one
+   * being played on its layer, which ends as not completed, programs of the
+   * other layers keep playing. Frames are rendered into a compositor layer
+   * and composed with the other visible layers, the last frame of a
+   * completed program is left in the layer.
+   *
+   * @function animate
+   * @param {module:@yoda/light/program~Program} program
+   * @param {Function} [callback] - `(completed)`, invoked once the program
+   * ended, `completed` is false if it was stopped or replaced.
+   * @param {Function} [applyAlpha] - maps the alpha of colors to a factor.
+   * @param {Number} [layer=0] - the compositor layer to render into.
+   * @returns {Number} the id of the program.
+   * @throws {TypeError} malformed program.
+   * @example
+   * var program = require('@yoda/light/program')
+   * light.animate(program.gradient({ r: 0, g: 0, b: 0 }, { r: 255, g: 255, b: 255 }, 500))
+   */
+  animate: function animate (prog, callback, applyAlpha, layer) {
+    var args = program.pack(prog, config, applyAlpha)
+    args.push(layer || 0)
+    var id = native.animate.apply(native, args)
+    if (id < 0) {
+      throw new TypeError(`malformed program, errno ${-id}`)
+    }
+    animations[id] = callback
+    return id
+  },
+
+  /**
+   * Stop a program, its callback is invoked with `completed` false.
+   * @function stopAnimation
+   * @param {Number} [id] - the id of the program, stops the program of
+   * `layer` if omitted.
+   * @param {Number} [layer] - the layer to stop if `id` is omitted, every
+   * layer if omitted as well.
+   * @returns {Boolean} if a program was being played.
+   */
+  stopAnimation: function stopAnimation (id, layer) {
+    return native.stopAnimation(id || 0, layer == null ? -1 : layer) === 0
   },
 
   /**
@@ -158,7 +345,7 @@ module.exports = {
    * @function clear
    */
   clear: function clearColor () {
-    native.fill(0, 0, 0)
+    frame.fill(0)
     return this
   }
 
@@ -0,0 +1,102 @@
+'use strict'
+
+/**
+ * @module @yoda/light/pacing
+ * @description Frame pacing of the light. The native renderer traces the
+ * latest frames drawn by `write()`, `compose()` and the animator: the
+ * interval since the previous frame, the duration of `lumen_draw` and if the
+ * frame arrived later than `1 / maximumFps`. Only frames of the animator or
+ * of a sequence paced at `maximumFps` may be late. The trace is collected into
+ * endoscope metrics, or dumped on demand.
+ */
+
+var fs = require('fs')
+var endoscope = require('@yoda/endoscope')
+var light = require('./index')
+
+var framePacingHistogram = new endoscope.Histogram('yodaos:light:frame_pacing', [ 'stage' ])
+var droppedFramesCounter = new endoscope.Counter('yodaos:light:dropped_frames', [])
+
+var STRIDE = 6
+var FLAG_LATE = 1
+var FLAG_SKIPPED = 2
+
+/** the seq of the latest collected entry */
+var collectedSeq = 0
+var collectedDropped = 0
+
+/**
+ * @typedef PacingEntry
+ * @property {Number} seq
+ * @property {Number} time - monotonic milliseconds of the frame.
+ * @property {Number} interval - milliseconds since the previous frame, 0 for
+ * the first frame after idle.
+ * @property {Number} duration - milliseconds of `lumen_draw`.
+ * @property {Boolean} late
+ * @property {Boolean} skipped - the frame was unchanged and not drawn.
+ * @property {Number} result - what `lumen_draw` returns.
+ */
+
+/**
+ * Get the trace of the latest frames, oldest first.
+ * @returns {module:@yoda/light/pacing~PacingEntry[]}
+ */
+function trace () {
+  var values = light.getPacingTrace()
+  var entries = []
+  for (var pos = 0; pos + STRIDE <= values.length; pos += STRIDE) {
+    entries.push({
+      seq: values[pos],
+      time: values[pos + 1],
+      interval: values[pos + 2],
+      duration: values[pos + 3],
+      late: (values[pos + 4] & FLAG_LATE) > 0,
+      skipped: (values[pos + 4] & FLAG_SKIPPED) > 0,
+      result: values[pos + 5]
+    })
+  }
+  return entries
+}
+
+/**
+ * Observe the frames since the last collection on
+ * `yodaos:light:frame_pacing`, staged `interval` and `draw`, and count the
+ * dropped frames on `yodaos:light:dropped_frames`. Frames overwritten in the
+ * trace before being collected are only counted as dropped.
+ */
+function collect () {
+  trace().forEach(it => {
+    if (it.seq <= collectedSeq) {
+      return
+    }
+    collectedSeq = it.seq
+    if (it.interval > 0) {
+      framePacingHistogram.observe({ stage: 'interval' }, it.interval)
+    }
+    if (!it.skipped) {
+      framePacingHistogram.observe({ stage: 'draw' }, it.duration)
+    }
+  })
+  var dropped = light.getDrawStats().dropped
+  if (dropped > collectedDropped) {
+    droppedFramesCounter.inc({}, dropped - collectedDropped)
+  }
+  collectedDropped = dropped
+}
+
+/**
+ * Dump the trace along with the draw stats.
+ * @param {string} [path] - if present, the dump is written to the file.
+ * @returns {object} `{ stats, trace }`
+ */
+function dump (path) {
+  var result = { stats: light.getDrawStats(), trace: trace() }
+  if (path) {
+    fs.writeFileSync(path, JSON.stringify(result))
+  }
+  return result
+}
+
+module.exports.trace = trace
+module.exports.collect = collect
+module.exports.dump = dump
@@ -0,0 +1,169 @@
+'use strict'
+
+/**
+ * @module @yoda/light/program
+ * @description Declarative animations played by the native animator of
+ * `@yoda/light` at the maximum fps of the light, see
+ * {@link module:@yoda/light.animate}.
+ *
+ * ```js
+ * var light = require('@yoda/light')
+ * var program = require('@yoda/light/program')
+ * light.animate(program.breathing({ r: 0, g: 0, b: 255 }, 2000, 3), (completed) => {
+ *   console.log('breathing ended', completed)
+ * })
+ * ```
+ */
+
+/**
+ * @typedef Keyframe
+ * @property {Number} at - the offset in a cycle in milliseconds.
+ * @property {Uint8Array|module:@yoda/light/program~Color} frame - a frame of
+ * `leds * format` bytes, or a color for all the leds.
+ */
+
+/**
+ * @typedef Color
+ * @property {Number} r
+ * @property {Number} g
+ * @property {Number} b
+ * @property {Number} [a=1]
+ */
+
+/**
+ * @typedef Program
+ * @property {module:@yoda/light/program~Keyframe[]} keyframes - ordered by `at`.
+ * @property {Number} duration - the duration of a cycle in milliseconds.
+ * @property {Number} [repeat=1] - cycles to play, 0 to play until stopped.
+ * @property {Boolean} [interpolate=false] - interpolate linearly between
+ * keyframes rather than holding each one.
+ * @property {Object} [rotation]
+ * @property {Number} rotation.interval - milliseconds per rotation step.
+ * @property {Number} [rotation.step=1] - leds per step, negative to rotate
+ * counter clockwise.
+ */
+
+/**
+ * A transition from one color to another.
+ * @param {module:@yoda/light/program~Color} from
+ * @param {module:@yoda/light/program~Color} to
+ * @param {Number} duration
+ * @returns {module:@yoda/light/program~Program}
+ */
+function gradient (from, to, duration) {
+  return {
+    keyframes: [ { at: 0, frame: from }, { at: duration, frame: to } ],
+    duration: duration,
+    repeat: 1,
+    interpolate: true
+  }
+}
+
+/**
+ * Breathes in and out a color from black.
+ * @param {module:@yoda/light/program~Color} color
+ * @param {Number} duration - the duration of a breath.
+ * @param {Number} [repeat=1] - breaths, 0 to breathe until stopped.
+ * @returns {module:@yoda/light/program~Program}
+ */
+function breathing (color, duration, repeat) {
+  var black = { r: 0, g: 0, b: 0 }
+  return {
+    keyframes: [
+      { at: 0, frame: black },
+      { at: Math.floor(duration / 2), frame: color },
+      { at: duration, frame: black }
+    ],
+    duration: duration,
+    repeat: repeat == null ? 1 : repeat,
+    interpolate: true
+  }
+}
+
+/**
+ * Rotates a frame by one led every `interval` milliseconds, a cycle is a
+ * whole revolution.
+ * @param {Uint8Array} frame
+ * @param {Number} leds - the number of leds.
+ * @param {Number} interval
+ * @param {Number} [repeat=1] - revolutions, 0 to rotate until stopped.
+ * @param {Boolean} [counterClockwise=false]
+ * @returns {module:@yoda/light/program~Program}
+ */
+function rotation (frame, leds, interval, repeat, counterClockwise) {
+  return {
+    keyframes: [ { at: 0, frame: frame } ],
+    duration: leds * interval,
+    repeat: repeat == null ? 1 : repeat,
+    rotation: { interval: interval, step: counterClockwise ? -1 : 1 }
+  }
+}
+
+function clamp (value) {
+  value = Math.floor(value)
+  return value < 0 ? 0 : (value > 255 ? 255 : value)
+}
+
+/**
+ * Pack a program into the arguments of the native animator.
+ *
+ * @private
+ * @param {module:@yoda/light/program~Program} program
+ * @param {module:@yoda/light~LightProfile} profile
+ * @param {Function} [applyAlpha] - `(alpha) => factor`, defaults to `alpha`.
+ * @returns {Array} `[frames, times, duration, repeat, interpolate,
+ * rotationInterval, rotationStep]`
+ * @throws {TypeError} malformed program.
+ */
+function pack (program, profile, applyAlpha) {
+  if (program == null || !Array.isArray(program.keyframes) || program.keyframes.length === 0) {
+    throw new TypeError('program must have keyframes')
+  }
+  if (typeof program.duration !== 'number' || program.duration < 0) {
+    throw new TypeError('program duration must be a non-negative number')
+  }
+  applyAlpha = applyAlpha || (alpha => typeof alpha === 'number' ? alpha : 1)
+  var frameSize = profile.leds * profile.format
+  var frames = new Uint8Array(program.keyframes.length * frameSize)
+  var times = []
+  program.keyframes.forEach((keyframe, idx) => {
+    var at = keyframe.at
+    if (typeof at !== 'number' || at < 0 || (idx > 0 && at < times[idx - 1])) {
+      throw new TypeError('keyframes must be ordered by non-negative offsets')
+    }
+    times.push(Math.floor(at))
+    var offset = idx * frameSize
+    var frame = keyframe.frame
+    if (frame instanceof Uint8Array) {
+      if (frame.length !== frameSize) {
+        throw new TypeError(`keyframe must be ${frameSize} bytes`)
+      }
+      frames.set(frame, offset)
+      return
+    }
+    if (frame == null || typeof frame.r !== 'number') {
+      throw new TypeError('keyframe must be a frame or a color')
+    }
+    var alpha = applyAlpha(frame.a)
+    for (var pos = offset; pos < offset + frameSize; pos += profile.format) {
+      frames[pos] = clamp(frame.r * alpha)
+      frames[pos + 1] = clamp(frame.g * alpha)
+      frames[pos + 2] = clamp(frame.b * alpha)
+    }
+  })
+  var rotation = program.rotation || {}
+  return [
+    frames,
+    times,
+    Math.floor(program.duration),
+    program.repeat == null ? 1 : Math.floor(program.repeat),
+    program.interpolate === true,
+    Math.floor(rotation.interval || 0),
+    Math.floor(rotation.step == null ? 1 : rotation.step)
+  ]
+}
+
+module.exports.gradient = gradient
+module.exports.breathing = breathing
+module.exports.rotation = rotation
+module.exports.pack = pack
@@ -0,0 +1,130 @@
+#include "LightNative.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LIGHT_COMPOSITOR_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LIGHT_COMPOSITOR_SSE2 1
+#endif
+
+/**
+ * Blends a block of RGBA pixels of `src` over `dst` by the alpha of `src`,
+ * `(s * a + d * (255 - a)) / 255` rounded for each channel.
+ */
+static inline void light_blend_block(uint8_t* dst, const uint8_t* src) {
+#if defined(LIGHT_COMPOSITOR_NEON)
+  uint8x16_t s = vld1q_u8(src);
+  uint8x16_t d = vld1q_u8(dst);
+  /** broadcasts the alpha byte of each pixel to its 4 channels */
+  uint32x4_t a32 = vshrq_n_u32(vreinterpretq_u32_u8(s), 24);
+  uint8x16_t a = vreinterpretq_u8_u32(vmulq_n_u32(a32, 0x01010101));
+  uint8x16_t ia = vmvnq_u8(a);
+  uint16x8_t lo = vmull_u8(vget_low_u8(s), vget_low_u8(a));
+  lo = vmlal_u8(lo, vget_low_u8(d), vget_low_u8(ia));
+  uint16x8_t hi = vmull_u8(vget_high_u8(s), vget_high_u8(a));
+  hi = vmlal_u8(hi, vget_high_u8(d), vget_high_u8(ia));
+  uint8x8_t out_lo = vrshrn_n_u16(vrsraq_n_u16(lo, lo, 8), 8);
+  uint8x8_t out_hi = vrshrn_n_u16(vrsraq_n_u16(hi, hi, 8), 8);
+  vst1q_u8(dst, vcombine_u8(out_lo, out_hi));
+#elif defined(LIGHT_COMPOSITOR_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(255);
+  const __m128i half = _mm_set1_epi16(128);
+  __m128i s = _mm_loadu_si128((const __m128i*)src);
+  __m128i d = _mm_loadu_si128((const __m128i*)dst);
+  __m128i out[2];
+  for (int i = 0; i < 2; ++i) {
+    __m128i s16 = i == 0 ? _mm_unpacklo_epi8(s, zero)
+                         : _mm_unpackhi_epi8(s, zero);
+    __m128i d16 = i == 0 ? _mm_unpacklo_epi8(d, zero)
+                         : _mm_unpackhi_epi8(d, zero);
+    /** broadcasts the alpha word of each pixel to its 4 channels */
+    __m128i a = _mm_shufflelo_epi16(s16, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(s16, a),
+                              _mm_mullo_epi16(d16, _mm_sub_epi16(full, a)));
+    x = _mm_add_epi16(x, half);
+    out[i] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+  }
+  _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(out[0], out[1]));
+#else
+  for (int i = 0; i < LIGHT_COMPOSITOR_BLOCK; ++i) {
+    const uint8_t* sp = src + i * 4;
+    uint8_t* dp = dst + i * 4;
+    uint32_t a = sp[3];
+    for (int c = 0; c < 4; ++c) {
+      uint32_t x = sp[c] * a + dp[c] * (255 - a) + 128;
+      dp[c] = (uint8_t)((x + (x >> 8)) >> 8);
+    }
+  }
+#endif
+}
+
+LightCompositor::LightCompositor(int led_count_, int led_bit_) {
+  led_count = led_count_;
+  led_bit = led_bit_;
+  int blocks =
+      (led_count + LIGHT_COMPOSITOR_BLOCK - 1) / LIGHT_COMPOSITOR_BLOCK;
+  layer_size = blocks * LIGHT_COMPOSITOR_BLOCK * 4;
+  layers.resize(layer_size * LIGHT_COMPOSITOR_LAYERS);
+  /** only the base layer is visible by default */
+  visible = 0x1;
+  double color[3] = { 1, 1, 1 };
+  setCorrection(1, 1, color);
+}
+
+uint8_t* LightCompositor::layer(int index) {
+  return &layers[index * layer_size];
+}
+
+void LightCompositor::setVisible(int index, bool visible_) {
+  if (visible_) {
+    visible |= 1u << index;
+  } else {
+    visible &= ~(1u << index);
+  }
+}
+
+/**
+ * Builds the lookup table of each channel,
+ * `255 * (v / 255 * alpha_factor) ^ gamma * color[c]`.
+ */
+void LightCompositor::setCorrection(double alpha_factor, double gamma,
+                                    const double color[3]) {
+  if (alpha_factor < 0) {
+    alpha_factor = 0;
+  }
+  if (gamma <= 0) {
+    gamma = 1;
+  }
+  for (int c = 0; c < 3; ++c) {
+    for (int v = 0; v < 256; ++v) {
+      double x = pow(v / 255.0 * alpha_factor, gamma) * color[c] * 255;
+      lut[c][v] = x >= 255 ? 255 : (x <= 0 ? 0 : (uint8_t)(x + 0.5));
+    }
+  }
+}
+
+void LightCompositor::compose(unsigned char* frame) {
+  uint8_t block[LIGHT_COMPOSITOR_BLOCK * 4];
+  for (int p = 0; p < led_count; p += LIGHT_COMPOSITOR_BLOCK) {
+    /** over black */
+    memset(block, 0, sizeof(block));
+    for (int z = 0; z < LIGHT_COMPOSITOR_LAYERS; ++z) {
+      if (visible & (1u << z)) {
+        light_blend_block(block, &layers[z * layer_size + p * 4]);
+      }
+    }
+    int n = led_count - p < LIGHT_COMPOSITOR_BLOCK ? led_count - p
+                                                    : LIGHT_COMPOSITOR_BLOCK;
+    for (int i = 0; i < n; ++i) {
+      unsigned char* out = frame + (p + i) * led_bit;
+      out[0] = lut[0][block[i * 4]];
+      out[1] = lut[1][block[i * 4 + 1]];
+      out[2] = lut[2][block[i * 4 + 2]];
+    }
+  }
+}
@@ -1,34 +1,386 @@
 #include "LightNative.h"
 #include <lumenflinger/LumenLight.h>
 #include <errno.h>
+#include <string.h>
 
 LumenLight light;
-char* frame = NULL;
+/**
+ * The frame is allocated once on the first enable and lives as long as the
+ * process, it's shared with JavaScript as an external ArrayBuffer.
+ */
+unsigned char* frame = NULL;
+bool enabled = false;
 int ledCount = 0;
 int ledBit = 3;
+/**
+ * serializes lumen_draw and the compositor of the loop thread and the
+ * animator
+ */
+uv_mutex_t draw_mutex;
+LightAnimator* animator = NULL;
+LightCompositor* compositor = NULL;
+jerry_value_t jexports;
+
+/**
+ * The bytes last drawn by the driver, with `draw_mutex` held. It's cleared
+ * on enable since the driver state is unknown then.
+ */
+static std::vector<unsigned char> drawn;
+static LightDrawStats draw_stats;
+
+/**
+ * The pacing trace of the frames, with `draw_mutex` held. A frame is late
+ * once it arrives half a frame budget after the budget of `1 / fps`.
+ */
+static LightPacingEntry pacing[LIGHT_PACING_TRACE_SIZE];
+static uint32_t pacing_seq = 0;
+static uint64_t pacing_last_ns = 0;
+static uint64_t pacing_last_interval_ns = 0;
+static uint64_t frame_budget_ns =
+    1000000000ULL / LIGHT_ANIMATION_DEFAULT_FPS;
+
+static void pace(uint64_t start_ns, uint64_t end_ns, int flags, int result,
+                 bool animated) {
+  uint64_t late_ns = frame_budget_ns + frame_budget_ns / 2;
+  uint64_t interval = pacing_last_ns == 0 ? 0 : start_ns - pacing_last_ns;
+  pacing_last_ns = start_ns;
+  if (interval >= LIGHT_PACING_IDLE_NS) {
+    interval = 0;
+  }
+  /**
+   * Only frames of a sequence paced at the budget are classified, that is
+   * frames of the animator or frames following one within the budget.
+   * Event-driven writes and effects slower than the fps are never late.
+   */
+  bool paced = animated || (pacing_last_interval_ns > 0 &&
+                            pacing_last_interval_ns <= late_ns);
+  pacing_last_interval_ns = interval;
+  if (paced && interval > late_ns) {
+    flags |= LIGHT_PACING_LATE;
+    draw_stats.late++;
+    /** the frames missed by rounding the interval to budgets */
+    draw_stats.dropped +=
+        (interval + frame_budget_ns / 2) / frame_budget_ns - 1;
+  }
+  LightPacingEntry* entry = &pacing[pacing_seq % LIGHT_PACING_TRACE_SIZE];
+  entry->seq = ++pacing_seq;
+  entry->time_ns = start_ns;
+  entry->interval_ns = interval;
+  entry->duration_ns = end_ns - start_ns;
+  entry->flags = flags;
+  entry->result = result;
+}
+
+/**
+ * Draws the bytes unless they are identical to the ones last drawn, with
+ * `draw_mutex` held. Returns 0 for skipped frames, or what lumen_draw
+ * returns. A failed or busy frame is not remembered, thus it's drawn again
+ * on the next call.
+ */
+static int lumen_draw_held(unsigned char* bytes, int len, bool animated) {
+  uint64_t start_ns = uv_hrtime();
+  int first = -1;
+  int last = -1;
+  if ((size_t)len == drawn.size()) {
+    for (int i = 0; i < len; ++i) {
+      if (bytes[i] != drawn[i]) {
+        first = first < 0 ? i : first;
+        last = i;
+      }
+    }
+    if (first < 0) {
+      draw_stats.skipped++;
+      pace(start_ns, start_ns, LIGHT_PACING_SKIPPED, 0, animated);
+      return 0;
+    }
+  } else {
+    first = 0;
+    last = len - 1;
+  }
+  /**
+   * LumenLight only draws whole frames, the dirty range is accounted so that
+   * the savings of a range submission are measurable.
+   */
+  int r = light.lumen_draw(bytes, len);
+  pace(start_ns, uv_hrtime(), 0, r, animated);
+  if (r == 0) {
+    drawn.assign(bytes, bytes + len);
+    draw_stats.submitted++;
+    if (ledBit > 0) {
+      draw_stats.dirty_leds += last / ledBit - first / ledBit + 1;
+    }
+  }
+  return r;
+}
+
+static int lumen_draw_locked(unsigned char* bytes, int len) {
+  uv_mutex_lock(&draw_mutex);
+  int r = lumen_draw_held(bytes, len, false);
+  uv_mutex_unlock(&draw_mutex);
+  return r;
+}
+
+LightAnimator::LightAnimator(int fps, int led_count_, int led_bit_,
+                             LightCompositor* compositor_,
+                             jerry_value_t jexports_) {
+  if (fps <= 0) {
+    fps = LIGHT_ANIMATION_DEFAULT_FPS;
+  }
+  interval_ns = 1000000000ULL / fps;
+  led_count = led_count_;
+  led_bit = led_bit_;
+  frame_size = led_count * led_bit;
+  compositor = compositor_;
+  scratch.resize(frame_size);
+  rotated.resize(frame_size);
+  composed.resize(frame_size);
+  jexports = jexports_;
+}
+
+int LightAnimator::start() {
+  uv_mutex_init(&mutex);
+  uv_cond_init(&cond);
+  end_handle.data = this;
+  uv_async_init(uv_default_loop(), &end_handle, LightAnimator::OnEnd);
+  /** never keeps the loop alive, the animator lives as long as the process */
+  uv_unref((uv_handle_t*)&end_handle);
+  return uv_thread_create(&thread, LightAnimator::Run, this);
+}
+
+/**
+ * Plays the program from now on, the program being played on its layer is
+ * ended as not completed, programs of other layers are left playing. Takes
+ * the ownership of the program and returns its id.
+ */
+int32_t LightAnimator::play(LightProgram* program) {
+  int32_t layer = program->layer;
+  uv_mutex_lock(&mutex);
+  if (current[layer] != NULL) {
+    end(layer, false);
+  }
+  program->id = next_id++;
+  current[layer] = program;
+  started_ns[layer] = uv_hrtime();
+  playing++;
+  uv_cond_signal(&cond);
+  uv_mutex_unlock(&mutex);
+  return program->id;
+}
+
+/**
+ * Stops the program of `id`, or if `id` is 0 the program of `layer` or of
+ * every layer if `layer` is negative. No frame of the stopped programs is
+ * drawn once this returns.
+ */
+int LightAnimator::stop(int32_t id, int32_t layer) {
+  uv_mutex_lock(&mutex);
+  int r = -ENOENT;
+  for (int32_t i = 0; i < LIGHT_COMPOSITOR_LAYERS; ++i) {
+    if (current[i] == NULL) {
+      continue;
+    }
+    if (id == 0 ? (layer < 0 || layer == i) : current[i]->id == id) {
+      end(i, false);
+      r = 0;
+    }
+  }
+  uv_mutex_unlock(&mutex);
+  return r;
+}
+
+/**
+ * Ends the program of the layer, with `mutex` held.
+ */
+void LightAnimator::end(int32_t layer, bool completed) {
+  LightAnimationEnd it = { current[layer]->id, completed };
+  ended.push_back(it);
+  delete current[layer];
+  current[layer] = NULL;
+  playing--;
+  uv_async_send(&end_handle);
+}
+
+/**
+ * Renders the program at `elapsed_ms` into the RGBA `layer` as opaque
+ * pixels, returns true if the program has been completed, in which case its
+ * last frame is rendered and left in the layer.
+ */
+bool LightAnimator::render(const LightProgram& program, uint64_t elapsed_ms,
+                           uint8_t* layer) {
+  bool completed = false;
+  uint64_t t = 0;
+  if (program.repeat > 0 &&
+      elapsed_ms >= (uint64_t)program.duration * program.repeat) {
+    completed = true;
+    t = program.duration;
+  } else if (program.duration > 0) {
+    t = elapsed_ms % program.duration;
+  }
+
+  size_t count = program.times.size();
+  size_t idx = 0;
+  while (idx + 1 < count && program.times[idx + 1] <= t) {
+    idx++;
+  }
+  const uint8_t* from = &program.frames[idx * frame_size];
+  if (program.interpolate && idx + 1 < count && t >= program.times[idx]) {
+    const uint8_t* to = &program.frames[(idx + 1) * frame_size];
+    uint32_t span = program.times[idx + 1] - program.times[idx];
+    /** weight in 1/256 */
+    int32_t weight = (int32_t)((t - program.times[idx]) * 256 / span);
+    for (size_t i = 0; i < frame_size; ++i) {
+      int32_t delta = ((int32_t)to[i] - from[i]) * weight / 256;
+      scratch[i] = (uint8_t)(from[i] + delta);
+    }
+  } else {
+    memcpy(scratch.data(), from, frame_size);
+  }
+
+  if (program.rotation_interval > 0 && led_count > 0) {
+    int64_t steps = (int64_t)(t / program.rotation_interval);
+    int32_t offset = (int32_t)((steps * program.rotation_step) % led_count);
+    if (offset < 0) {
+      offset += led_count;
+    }
+    for (int i = 0; i < led_count; ++i) {
+      memcpy(&rotated[((i + offset) % led_count) * led_bit],
+             &scratch[i * led_bit], led_bit);
+    }
+    scratch.swap(rotated);
+  }
+
+  for (int i = 0; i < led_count; ++i) {
+    memcpy(&layer[i * 4], &scratch[i * led_bit], 3);
+    layer[i * 4 + 3] = 255;
+  }
+  return completed;
+}
+
+void LightAnimator::Run(void* arg) {
+  LightAnimator* animator = (LightAnimator*)arg;
+  uint64_t deadline = 0;
+  uv_mutex_lock(&animator->mutex);
+  while (true) {
+    while (animator->playing == 0) {
+      uv_cond_wait(&animator->cond, &animator->mutex);
+      deadline = 0;
+    }
+    uint64_t now = uv_hrtime();
+    LightCompositor* compositor = animator->compositor;
+    bool completed[LIGHT_COMPOSITOR_LAYERS] = {};
+    /**
+     * renders and draws with `mutex` held, so that a stopped program never
+     * draws over the frames rendered after it, and with `draw_mutex` held
+     * so that `compose()` of the loop thread never sees a partial layer.
+     */
+    uv_mutex_lock(&draw_mutex);
+    for (int32_t i = 0; i < LIGHT_COMPOSITOR_LAYERS; ++i) {
+      LightProgram* program = animator->current[i];
+      if (program != NULL) {
+        completed[i] =
+            animator->render(*program,
+                             (now - animator->started_ns[i]) / 1000000,
+                             compositor->layer(i));
+      }
+    }
+    compositor->compose(animator->composed.data());
+    int r = lumen_draw_held(animator->composed.data(), animator->frame_size,
+                            true);
+    uv_mutex_unlock(&draw_mutex);
+    if (r != 0 && r != -EBUSY) {
+      fprintf(stderr, "lumen_draw failed on animation, it returns %d\n", r);
+    }
+    for (int32_t i = 0; i < LIGHT_COMPOSITOR_LAYERS; ++i) {
+      if (completed[i]) {
+        animator->end(i, true);
+      }
+    }
+    if (animator->playing == 0) {
+      continue;
+    }
+    /** paces at the fps, late frames are skipped rather than queued */
+    deadline = deadline == 0 ? now + animator->interval_ns
+                             : deadline + animator->interval_ns;
+    now = uv_hrtime();
+    if (deadline <= now) {
+      deadline = now + animator->interval_ns;
+    }
+    uv_cond_timedwait(&animator->cond, &animator->mutex, deadline - now);
+  }
+  uv_mutex_unlock(&animator->mutex);
+}
+
+void LightAnimator::OnEnd(uv_async_t* async) {
+  LightAnimator* animator = (LightAnimator*)async->data;
+  std::vector<LightAnimationEnd> ended;
+  uv_mutex_lock(&animator->mutex);
+  ended.swap(animator->ended);
+  uv_mutex_unlock(&animator->mutex);
+
+  jerry_value_t onend =
+      iotjs_jval_get_property(animator->jexports, "onanimationend");
+  if (jerry_value_is_function(onend)) {
+    for (auto& it : ended) {
+      iotjs_jargs_t jargs = iotjs_jargs_create(2);
+      iotjs_jargs_append_number(&jargs, (double)it.id);
+      iotjs_jargs_append_bool(&jargs, it.completed);
+      iotjs_make_callback(onend, jerry_create_undefined(), &jargs);
+      iotjs_jargs_destroy(&jargs);
+    }
+  }
+  jerry_release_value(onend);
+}
 
 JS_FUNCTION(Enable) {
   light.lumen_set_enable(true);
-  ledCount = light.getLedCount();
-  ledBit = light.getPixelFormat();
-  if (ledCount <= 0) {
-    return JS_CREATE_ERROR(RANGE, "Can't get the number of leds");
+  uv_mutex_lock(&draw_mutex);
+  drawn.clear();
+  uv_mutex_unlock(&draw_mutex);
+  if (frame == NULL) {
+    ledCount = light.getLedCount();
+    ledBit = light.getPixelFormat();
+    if (ledCount <= 0) {
+      return JS_CREATE_ERROR(RANGE, "Can't get the number of leds");
+    }
+    frame = new unsigned char[ledCount * ledBit]();
+    if (light.getFps() > 0) {
+      frame_budget_ns = 1000000000ULL / light.getFps();
+    }
+    compositor = new LightCompositor(ledCount, ledBit);
+    animator = new LightAnimator(light.getFps(), ledCount, ledBit, compositor,
+                                 jexports);
+    animator->start();
   }
-  frame = new char[ledCount * ledBit];
+  enabled = true;
   return jerry_create_boolean(true);
 }
 
 JS_FUNCTION(Disable) {
+  if (animator != NULL) {
+    animator->stop(0, -1);
+  }
   light.lumen_set_enable(false);
-  delete frame;
+  enabled = false;
   return jerry_create_boolean(true);
 }
 
+/*
+ * ArrayBuffer getFrame(), the `ledCount * ledBit` bytes rendered by
+ * `render()`.
+ */
+JS_FUNCTION(GetFrame) {
+  if (NULL == frame) {
+    return JS_CREATE_ERROR(COMMON,
+                           "LumenLight is disabled, please enable first")
+  }
+  return jerry_create_arraybuffer_external(ledCount * ledBit, frame, NULL);
+}
+
 JS_FUNCTION(Write) {
   iotjs_bufferwrap_t* buffer = iotjs_bufferwrap_from_jbuffer(jargv[0]);
   int srclen = (int)iotjs_bufferwrap_length(buffer);
   unsigned char* bytes = (unsigned char*)iotjs_bufferwrap_buffer(buffer);
-  int r = light.lumen_draw(bytes, srclen + 1);
+  int r = lumen_draw_locked(bytes, srclen);
   if (r != 0) {
     fprintf(stderr, "lumen_draw failed, it returns %d, (%d)%s\n", r, errno,
             strerror(errno));
@@ -37,11 +389,11 @@ JS_FUNCTION(Write) {
 }
 
 JS_FUNCTION(Render) {
-  if (NULL == frame) {
+  if (!enabled) {
     return JS_CREATE_ERROR(COMMON,
                            "LumenLight is disabled, please enable first")
   }
-  int r = light.lumen_draw((unsigned char*)frame, ledCount * ledBit);
+  int r = lumen_draw_locked(frame, ledCount * ledBit);
   if (r != 0) {
     fprintf(stderr, "lumen_draw failed, it returns %d, (%d)%s\n", r, errno,
             strerror(errno));
@@ -49,6 +401,58 @@ JS_FUNCTION(Render) {
   return jerry_create_number(r);
 }
 
+/*
+ * object getDrawStats(), the counters of frames drawn and skipped as
+ * unchanged since the process started.
+ */
+JS_FUNCTION(GetDrawStats) {
+  uv_mutex_lock(&draw_mutex);
+  LightDrawStats stats = draw_stats;
+  uv_mutex_unlock(&draw_mutex);
+  jerry_value_t jstats = jerry_create_object();
+  iotjs_jval_set_property_number(jstats, "submitted", (double)stats.submitted);
+  iotjs_jval_set_property_number(jstats, "skipped", (double)stats.skipped);
+  iotjs_jval_set_property_number(jstats, "dirtyLeds",
+                                 (double)stats.dirty_leds);
+  iotjs_jval_set_property_number(jstats, "late", (double)stats.late);
+  iotjs_jval_set_property_number(jstats, "dropped", (double)stats.dropped);
+  return jstats;
+}
+
+/*
+ * Float64Array getPacingTrace(), the pacing entries of the latest frames
+ * in `LIGHT_PACING_STRIDE`, oldest first.
+ */
+JS_FUNCTION(GetPacingTrace) {
+  uv_mutex_lock(&draw_mutex);
+  uint32_t count = pacing_seq < LIGHT_PACING_TRACE_SIZE
+                       ? pacing_seq
+                       : LIGHT_PACING_TRACE_SIZE;
+  std::vector<double> values(count * LIGHT_PACING_STRIDE);
+  for (uint32_t i = 0; i < count; ++i) {
+    const LightPacingEntry& entry =
+        pacing[(pacing_seq - count + i) % LIGHT_PACING_TRACE_SIZE];
+    double* it = &values[i * LIGHT_PACING_STRIDE];
+    it[0] = entry.seq;
+    it[1] = entry.time_ns / 1e6;
+    it[2] = entry.interval_ns / 1e6;
+    it[3] = entry.duration_ns / 1e6;
+    it[4] = entry.flags;
+    it[5] = entry.result;
+  }
+  uv_mutex_unlock(&draw_mutex);
+
+  jerry_value_t jtrace =
+      jerry_create_typedarray(JERRY_TYPEDARRAY_FLOAT64, values.size());
+  jerry_length_t offset = 0;
+  jerry_length_t length = 0;
+  jerry_value_t jbuffer = jerry_get_typedarray_buffer(jtrace, &offset, &length);
+  jerry_arraybuffer_write(jbuffer, offset, (uint8_t*)values.data(),
+                          values.size() * sizeof(double));
+  jerry_release_value(jbuffer);
+  return jtrace;
+}
+
 JS_FUNCTION(GetProfile) {
   jerry_value_t profile = jerry_create_object();
   iotjs_jval_set_property_number(profile, "leds", light.getLedCount());
@@ -63,53 +467,168 @@ JS_FUNCTION(GetProfile) {
 }
 
 /*
- * boolean pixel(pos, r, g, b)
+ * ArrayBuffer getLayer(index), the RGBA buffer of the compositor layer.
  */
-JS_FUNCTION(Pixel) {
-  if (NULL == frame) {
+JS_FUNCTION(GetLayer) {
+  DJS_CHECK_ARGS(1, number);
+  if (compositor == NULL) {
     return JS_CREATE_ERROR(COMMON,
                            "LumenLight is disabled, please enable first")
   }
-  int pos = jerry_get_number_value(jargv[0]);
-  if (pos >= ledCount || pos < 0) {
-    return JS_CREATE_ERROR(RANGE, "The position of the led is out of range");
-  }
-  pos = pos * ledBit;
-  int r = jerry_get_number_value(jargv[1]);
-  int g = jerry_get_number_value(jargv[2]);
-  int b = jerry_get_number_value(jargv[3]);
-  frame[pos] = r;
-  frame[pos + 1] = g;
-  frame[pos + 2] = b;
+  int index = JS_GET_ARG(0, number);
+  if (index < 0 || index >= LIGHT_COMPOSITOR_LAYERS) {
+    return JS_CREATE_ERROR(RANGE, "The layer is out of range");
+  }
+  return jerry_create_arraybuffer_external(ledCount * 4,
+                                           compositor->layer(index), NULL);
+}
+
+/*
+ * setLayerVisible(index, visible)
+ */
+JS_FUNCTION(SetLayerVisible) {
+  DJS_CHECK_ARGS(2, number, boolean);
+  int index = JS_GET_ARG(0, number);
+  if (compositor == NULL || index < 0 || index >= LIGHT_COMPOSITOR_LAYERS) {
+    return JS_CREATE_ERROR(RANGE, "The layer is out of range");
+  }
+  uv_mutex_lock(&draw_mutex);
+  compositor->setVisible(index, JS_GET_ARG(1, boolean));
+  uv_mutex_unlock(&draw_mutex);
   return jerry_create_undefined();
 }
 
-JS_FUNCTION(Fill) {
-  if (NULL == frame) {
+/*
+ * setCorrection(alphaFactor, gamma, red, green, blue)
+ */
+JS_FUNCTION(SetCorrection) {
+  DJS_CHECK_ARGS(5, number, number, number, number, number);
+  if (compositor == NULL) {
     return JS_CREATE_ERROR(COMMON,
                            "LumenLight is disabled, please enable first")
   }
-  int r = jerry_get_number_value(jargv[0]);
-  int g = jerry_get_number_value(jargv[1]);
-  int b = jerry_get_number_value(jargv[2]);
-  int pos = 0;
-  for (int i = 0; i < ledCount; i++) {
-    pos = i * ledBit;
-    frame[pos] = r;
-    frame[pos + 1] = g;
-    frame[pos + 2] = b;
-  }
+  double color[3] = { JS_GET_ARG(2, number), JS_GET_ARG(3, number),
+                      JS_GET_ARG(4, number) };
+  uv_mutex_lock(&draw_mutex);
+  compositor->setCorrection(JS_GET_ARG(0, number), JS_GET_ARG(1, number),
+                            color);
+  uv_mutex_unlock(&draw_mutex);
   return jerry_create_undefined();
 }
 
+/*
+ * number compose(), composes the layers into the frame and renders it. The
+ * layers written by JavaScript are not guarded, a program being played picks
+ * them up no later than its next frame.
+ */
+JS_FUNCTION(Compose) {
+  if (!enabled || compositor == NULL) {
+    return JS_CREATE_ERROR(COMMON,
+                           "LumenLight is disabled, please enable first")
+  }
+  uv_mutex_lock(&draw_mutex);
+  compositor->compose(frame);
+  int r = lumen_draw_held(frame, ledCount * ledBit, false);
+  uv_mutex_unlock(&draw_mutex);
+  if (r != 0) {
+    fprintf(stderr, "lumen_draw failed, it returns %d, (%d)%s\n", r, errno,
+            strerror(errno));
+  }
+  return jerry_create_number(r);
+}
+
+/*
+ * number animate(frames, times, duration, repeat, interpolate,
+ *                rotationInterval, rotationStep, layer)
+ *
+ * `frames` is an Uint8Array of keyframes, `times` the offset of each
+ * keyframe. Returns the id of the program, or a negative errno.
+ */
+JS_FUNCTION(Animate) {
+  DJS_CHECK_ARGS(7, object, array, number, number, boolean, number, number);
+  if (!enabled || animator == NULL) {
+    return JS_CREATE_ERROR(COMMON,
+                           "LumenLight is disabled, please enable first")
+  }
+  if (!jerry_value_is_typedarray(jargv[0])) {
+    return jerry_create_number(-EINVAL);
+  }
+  int32_t layer = 0;
+  if (jargc > 7 && jerry_value_is_number(jargv[7])) {
+    layer = (int32_t)jerry_get_number_value(jargv[7]);
+  }
+  if (layer < 0 || layer >= LIGHT_COMPOSITOR_LAYERS) {
+    return jerry_create_number(-EINVAL);
+  }
+  size_t frame_size = ledCount * ledBit;
+  uint32_t count = jerry_get_array_length(jargv[1]);
+  jerry_length_t offset = 0;
+  jerry_length_t length = 0;
+  jerry_value_t jbuffer =
+      jerry_get_typedarray_buffer(jargv[0], &offset, &length);
+  if (count == 0 || length != count * frame_size) {
+    jerry_release_value(jbuffer);
+    return jerry_create_number(-EINVAL);
+  }
+
+  LightProgram* program = new LightProgram();
+  program->frames.resize(length);
+  jerry_arraybuffer_read(jbuffer, offset, program->frames.data(), length);
+  jerry_release_value(jbuffer);
+  for (uint32_t i = 0; i < count; ++i) {
+    jerry_value_t jtime = jerry_get_property_by_index(jargv[1], i);
+    double time = jerry_value_is_number(jtime) ? jerry_get_number_value(jtime)
+                                                : -1;
+    jerry_release_value(jtime);
+    if (time < 0 || (i > 0 && time < program->times[i - 1])) {
+      delete program;
+      return jerry_create_number(-EINVAL);
+    }
+    program->times.push_back((uint32_t)time);
+  }
+  program->duration = (uint32_t)JS_GET_ARG(2, number);
+  program->repeat = (int32_t)JS_GET_ARG(3, number);
+  program->interpolate = JS_GET_ARG(4, boolean);
+  program->rotation_interval = (uint32_t)JS_GET_ARG(5, number);
+  program->rotation_step = (int32_t)JS_GET_ARG(6, number);
+  program->layer = layer;
+  return jerry_create_number(animator->play(program));
+}
+
+/*
+ * number stopAnimation(id, layer), 0 stops the program of `layer`, or of
+ * every layer if `layer` is omitted.
+ */
+JS_FUNCTION(StopAnimation) {
+  DJS_CHECK_ARGS(1, number);
+  if (animator == NULL) {
+    return jerry_create_number(-ENOENT);
+  }
+  int32_t id = (int32_t)JS_GET_ARG(0, number);
+  int32_t layer = -1;
+  if (jargc > 1 && jerry_value_is_number(jargv[1])) {
+    layer = (int32_t)jerry_get_number_value(jargv[1]);
+  }
+  return jerry_create_number(animator->stop(id, layer));
+}
+
 void init(jerry_value_t exports) {
+  uv_mutex_init(&draw_mutex);
+  jexports = jerry_acquire_value(exports);
   iotjs_jval_set_method(exports, "enable", Enable);
   iotjs_jval_set_method(exports, "disable", Disable);
   iotjs_jval_set_method(exports, "getProfile", GetProfile);
   iotjs_jval_set_method(exports, "write", Write);
   iotjs_jval_set_method(exports, "render", Render);
-  iotjs_jval_set_method(exports, "pixel", Pixel);
-  iotjs_jval_set_method(exports, "fill", Fill);
+  iotjs_jval_set_method(exports, "getFrame", GetFrame);
+  iotjs_jval_set_method(exports, "getDrawStats", GetDrawStats);
+  iotjs_jval_set_method(exports, "getPacingTrace", GetPacingTrace);
+  iotjs_jval_set_method(exports, "getLayer", GetLayer);
+  iotjs_jval_set_method(exports, "setLayerVisible", SetLayerVisible);
+  iotjs_jval_set_method(exports, "setCorrection", SetCorrection);
+  iotjs_jval_set_method(exports, "compose", Compose);
+  iotjs_jval_set_method(exports, "animate", Animate);
+  iotjs_jval_set_method(exports, "stopAnimation", StopAnimation);
 }
 
 NODE_MODULE(light, init)
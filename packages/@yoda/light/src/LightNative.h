@@ -2,6 +2,8 @@
 #define LIGHT_NATIVE_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <vector>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +13,7 @@ extern "C" {
 #include <iotjs_def.h>
 #include <iotjs_binding.h>
 #include <iotjs_objectwrap.h>
+#include <uv.h>
 
 typedef struct {
   iotjs_jobjectwrap_t jobjectwrap;
@@ -23,6 +26,152 @@ extern iotjs_bufferwrap_t* iotjs_bufferwrap_from_jbuffer(
 extern char* iotjs_bufferwrap_buffer(iotjs_bufferwrap_t* bufferwrap);
 extern size_t iotjs_bufferwrap_length(iotjs_bufferwrap_t* bufferwrap);
 
+/**
+ * Counters of `lumen_draw`, `dirty_leds` sums the leds from the first to the
+ * last changed one of each submitted frame.
+ */
+typedef struct {
+  uint64_t submitted;
+  uint64_t skipped;
+  uint64_t dirty_leds;
+  uint64_t late;
+  uint64_t dropped;
+} LightDrawStats;
+
+/** the capacity of the pacing trace */
+#define LIGHT_PACING_TRACE_SIZE 256
+/**
+ * `[seq, time, interval, duration, flags, result]` of a pacing entry, times
+ * in milliseconds on the monotonic clock.
+ */
+#define LIGHT_PACING_STRIDE 6
+#define LIGHT_PACING_LATE 1
+#define LIGHT_PACING_SKIPPED 2
+/**
+ * Frames after a longer gap start a new sequence, they are neither late nor
+ * measured for the interval.
+ */
+#define LIGHT_PACING_IDLE_NS 1000000000ULL
+
+typedef struct {
+  uint32_t seq;
+  uint64_t time_ns;
+  uint64_t interval_ns;
+  uint64_t duration_ns;
+  int32_t flags;
+  int32_t result;
+} LightPacingEntry;
+
+/** used if the light reports no fps */
+#define LIGHT_ANIMATION_DEFAULT_FPS 30
+
+/**
+ * A declarative animation: keyframes at millisecond offsets of a cycle, held
+ * or linearly interpolated, optionally rotated by `rotation_step` leds every
+ * `rotation_interval` milliseconds. A cycle lasts `duration` milliseconds
+ * and is played `repeat` times, 0 for ever.
+ */
+class LightProgram {
+ public:
+  int32_t id = 0;
+  /** keyframes of `ledCount * ledBit` bytes each */
+  std::vector<uint8_t> frames;
+  std::vector<uint32_t> times;
+  uint32_t duration = 0;
+  int32_t repeat = 1;
+  bool interpolate = false;
+  uint32_t rotation_interval = 0;
+  int32_t rotation_step = 0;
+  /** the compositor layer the program is rendered into */
+  int32_t layer = 0;
+};
+
+typedef struct {
+  int32_t id;
+  bool completed;
+} LightAnimationEnd;
+
+/**
+ * Layers of the compositor, blended in ascending order over black.
+ */
+#define LIGHT_COMPOSITOR_LAYERS 8
+/** pixels blended at a time by the SIMD kernels */
+#define LIGHT_COMPOSITOR_BLOCK 4
+
+/**
+ * Alpha-blends RGBA layers in z-order and applies the global alpha factor,
+ * the gamma and the color correction by one lookup table in the same pass.
+ */
+class LightCompositor {
+ public:
+  LightCompositor(int led_count, int led_bit);
+
+  /** the RGBA buffer of `led_count * 4` bytes of the layer */
+  uint8_t* layer(int index);
+  void setVisible(int index, bool visible);
+  void setCorrection(double alpha_factor, double gamma, const double color[3]);
+  /** composes the visible layers into the `led_count * led_bit` frame */
+  void compose(unsigned char* frame);
+
+ private:
+  int led_count;
+  int led_bit;
+  /** layers are padded to whole blocks */
+  size_t layer_size;
+  std::vector<uint8_t> layers;
+  uint32_t visible;
+  uint8_t lut[3][256];
+};
+
+/**
+ * Plays one program per compositor layer on a dedicated thread paced at the
+ * maximum fps of the light, the loop thread only starts and stops programs
+ * and is notified of their ends by `onanimationend(id, completed)` of the
+ * exports. The programs of all layers are rendered and composed into one
+ * frame per tick, thus overlays are animated on top of animations.
+ */
+class LightAnimator {
+ public:
+  LightAnimator(int fps, int led_count, int led_bit,
+                LightCompositor* compositor, jerry_value_t jexports);
+
+  int start();
+  int32_t play(LightProgram* program);
+  int stop(int32_t id, int32_t layer);
+
+ public:
+  static void Run(void* arg);
+  static void OnEnd(uv_async_t* async);
+
+ private:
+  bool render(const LightProgram& program, uint64_t elapsed_ms,
+              uint8_t* layer);
+  void end(int32_t layer, bool completed);
+
+  uint64_t interval_ns;
+  int led_count;
+  int led_bit;
+  size_t frame_size;
+  LightCompositor* compositor;
+  std::vector<uint8_t> scratch;
+  std::vector<uint8_t> rotated;
+  /** the composed frame, apart from the frame of `render()` */
+  std::vector<uint8_t> composed;
+  jerry_value_t jexports;
+
+  uv_thread_t thread;
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  uv_async_t end_handle;
+  /** guarded by `mutex` */
+  LightProgram* current[LIGHT_COMPOSITOR_LAYERS] = {};
+  uint64_t started_ns[LIGHT_COMPOSITOR_LAYERS] = {};
+  /** the number of layers being played */
+  int playing = 0;
+  int32_t next_id = 1;
+  std::vector<LightAnimationEnd> ended;
+};
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,119 @@
+'use strict'
+
+/**
+ * @module @yoda/ota/downloader
+ */
+
+var EventEmitter = require('events').EventEmitter
+var inherits = require('util').inherits
+var native = require('./downloader.node')
+
+/**
+ * @typedef DownloadResult
+ * @property {number} size - the size of the downloaded image.
+ * @property {string} md5 - the md5 hex digest of the image, hashed while
+ * streaming.
+ */
+
+/**
+ * A running download.
+ * @constructor
+ * @augments EventEmitter
+ * @private
+ */
+function Download () {
+  EventEmitter.call(this)
+  this._handle = null
+}
+inherits(Download, EventEmitter)
+
+/**
+ * Abort the download. What has been downloaded is kept and would be resumed
+ * by the next download to the same destination.
+ */
+Download.prototype.abort = function abort () {
+  if (this._handle) {
+    native.abort(this._handle)
+  }
+}
+
+/**
+ * @typedef ThrottleState
+ * @property {number} rate - the effective rate in bytes/s, 0 for unlimited.
+ * @property {number} rateLimit - the configured rate limit in bytes/s.
+ * @property {boolean} yielding - if the download is yielding to interactive
+ * traffic.
+ * @property {number} paused - connections paused by the rate limit.
+ * @property {number} throttled - accumulated time in milliseconds while any
+ * connection was paused by the rate limit.
+ * @property {number} downloaded - bytes downloaded.
+ */
+
+/**
+ * Update the rate limit or the yielding state of the download.
+ *
+ * @param {object} throttle
+ * @param {number} [throttle.rateLimit] - bytes/s, 0 for unlimited.
+ * @param {boolean} [throttle.yielding] - caps the rate to `yieldRate` to
+ * leave the bandwidth to interactive traffic.
+ */
+Download.prototype.setThrottle = function setThrottle (throttle) {
+  if (this._handle) {
+    native.setThrottle(this._handle, throttle)
+  }
+}
+
+/**
+ * Get the throttle state of the download.
+ *
+ * @returns {ThrottleState|undefined} undefined if the download has finished.
+ */
+Download.prototype.getThrottle = function getThrottle () {
+  if (this._handle) {
+    return native.getThrottle(this._handle)
+  }
+}
+
+/**
+ * Download the image over several parallel http range connections into a
+ * preallocated file. The md5 digest is computed while streaming, and the
+ * progress of each range is persisted to `<dest>.progress` so that the
+ * download could be resumed after a power cut.
+ *
+ * @param {string} url
+ * @param {string} dest
+ * @param {object} [options]
+ * @param {number} [options.connections=4] - max parallel range connections.
+ * @param {number} [options.retries=3] - retries of each range on failures.
+ * @param {number} [options.timeout=15] - connect and stall timeout in seconds.
+ * @param {boolean} [options.noCheckCertificate]
+ * @param {number} [options.checkpointInterval=1048576] - bytes downloaded
+ * between two persisted checkpoints.
+ * @param {number} [options.rateLimit=0] - bytes/s, 0 for unlimited. The rate
+ * is shaped with a token bucket shared by all connections.
+ * @param {number} [options.yieldRate=16384] - bytes/s while yielding to
+ * interactive traffic. Connections are slowed down instead of being paused
+ * so that they are not closed by the server.
+ * @param {boolean} [options.yielding=false] - starts yielding.
+ * @param {Function} callback - `(err, result: DownloadResult)`.
+ * @returns {Download} emits `progress` with `(downloaded, total)`, where
+ * `total` is -1 if the image size is unknown.
+ */
+function download (url, dest, options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = {}
+  }
+  var task = new Download()
+  task._handle = native.download(url, dest, options || {},
+    function onProgress (downloaded, total) {
+      task.emit('progress', downloaded, total)
+    },
+    function onDone (err, result) {
+      task._handle = null
+      callback(err, result)
+    })
+  return task
+}
+
+module.exports.download = download
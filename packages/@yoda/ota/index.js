@@ -56,7 +56,8 @@ function cleanImages (callback) {
     files = files
       .filter(it => {
         var extname = path.extname(it)
-        return extname === '.img'
+        /** `.progress` files are checkpoints of partially downloaded images */
+        return extname === '.img' || extname === '.progress'
       })
       .map(it => path.join(constants.upgradeDir, it))
 
@@ -0,0 +1,1011 @@
+#include <curl/curl.h>
+#include <common.h>
+#include <node_api.h>
+#include <uv.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "md5.h"
+
+using namespace std;
+
+#define DOWNLOAD_CHECKPOINT_MAGIC 0x59444c31 /* YDL1 */
+#define DOWNLOAD_MAX_CONNECTIONS 8
+#define DOWNLOAD_MIN_RANGE_SIZE (256 * 1024)
+#define DOWNLOAD_HASH_CHUNK_SIZE (64 * 1024)
+#define DOWNLOAD_PROGRESS_INTERVAL_NS (200 * 1000 * 1000)
+/** interval to refill the token bucket while connections are paused */
+#define DOWNLOAD_THROTTLE_TICK_MS 50
+/** lower bound of the bucket capacity, a curl write is up to 16 KiB */
+#define DOWNLOAD_BUCKET_MIN_SIZE (16 * 1024)
+
+struct DownloadRange {
+  int64_t start;
+  /** inclusive, -1 if the size is unknown */
+  int64_t end;
+  /** next byte to be written */
+  int64_t offset;
+};
+
+/**
+ * On-disk layout of the `<dest>.progress` file. The image is synced before
+ * the checkpoint is written, so that offsets never run ahead of the durable
+ * data after a power cut.
+ */
+struct DownloadCheckpoint {
+  uint32_t magic;
+  uint32_t count;
+  int64_t size;
+  uint64_t urlHash;
+  int64_t hashed;
+  md5_ctx_t md5;
+  DownloadRange ranges[DOWNLOAD_MAX_CONNECTIONS];
+};
+
+class Downloader;
+
+struct DownloadConnection {
+  Downloader* downloader;
+  size_t index;
+  CURL* easy = nullptr;
+  int retries = 0;
+  /** the offset the current request starts from */
+  int64_t from = 0;
+  /** paused by the token bucket */
+  bool paused = false;
+};
+
+/**
+ * FNV-1a hash of the url path. The host and the query string are skipped as
+ * the same image could be served by different mirrors with signatures that
+ * differ on each fetch.
+ */
+static uint64_t hashUrl(const string& url) {
+  uint64_t hash = 14695981039346656037ULL;
+  size_t start = url.find("://");
+  start = url.find('/', start == string::npos ? 0 : start + 3);
+  if (start == string::npos) {
+    return hash;
+  }
+  for (size_t i = start; i < url.size() && url[i] != '?'; ++i) {
+    hash ^= (uint8_t)url[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+class Downloader {
+ public:
+  /** options */
+  string url;
+  string dest;
+  string checkpointPath;
+  int connections = 4;
+  int retries = 3;
+  long timeout = 15;
+  bool noCheckCertificate = false;
+  int64_t checkpointInterval = 1024 * 1024;
+  /** rate in bytes/s while yielding to interactive traffic */
+  int64_t yieldRate = 16 * 1024;
+
+  /** JavaScript side, only touched on the loop thread */
+  napi_env env = nullptr;
+  napi_ref onProgress = nullptr;
+  napi_ref onDone = nullptr;
+  uv_async_t async;
+  uv_thread_t thread;
+  shared_ptr<Downloader> self;
+
+  /** states shared with the loop thread */
+  atomic<bool> aborted;
+  atomic<bool> finished;
+  atomic<int64_t> downloaded;
+  atomic<int64_t> total;
+  /** bytes/s, 0 for unlimited */
+  atomic<int64_t> rateLimit;
+  atomic<bool> yielding;
+  atomic<int> pausedConnections;
+  atomic<uint64_t> throttledNs;
+
+  /** result fields, read once `finished` is set */
+  string errorCode;
+  string errorMessage;
+  string digest;
+
+  Downloader()
+      : aborted(false),
+        finished(false),
+        downloaded(0),
+        total(-1),
+        rateLimit(0),
+        yielding(false),
+        pausedConnections(0),
+        throttledNs(0) {
+  }
+
+  ~Downloader() {
+    if (env && onProgress) {
+      napi_delete_reference(env, onProgress);
+    }
+    if (env && onDone) {
+      napi_delete_reference(env, onDone);
+    }
+  }
+
+  static void Run(void* arg) {
+    auto downloader = static_cast<Downloader*>(arg);
+    downloader->run();
+    downloader->finished = true;
+    uv_async_send(&downloader->async);
+  }
+
+  size_t write(DownloadConnection* conn, const char* data, size_t len);
+
+  /**
+   * The effective rate: the yield rate caps the configured limit while
+   * interactive traffic is active.
+   */
+  int64_t effectiveRate() {
+    int64_t rate = rateLimit;
+    if (yielding && (rate == 0 || rate > yieldRate)) {
+      rate = yieldRate;
+    }
+    return rate;
+  }
+
+ private:
+  int fd = -1;
+  int64_t size = -1;
+  bool acceptRanges = false;
+  vector<DownloadRange> ranges;
+  int64_t hashed = 0;
+  md5_ctx_t md5;
+  int64_t lastCheckpoint = 0;
+  uint64_t lastProgress = 0;
+  vector<char> hashBuffer;
+  /**
+   * token bucket, only touched on the download thread as both refill() and
+   * the write callbacks run inside transfer()
+   */
+  double tokens = 0;
+  uint64_t lastRefill = 0;
+
+  void run();
+  bool probe();
+  bool restore();
+  void split();
+  bool prepareFile(bool resumed);
+  bool transfer();
+  void addConnection(CURLM* multi, DownloadConnection* conn);
+  void advanceHash();
+  bool checkpoint();
+  void reportProgress(bool force);
+  void refill(vector<DownloadConnection>& conns);
+
+  void fail(const char* code, const string& message) {
+    if (errorCode.empty()) {
+      errorCode = code;
+      errorMessage = message;
+    }
+  }
+};
+
+struct DownloadProbe {
+  int64_t size = -1;
+  int64_t length = -1;
+};
+
+static size_t OnProbeHeader(char* buffer, size_t size, size_t nitems,
+                            void* userdata) {
+  size_t len = size * nitems;
+  auto probe = static_cast<DownloadProbe*>(userdata);
+  string header(buffer, len);
+  static const char contentRange[] = "content-range:";
+  static const char contentLength[] = "content-length:";
+  if (strncasecmp(header.c_str(), contentRange, sizeof(contentRange) - 1) ==
+      0) {
+    /** Content-Range: bytes 0-0/<size> */
+    size_t pos = header.find('/');
+    if (pos != string::npos && header[pos + 1] != '*') {
+      probe->size = strtoll(header.c_str() + pos + 1, nullptr, 10);
+    }
+  } else if (strncasecmp(header.c_str(), contentLength,
+                         sizeof(contentLength) - 1) == 0) {
+    probe->length = strtoll(header.c_str() + sizeof(contentLength) - 1,
+                            nullptr, 10);
+  }
+  return len;
+}
+
+static size_t OnProbeWrite(char* ptr, size_t size, size_t nmemb,
+                           void* userdata) {
+  /** only headers are interested */
+  return 0;
+}
+
+static int OnProbeProgress(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
+                           curl_off_t ultotal, curl_off_t ulnow) {
+  auto downloader = static_cast<Downloader*>(clientp);
+  /** a non-zero return fails the transfer with CURLE_ABORTED_BY_CALLBACK */
+  return downloader->aborted ? 1 : 0;
+}
+
+static size_t OnWrite(char* ptr, size_t size, size_t nmemb, void* userdata) {
+  auto conn = static_cast<DownloadConnection*>(userdata);
+  return conn->downloader->write(conn, ptr, size * nmemb);
+}
+
+static void applyCommonOptions(CURL* easy, Downloader* downloader) {
+  curl_easy_setopt(easy, CURLOPT_URL, downloader->url.c_str());
+  curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(easy, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, downloader->timeout);
+  /** treats a stalled connection as timed out */
+  curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, downloader->timeout);
+  if (downloader->noCheckCertificate) {
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+  }
+}
+
+/**
+ * Requests the first byte of the image to learn the image size and whether
+ * the server supports ranges. Unlike HEAD, it works for urls only signed for
+ * GET as well.
+ */
+bool Downloader::probe() {
+  CURL* easy = curl_easy_init();
+  if (easy == nullptr) {
+    fail("ENOMEM", "Failed to create curl handle");
+    return false;
+  }
+  DownloadProbe probe;
+  applyCommonOptions(easy, this);
+  curl_easy_setopt(easy, CURLOPT_RANGE, "0-0");
+  curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, OnProbeHeader);
+  curl_easy_setopt(easy, CURLOPT_HEADERDATA, &probe);
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, OnProbeWrite);
+  /** the probe blocks until the response headers, which may take long */
+  curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, OnProbeProgress);
+  curl_easy_setopt(easy, CURLOPT_XFERINFODATA, this);
+
+  CURLcode code = curl_easy_perform(easy);
+  long status = 0;
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+  curl_easy_cleanup(easy);
+  if (aborted) {
+    fail("ECANCELED", "Download has been aborted");
+    return false;
+  }
+  if (code != CURLE_OK && code != CURLE_WRITE_ERROR) {
+    fail("EPROBE", curl_easy_strerror(code));
+    return false;
+  }
+
+  if (status == 206 && probe.size >= 0) {
+    acceptRanges = true;
+    size = probe.size;
+  } else if (status == 200) {
+    acceptRanges = false;
+    size = probe.length;
+  } else {
+    fail("EPROBE", "Unexpected response status " + to_string(status));
+    return false;
+  }
+  total = size;
+  return true;
+}
+
+/**
+ * Restores ranges and hash state from the checkpoint if it belongs to the
+ * same image.
+ */
+bool Downloader::restore() {
+  if (size < 0 || !acceptRanges) {
+    return false;
+  }
+  int cfd = open(checkpointPath.c_str(), O_RDONLY);
+  if (cfd < 0) {
+    return false;
+  }
+  DownloadCheckpoint cp;
+  ssize_t len = read(cfd, &cp, sizeof(cp));
+  close(cfd);
+  if (len != sizeof(cp) || cp.magic != DOWNLOAD_CHECKPOINT_MAGIC ||
+      cp.size != size || cp.urlHash != hashUrl(url) || cp.count == 0 ||
+      cp.count > DOWNLOAD_MAX_CONNECTIONS) {
+    return false;
+  }
+
+  struct stat st;
+  if (stat(dest.c_str(), &st) != 0 || st.st_size != size) {
+    return false;
+  }
+  ranges.assign(cp.ranges, cp.ranges + cp.count);
+  hashed = cp.hashed;
+  md5 = cp.md5;
+  for (auto& range : ranges) {
+    downloaded += range.offset - range.start;
+  }
+  lastCheckpoint = downloaded;
+  return true;
+}
+
+void Downloader::split() {
+  ranges.clear();
+  hashed = 0;
+  md5_init(&md5);
+  if (size <= 0 || !acceptRanges) {
+    ranges.push_back({ 0, size > 0 ? size - 1 : -1, 0 });
+    return;
+  }
+  int64_t count = connections;
+  if (count > DOWNLOAD_MAX_CONNECTIONS) {
+    count = DOWNLOAD_MAX_CONNECTIONS;
+  }
+  if (count > size / DOWNLOAD_MIN_RANGE_SIZE) {
+    count = size / DOWNLOAD_MIN_RANGE_SIZE;
+  }
+  if (count < 1) {
+    count = 1;
+  }
+  int64_t step = size / count;
+  for (int64_t i = 0; i < count; ++i) {
+    int64_t start = i * step;
+    int64_t end = i == count - 1 ? size - 1 : start + step - 1;
+    ranges.push_back({ start, end, start });
+  }
+}
+
+bool Downloader::prepareFile(bool resumed) {
+  int flags = O_RDWR | O_CREAT;
+  if (!resumed) {
+    flags |= O_TRUNC;
+  }
+  fd = open(dest.c_str(), flags, 0644);
+  if (fd < 0) {
+    fail("EOPEN", strerror(errno));
+    return false;
+  }
+  if (resumed || size <= 0) {
+    return true;
+  }
+  /**
+   * Preallocates the image so that parallel ranges never extend the file
+   * and the disk space is claimed upfront.
+   */
+  int err = posix_fallocate(fd, 0, size);
+  if (err != 0 && ftruncate(fd, size) != 0) {
+    fail("EALLOC", strerror(err));
+    return false;
+  }
+  return true;
+}
+
+size_t Downloader::write(DownloadConnection* conn, const char* data,
+                         size_t len) {
+  if (aborted) {
+    return 0;
+  }
+  int64_t rate = effectiveRate();
+  if (rate > 0 && tokens <= 0) {
+    /** curl delivers the same data again once the connection is resumed */
+    conn->paused = true;
+    pausedConnections++;
+    return CURL_WRITEFUNC_PAUSE;
+  }
+  DownloadRange& range = ranges[conn->index];
+
+  long status = 0;
+  curl_easy_getinfo(conn->easy, CURLINFO_RESPONSE_CODE, &status);
+  /** a plain 200 is only acceptable if the whole image is requested */
+  if (status != 206 &&
+      !(status == 200 && conn->from == 0 && ranges.size() == 1)) {
+    fail("ERANGE", "Server did not respond with the requested range");
+    return 0;
+  }
+  if (range.end >= 0 && range.offset + (int64_t)len > range.end + 1) {
+    fail("ERANGE", "Server responded more than the requested range");
+    return 0;
+  }
+
+  size_t written = 0;
+  while (written < len) {
+    ssize_t ret = pwrite(fd, data + written, len - written,
+                         range.offset + written);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fail("EWRITE", strerror(errno));
+      return 0;
+    }
+    written += ret;
+  }
+
+  /** hashes inline if the data is right at the hash cursor */
+  if (range.offset == hashed) {
+    md5_update(&md5, data, len);
+    hashed += len;
+  }
+  range.offset += len;
+  downloaded += len;
+  if (rate > 0) {
+    tokens -= len;
+  }
+  advanceHash();
+
+  if (downloaded - lastCheckpoint >= checkpointInterval) {
+    checkpoint();
+  }
+  reportProgress(false);
+  return len;
+}
+
+/**
+ * Catches the hash cursor up with the data written by ranges after the one
+ * being hashed inline. The data has been written moments ago and is read back
+ * from the page cache.
+ */
+void Downloader::advanceHash() {
+  for (auto& range : ranges) {
+    if (range.end >= 0 && hashed > range.end) {
+      continue;
+    }
+    while (hashed < range.offset) {
+      int64_t chunk = range.offset - hashed;
+      if (chunk > DOWNLOAD_HASH_CHUNK_SIZE) {
+        chunk = DOWNLOAD_HASH_CHUNK_SIZE;
+      }
+      ssize_t ret = pread(fd, hashBuffer.data(), chunk, hashed);
+      if (ret <= 0) {
+        if (ret < 0 && errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      md5_update(&md5, hashBuffer.data(), ret);
+      hashed += ret;
+    }
+    if (range.end < 0 || hashed <= range.end) {
+      break;
+    }
+  }
+}
+
+bool Downloader::checkpoint() {
+  lastCheckpoint = downloaded;
+  if (size < 0 || !acceptRanges || fd < 0) {
+    return false;
+  }
+  if (fdatasync(fd) != 0) {
+    return false;
+  }
+
+  DownloadCheckpoint cp;
+  memset(&cp, 0, sizeof(cp));
+  cp.magic = DOWNLOAD_CHECKPOINT_MAGIC;
+  cp.count = ranges.size();
+  cp.size = size;
+  cp.urlHash = hashUrl(url);
+  cp.hashed = hashed;
+  cp.md5 = md5;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    cp.ranges[i] = ranges[i];
+  }
+
+  string tmp = checkpointPath + ".tmp";
+  int cfd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (cfd < 0) {
+    return false;
+  }
+  bool ok = ::write(cfd, &cp, sizeof(cp)) == sizeof(cp) && fsync(cfd) == 0;
+  close(cfd);
+  return ok && rename(tmp.c_str(), checkpointPath.c_str()) == 0;
+}
+
+void Downloader::reportProgress(bool force) {
+  uint64_t now = uv_hrtime();
+  if (!force && now - lastProgress < DOWNLOAD_PROGRESS_INTERVAL_NS) {
+    return;
+  }
+  lastProgress = now;
+  uv_async_send(&async);
+}
+
+/**
+ * Refills the token bucket by the elapsed time and resumes paused
+ * connections while there are tokens left. The bucket holds up to a quarter
+ * of a second worth of bytes so that bursts stay short.
+ */
+void Downloader::refill(vector<DownloadConnection>& conns) {
+  uint64_t now = uv_hrtime();
+  uint64_t elapsed = lastRefill ? now - lastRefill : 0;
+  lastRefill = now;
+  if (pausedConnections > 0) {
+    throttledNs += elapsed;
+  }
+
+  int64_t rate = effectiveRate();
+  if (rate > 0) {
+    double capacity = rate / 4;
+    if (capacity < DOWNLOAD_BUCKET_MIN_SIZE) {
+      capacity = DOWNLOAD_BUCKET_MIN_SIZE;
+    }
+    tokens += (double)rate * elapsed / 1e9;
+    if (tokens > capacity) {
+      tokens = capacity;
+    }
+  }
+  for (auto& conn : conns) {
+    if (rate > 0 && tokens <= 0) {
+      break;
+    }
+    if (!conn.paused || conn.easy == nullptr) {
+      continue;
+    }
+    /** the write callback may pause the connection again right away */
+    conn.paused = false;
+    pausedConnections--;
+    curl_easy_pause(conn.easy, CURLPAUSE_CONT);
+  }
+}
+
+void Downloader::addConnection(CURLM* multi, DownloadConnection* conn) {
+  DownloadRange& range = ranges[conn->index];
+  conn->from = range.offset;
+  conn->paused = false;
+  conn->easy = curl_easy_init();
+  applyCommonOptions(conn->easy, this);
+  curl_easy_setopt(conn->easy, CURLOPT_WRITEFUNCTION, OnWrite);
+  curl_easy_setopt(conn->easy, CURLOPT_WRITEDATA, conn);
+  curl_easy_setopt(conn->easy, CURLOPT_PRIVATE, conn);
+  if (range.offset > 0 || range.end >= 0) {
+    char spec[64];
+    if (range.end >= 0) {
+      snprintf(spec, sizeof(spec), "%lld-%lld", (long long)range.offset,
+               (long long)range.end);
+    } else {
+      snprintf(spec, sizeof(spec), "%lld-", (long long)range.offset);
+    }
+    curl_easy_setopt(conn->easy, CURLOPT_RANGE, spec);
+  }
+  curl_multi_add_handle(multi, conn->easy);
+}
+
+bool Downloader::transfer() {
+  CURLM* multi = curl_multi_init();
+  vector<DownloadConnection> conns(ranges.size());
+  int active = 0;
+  lastRefill = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    conns[i].downloader = this;
+    conns[i].index = i;
+    if (ranges[i].end >= 0 && ranges[i].offset > ranges[i].end) {
+      continue;
+    }
+    addConnection(multi, &conns[i]);
+    active++;
+  }
+
+  while (active > 0 && errorCode.empty()) {
+    if (aborted) {
+      fail("ECANCELED", "Download has been aborted");
+      break;
+    }
+    refill(conns);
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    CURLMsg* msg;
+    int queued;
+    while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      DownloadConnection* conn;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &conn);
+      CURLcode code = msg->data.result;
+      curl_multi_remove_handle(multi, conn->easy);
+      curl_easy_cleanup(conn->easy);
+      conn->easy = nullptr;
+      if (conn->paused) {
+        conn->paused = false;
+        pausedConnections--;
+      }
+      active--;
+
+      DownloadRange& range = ranges[conn->index];
+      bool complete = range.end >= 0 ? range.offset > range.end
+                                     : code == CURLE_OK;
+      if (complete || !errorCode.empty()) {
+        continue;
+      }
+      /**
+       * resumes the range from where it has been interrupted, a range that
+       * made progress gets its retries back as long throttled connections
+       * may be closed by the server.
+       */
+      if (range.offset > conn->from) {
+        conn->retries = 0;
+      }
+      if (conn->retries++ < retries) {
+        addConnection(multi, conn);
+        active++;
+        continue;
+      }
+      fail("EDOWNLOAD", code == CURLE_OK ? "Connection closed prematurely"
+                                         : curl_easy_strerror(code));
+    }
+    if (active > 0 && errorCode.empty()) {
+      curl_multi_wait(multi, nullptr, 0,
+                      pausedConnections > 0 ? DOWNLOAD_THROTTLE_TICK_MS : 1000,
+                      nullptr);
+    }
+  }
+
+  pausedConnections = 0;
+  for (auto& conn : conns) {
+    if (conn.easy) {
+      curl_multi_remove_handle(multi, conn.easy);
+      curl_easy_cleanup(conn.easy);
+    }
+  }
+  curl_multi_cleanup(multi);
+  return errorCode.empty();
+}
+
+void Downloader::run() {
+  hashBuffer.resize(DOWNLOAD_HASH_CHUNK_SIZE);
+  if (!probe()) {
+    return;
+  }
+  bool resumed = restore();
+  if (!resumed) {
+    unlink(checkpointPath.c_str());
+    split();
+  }
+  if (!prepareFile(resumed)) {
+    return;
+  }
+
+  bool ok = transfer();
+  advanceHash();
+  if (!ok) {
+    /** keeps what has been downloaded for the next run */
+    checkpoint();
+    close(fd);
+    return;
+  }
+
+  if (size >= 0 && hashed != size) {
+    fail("EHASH", "Image is not fully hashed");
+  } else if (fdatasync(fd) != 0) {
+    fail("EWRITE", strerror(errno));
+  } else {
+    uint8_t result[MD5_DIGEST_LENGTH];
+    char hex[MD5_DIGEST_LENGTH * 2 + 1];
+    md5_final(&md5, result);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+      snprintf(hex + i * 2, 3, "%02x", result[i]);
+    }
+    digest.assign(hex);
+    unlink(checkpointPath.c_str());
+  }
+  total = hashed;
+  close(fd);
+}
+
+static void OnClose(uv_handle_t* handle) {
+  auto downloader = static_cast<Downloader*>(handle->data);
+  auto self = std::move(downloader->self);
+}
+
+static void OnAsync(uv_async_t* handle) {
+  auto downloader = static_cast<Downloader*>(handle->data);
+  napi_env env = downloader->env;
+  bool finished = downloader->finished;
+
+  napi_handle_scope scope;
+  napi_value global, cb, argv[2], exception = nullptr;
+  NAPI_CALL_RETURN_VOID(env, napi_open_handle_scope(env, &scope));
+  NAPI_CALL_RETURN_VOID(env, napi_get_global(env, &global));
+
+  if (downloader->onProgress) {
+    NAPI_CALL_RETURN_VOID(env, napi_get_reference_value(env,
+                                                        downloader->onProgress,
+                                                        &cb));
+    NAPI_CALL_RETURN_VOID(env, napi_create_double(env, downloader->downloaded,
+                                                  &argv[0]));
+    NAPI_CALL_RETURN_VOID(env,
+                          napi_create_double(env, downloader->total, &argv[1]));
+    if (napi_make_callback(env, nullptr, global, cb, 2, argv, nullptr) !=
+        napi_ok) {
+      /**
+       * sets aside what onProgress has thrown until onDone is delivered, or
+       * the pending exception would fail every following call.
+       */
+      bool is_pending = false;
+      napi_is_exception_pending(env, &is_pending);
+      if (is_pending) {
+        napi_get_and_clear_last_exception(env, &exception);
+      }
+    }
+  }
+
+  if (finished) {
+    uv_thread_join(&downloader->thread);
+
+    NAPI_CALL_RETURN_VOID(env, napi_get_reference_value(env, downloader->onDone,
+                                                        &cb));
+    if (!downloader->errorCode.empty()) {
+      napi_value code, message;
+      NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(
+                                     env, downloader->errorCode.c_str(),
+                                     NAPI_AUTO_LENGTH, &code));
+      NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(
+                                     env, downloader->errorMessage.c_str(),
+                                     NAPI_AUTO_LENGTH, &message));
+      NAPI_CALL_RETURN_VOID(env,
+                            napi_create_error(env, code, message, &argv[0]));
+      NAPI_CALL_RETURN_VOID(env, napi_get_undefined(env, &argv[1]));
+    } else {
+      napi_value value;
+      NAPI_CALL_RETURN_VOID(env, napi_get_undefined(env, &argv[0]));
+      NAPI_CALL_RETURN_VOID(env, napi_create_object(env, &argv[1]));
+      NAPI_CALL_RETURN_VOID(env,
+                            napi_create_double(env, downloader->total, &value));
+      NAPI_CALL_RETURN_VOID(env,
+                            napi_set_named_property(env, argv[1], "size",
+                                                    value));
+      NAPI_CALL_RETURN_VOID(env, napi_create_string_utf8(
+                                     env, downloader->digest.c_str(),
+                                     NAPI_AUTO_LENGTH, &value));
+      NAPI_CALL_RETURN_VOID(env, napi_set_named_property(env, argv[1], "md5",
+                                                         value));
+    }
+    uv_close(reinterpret_cast<uv_handle_t*>(&downloader->async), OnClose);
+    NAPI_CALL_RETURN_VOID(env, napi_make_callback(env, nullptr, global, cb, 2,
+                                                  argv, nullptr));
+  }
+  if (exception != nullptr) {
+    napi_throw(env, exception);
+  }
+  NAPI_CALL_RETURN_VOID(env, napi_close_handle_scope(env, scope));
+}
+
+static bool parseOptions(Downloader* downloader, napi_env env,
+                         napi_value options) {
+  napi_value value;
+  int32_t number;
+  value = NAPI_GET_PROPERTY(env, options, "connections", nullptr, napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number > 0) {
+      downloader->connections = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "retries", nullptr, napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number >= 0) {
+      downloader->retries = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "timeout", nullptr, napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number > 0) {
+      downloader->timeout = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "checkpointInterval", nullptr,
+                            napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number > 0) {
+      downloader->checkpointInterval = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "rateLimit", nullptr, napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number >= 0) {
+      downloader->rateLimit = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "yieldRate", nullptr, napi_number);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_int32(env, value, &number), false);
+    if (number > 0) {
+      downloader->yieldRate = number;
+    }
+  }
+  value = NAPI_GET_PROPERTY(env, options, "yielding", nullptr, napi_boolean);
+  if (value) {
+    bool yielding;
+    NAPI_CALL_BASE(env, napi_get_value_bool(env, value, &yielding), false);
+    downloader->yielding = yielding;
+  }
+  value = NAPI_GET_PROPERTY(env, options, "noCheckCertificate", nullptr,
+                            napi_boolean);
+  if (value) {
+    NAPI_CALL_BASE(env, napi_get_value_bool(env, value,
+                                            &downloader->noCheckCertificate),
+                   false);
+  }
+  return true;
+}
+
+static void finalizeHandle(napi_env env, void* finalize_data,
+                           void* finalize_hint) {
+  delete static_cast<shared_ptr<Downloader>*>(finalize_data);
+}
+
+static napi_value Download(napi_env env, napi_callback_info info) {
+  size_t argc = 5;
+  napi_value argv[5];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+  if (argc < 5) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr, "Wrong arguments number"));
+    return nullptr;
+  }
+
+  napi_valuetype type;
+  NAPI_CALL(env, napi_typeof(env, argv[4], &type));
+  if (type != napi_function) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr,
+                                    "Argument type error, expect a function."));
+    return nullptr;
+  }
+
+  auto downloader = make_shared<Downloader>();
+  downloader->env = env;
+  if (!NAPI_ASSIGN_STD_STRING(env, downloader->url, argv[0]) ||
+      !NAPI_ASSIGN_STD_STRING(env, downloader->dest, argv[1])) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr,
+                                    "Argument type error, expect a string."));
+    return nullptr;
+  }
+  downloader->checkpointPath = downloader->dest + ".progress";
+
+  NAPI_CALL(env, napi_typeof(env, argv[2], &type));
+  if (type == napi_object && !parseOptions(downloader.get(), env, argv[2])) {
+    return nullptr;
+  }
+  NAPI_CALL(env, napi_typeof(env, argv[3], &type));
+  if (type == napi_function) {
+    NAPI_CALL(env,
+              napi_create_reference(env, argv[3], 1, &downloader->onProgress));
+  }
+  NAPI_CALL(env, napi_create_reference(env, argv[4], 1, &downloader->onDone));
+
+  uv_loop_t* loop;
+  NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+  downloader->async.data = downloader.get();
+  uv_async_init(loop, &downloader->async, OnAsync);
+  downloader->self = downloader;
+  uv_thread_create(&downloader->thread, Downloader::Run, downloader.get());
+
+  napi_value handle;
+  NAPI_CALL(env, napi_create_object(env, &handle));
+  NAPI_CALL(env, napi_wrap(env, handle, new shared_ptr<Downloader>(downloader),
+                           finalizeHandle, nullptr, nullptr));
+  return handle;
+}
+
+static napi_value Abort(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+  if (argc != 1) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr, "Wrong arguments number"));
+    return nullptr;
+  }
+
+  void* wrapped = nullptr;
+  NAPI_CALL(env, napi_unwrap(env, argv[0], &wrapped));
+  if (wrapped != nullptr) {
+    (*static_cast<shared_ptr<Downloader>*>(wrapped))->aborted = true;
+  }
+  return nullptr;
+}
+
+static shared_ptr<Downloader> unwrapDownloader(napi_env env,
+                                               napi_value handle) {
+  void* wrapped = nullptr;
+  napi_unwrap(env, handle, &wrapped);
+  if (wrapped == nullptr) {
+    return nullptr;
+  }
+  return *static_cast<shared_ptr<Downloader>*>(wrapped);
+}
+
+static napi_value SetThrottle(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+  if (argc != 2) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr, "Wrong arguments number"));
+    return nullptr;
+  }
+  auto downloader = unwrapDownloader(env, argv[0]);
+  if (downloader == nullptr) {
+    return nullptr;
+  }
+
+  napi_value value;
+  value = NAPI_GET_PROPERTY(env, argv[1], "rateLimit", nullptr, napi_number);
+  if (value) {
+    int32_t number;
+    NAPI_CALL(env, napi_get_value_int32(env, value, &number));
+    downloader->rateLimit = number > 0 ? number : 0;
+  }
+  value = NAPI_GET_PROPERTY(env, argv[1], "yielding", nullptr, napi_boolean);
+  if (value) {
+    bool yielding;
+    NAPI_CALL(env, napi_get_value_bool(env, value, &yielding));
+    downloader->yielding = yielding;
+  }
+  return nullptr;
+}
+
+static napi_value GetThrottle(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+  if (argc != 1) {
+    NAPI_CALL(env, napi_throw_error(env, nullptr, "Wrong arguments number"));
+    return nullptr;
+  }
+  auto downloader = unwrapDownloader(env, argv[0]);
+  if (downloader == nullptr) {
+    return nullptr;
+  }
+
+  napi_value result, value;
+  NAPI_CALL(env, napi_create_object(env, &result));
+  NAPI_CALL(env, napi_create_double(env, downloader->effectiveRate(), &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "rate", value));
+  NAPI_CALL(env, napi_create_double(env, downloader->rateLimit, &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "rateLimit", value));
+  NAPI_CALL(env, napi_get_boolean(env, downloader->yielding, &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "yielding", value));
+  NAPI_CALL(env,
+            napi_create_int32(env, downloader->pausedConnections, &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "paused", value));
+  NAPI_CALL(env, napi_create_double(env, downloader->throttledNs / 1e6,
+                                    &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "throttled", value));
+  NAPI_CALL(env, napi_create_double(env, downloader->downloaded, &value));
+  NAPI_CALL(env, napi_set_named_property(env, result, "downloaded", value));
+  return result;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  napi_property_descriptor desc[] = {
+    DECLARE_NAPI_PROPERTY("download", Download),
+    DECLARE_NAPI_PROPERTY("abort", Abort),
+    DECLARE_NAPI_PROPERTY("setThrottle", SetThrottle),
+    DECLARE_NAPI_PROPERTY("getThrottle", GetThrottle),
+  };
+  size_t property_count = sizeof(desc) / sizeof(*desc);
+  NAPI_CALL(env, napi_define_properties(env, exports, property_count, desc));
+  return exports;
+}
+
+NAPI_MODULE(downloader, Init)
@@ -0,0 +1,23 @@
+#ifndef YODA_OTA_MD5_H_
+#define YODA_OTA_MD5_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MD5_DIGEST_LENGTH 16
+
+/**
+ * MD5 context. It is a plain struct so that an in-progress hash could be
+ * persisted and resumed later.
+ */
+typedef struct {
+  uint32_t state[4];
+  uint64_t count;
+  uint8_t buffer[64];
+} md5_ctx_t;
+
+void md5_init(md5_ctx_t* ctx);
+void md5_update(md5_ctx_t* ctx, const void* data, size_t len);
+void md5_final(md5_ctx_t* ctx, uint8_t digest[MD5_DIGEST_LENGTH]);
+
+#endif // YODA_OTA_MD5_H_
@@ -120,6 +120,102 @@ exports.diskUsage = function diskUsage (path) {
   return native.diskUsage(path)
 }
 
+/**
+ * @typedef FilesystemUsage
+ * @property {number} available
+ * @property {number} free
+ * @property {number} total
+ * @property {number} files - total inodes.
+ * @property {number} filesFree - free inodes.
+ */
+
+var DiskUsageKeys = [ 'available', 'free', 'total', 'files', 'filesFree' ]
+
+/**
+ * Decode the Float64Array queried by `queryDiskUsage`.
+ * @function decodeDiskUsage
+ * @param {Float64Array} usage
+ * @param {string[]} paths - the paths queried.
+ * @returns {object} path -> {@link module:@yoda/system~FilesystemUsage}, or
+ * an Error with `errno` if the path could not be queried.
+ */
+exports.decodeDiskUsage = function decodeDiskUsage (usage, paths) {
+  var result = {}
+  paths.forEach((path, idx) => {
+    var pos = idx * native.DISK_USAGE_STRIDE
+    if (usage[pos] < 0) {
+      var err = new Error(`Unable to query disk usage of '${path}', errno ${-usage[pos]}`)
+      err.errno = usage[pos]
+      result[path] = err
+      return
+    }
+    var it = {}
+    DiskUsageKeys.forEach((key, keyIdx) => {
+      it[key] = usage[pos + 1 + keyIdx]
+    })
+    result[path] = it
+  })
+  return result
+}
+
+/**
+ * Query disk usage of several paths in one job of the thread pool, without
+ * blocking the event loop on slow storage.
+ *
+ * @function queryDiskUsage
+ * @param {string[]} paths
+ * @param {Function} callback - `(err, usage)`, the usage is a Float64Array
+ * of `DISK_USAGE_STRIDE` of each path, see `decodeDiskUsage`.
+ */
+exports.queryDiskUsage = function queryDiskUsage (paths, callback) {
+  return native.queryDiskUsage(paths, callback)
+}
+
+exports.DISK_USAGE_STRIDE = native.DISK_USAGE_STRIDE
+
+/** path -> { time, usage } */
+var diskUsageCache = {}
+
+/**
+ * Get disk usage at a path asynchronously.
+ *
+ * @function diskUsageAsync
+ * @param {string} path - the path to be analyzed
+ * @param {object} [options]
+ * @param {number} [options.ttl=0] - milliseconds that a previous result
+ * could be reused, 0 to query the disk.
+ * @param {Function} callback - `(err, usage)`
+ * @see module:@yoda/system~FilesystemUsage
+ */
+exports.diskUsageAsync = function diskUsageAsync (path, options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = {}
+  }
+  if (typeof path !== 'string') {
+    return process.nextTick(() => callback(TypeError('Expect a string on first argument of diskUsageAsync')))
+  }
+  var ttl = (options && options.ttl) || 0
+  var now = exports.clockGetTime(exports.CLOCK_MONOTONIC)
+  now = now.sec * 1000 + now.nsec / 1e6
+  var cached = diskUsageCache[path]
+  if (ttl > 0 && cached && now - cached.time <= ttl) {
+    return process.nextTick(() => callback(null, Object.assign({}, cached.usage)))
+  }
+  exports.queryDiskUsage([ path ], (err, usage) => {
+    if (err) {
+      return callback(err)
+    }
+    var result = exports.decodeDiskUsage(usage, [ path ])[path]
+    if (result instanceof Error) {
+      delete diskUsageCache[path]
+      return callback(result)
+    }
+    diskUsageCache[path] = { time: now, usage: result }
+    callback(null, Object.assign({}, result))
+  })
+}
+
 /**
  * convert  a  string  representation  of time to a time `tm` structure.
  * @function parseDateString
@@ -165,12 +261,257 @@ exports.mallocTrim = function mallocTrim () {
 }
 
 /**
+ * @typedef MallocArenaStats
+ * @property {number} id
+ * @property {number} fastbinCount - free chunks in fastbins.
+ * @property {number} fastbin - bytes in fastbins.
+ * @property {number} freeCount - free chunks in the other bins.
+ * @property {number} free - bytes in the other bins.
+ * @property {number} current - bytes allocated from the system.
+ * @property {number} max - max bytes ever allocated from the system.
+ * @property {number} aspace - address space of the arena.
+ */
+
+/**
+ * @typedef MallocStats
+ * @property {number} arena - non-mmapped bytes allocated from the system.
+ * @property {number} mmapCount - mmapped chunks.
+ * @property {number} mmap - bytes in mmapped chunks.
+ * @property {number} inUse - bytes in use.
+ * @property {number} freeCount - free chunks.
+ * @property {number} free - free bytes.
+ * @property {number} fastbinCount - free chunks in fastbins.
+ * @property {number} fastbin - free bytes in fastbins.
+ * @property {number} keepcost - bytes of the releasable top-most chunk.
+ * @property {module:@yoda/system~MallocArenaStats[]} arenas
+ */
+
+/**
+ * Get the statistics of the allocator, from mallinfo2(3) and malloc_info(3).
+ *
  * @function mallocStats
+ * @returns {module:@yoda/system~MallocStats} null if not available.
  */
 exports.mallocStats = function mallocStats () {
   return native.mallocStats()
 }
 
+var MallocStatsKeys = [ 'arena', 'mmap', 'inUse', 'free', 'fastbin', 'keepcost' ]
+var MallocArenaStatsKeys = [ 'current', 'free', 'fastbin' ]
+
+/**
+ * Report `mallocStats` to endoscope periodically, as the histogram
+ * `yodaos:system:malloc` labeled with `stat`, `arena` and the `labels`, e.g.
+ * the app id, so that the fragmentation could be correlated with
+ * `adjustMallocSettings`.
+ *
+ * @function reportMallocStats
+ * @param {number} interval - in milliseconds.
+ * @param {object} [labels]
+ * @param {string} [labels.name] - name of the process.
+ * @returns {object} the reporter, stopped by `close()`.
+ */
+exports.reportMallocStats = function reportMallocStats (interval, labels) {
+  var endoscope = require('@yoda/endoscope')
+  var metric = new endoscope.Histogram('yodaos:system:malloc', [ 'name', 'arena', 'stat' ])
+  var name = (labels && labels.name) || process.title
+  var report = () => {
+    var stats = native.mallocStats()
+    if (stats == null) {
+      return
+    }
+    MallocStatsKeys.forEach(stat => {
+      metric.observe({ name: name, arena: 'all', stat: stat }, stats[stat])
+    })
+    stats.arenas.forEach(arena => {
+      MallocArenaStatsKeys.forEach(stat => {
+        metric.observe({ name: name, arena: String(arena.id), stat: stat }, arena[stat])
+      })
+    })
+  }
+  var timer = setInterval(report, interval)
+  return {
+    report: report,
+    close: () => clearInterval(timer)
+  }
+}
+
+/**
+ * @typedef MemorySample
+ * @property {object} meminfo - in kB, -1 if not available.
+ * @property {number} meminfo.total
+ * @property {number} meminfo.free
+ * @property {number} meminfo.available
+ * @property {number} meminfo.buffers
+ * @property {number} meminfo.cached
+ * @property {number} meminfo.swapTotal
+ * @property {number} meminfo.swapFree
+ * @property {object} processes - pid -> `{ rss, pss, swap }` in kB, `pss`
+ * and `swap` are -1 if not available. Processes gone are omitted.
+ */
+
+var MeminfoKeys = [ 'total', 'free', 'available', 'buffers', 'cached', 'swapTotal', 'swapFree' ]
+
+/**
+ * Decode the Int32Array sampled by `sampleMemory`.
+ * @function decodeMemorySample
+ * @param {Int32Array} sample
+ * @returns {module:@yoda/system~MemorySample}
+ */
+exports.decodeMemorySample = function decodeMemorySample (sample) {
+  var meminfo = {}
+  MeminfoKeys.forEach((key, idx) => {
+    meminfo[key] = sample[idx]
+  })
+  var processes = {}
+  for (var pos = native.MEMINFO_FIELDS; pos + native.PROCESS_MEMORY_STRIDE <= sample.length;
+    pos += native.PROCESS_MEMORY_STRIDE) {
+    if (sample[pos + 1] < 0) {
+      continue
+    }
+    processes[sample[pos]] = { rss: sample[pos + 1], pss: sample[pos + 2], swap: sample[pos + 3] }
+  }
+  return { meminfo: meminfo, processes: processes }
+}
+
+/**
+ * Sample /proc/meminfo and the memory of processes in one job of the thread
+ * pool, without spawning any process.
+ *
+ * @function sampleMemory
+ * @param {number[]} pids
+ * @param {Function} callback - `(err, sample)`, the sample is an Int32Array
+ * of `MEMINFO_FIELDS` followed by `PROCESS_MEMORY_STRIDE` of each pid, see
+ * `decodeMemorySample`.
+ */
+exports.sampleMemory = function sampleMemory (pids, callback) {
+  return native.sampleMemory(pids.map(Number), callback)
+}
+
+exports.MEMINFO_FIELDS = native.MEMINFO_FIELDS
+exports.PROCESS_MEMORY_STRIDE = native.PROCESS_MEMORY_STRIDE
+
+/**
+ * @typedef CpuSample
+ * @property {number} utime - in milliseconds.
+ * @property {number} stime - in milliseconds.
+ * @property {number} run - time running on cpu of the main thread in
+ * milliseconds, -1 if schedstat is not available.
+ * @property {number} runDelay - time waiting on the run queue of the main
+ * thread in milliseconds, -1 if schedstat is not available.
+ * @property {number} voluntarySwitches - of the main thread.
+ * @property {number} involuntarySwitches - of the main thread.
+ */
+
+var CpuSampleKeys = [ 'utime', 'stime', 'run', 'runDelay', 'voluntarySwitches', 'involuntarySwitches' ]
+
+/**
+ * Decode the Float64Array sampled by `sampleCpu`.
+ * @function decodeCpuSample
+ * @param {Float64Array} sample
+ * @returns {object} pid -> {@link module:@yoda/system~CpuSample}, processes
+ * gone are omitted.
+ */
+exports.decodeCpuSample = function decodeCpuSample (sample) {
+  var processes = {}
+  for (var pos = 0; pos + native.CPU_SAMPLE_STRIDE <= sample.length; pos += native.CPU_SAMPLE_STRIDE) {
+    if (sample[pos + 1] < 0) {
+      continue
+    }
+    var it = {}
+    CpuSampleKeys.forEach((key, idx) => {
+      it[key] = sample[pos + 1 + idx]
+    })
+    processes[sample[pos]] = it
+  }
+  return processes
+}
+
+/**
+ * Sample the cpu time, the run-queue delay and the context switches of
+ * processes in one job of the thread pool.
+ *
+ * @function sampleCpu
+ * @param {number[]} pids
+ * @param {Function} callback - `(err, sample)`, the sample is a Float64Array
+ * of `CPU_SAMPLE_STRIDE` of each pid, see `decodeCpuSample`.
+ */
+exports.sampleCpu = function sampleCpu (pids, callback) {
+  return native.sampleCpu(pids.map(Number), callback)
+}
+
+exports.CPU_SAMPLE_STRIDE = native.CPU_SAMPLE_STRIDE
+
+/**
+ * @typedef MemoryPressureWatcher
+ * @property {string} source - `psi` or `memory.events`.
+ * @property {Function} close
+ */
+
+/**
+ * Resolves the memory.events of the cgroup v2 the process belongs to.
+ * @private
+ */
+function getMemoryEventsPath () {
+  var fs = require('fs')
+  var cgroup
+  try {
+    cgroup = fs.readFileSync('/proc/self/cgroup', 'utf8')
+  } catch (err) {
+    return null
+  }
+  var match = /^0::(\/.*)$/m.exec(cgroup)
+  if (match == null) {
+    return null
+  }
+  return '/sys/fs/cgroup' + match[1].replace(/\/$/, '') + '/memory.events'
+}
+
+/**
+ * Watch the memory pressure of the device without polling. A PSI trigger is
+ * registered on /proc/pressure/memory, which fires once tasks stalled on
+ * memory for `options.stall` milliseconds within any `options.window`. On
+ * kernels without PSI, the memory.events of the cgroup v2 is watched
+ * instead, which changes on reclaim and oom events of the cgroup.
+ *
+ * @function watchMemoryPressure
+ * @param {object} [options]
+ * @param {number} [options.stall=150] - stall threshold in milliseconds.
+ * @param {number} [options.window=2000] - window in milliseconds, shall be
+ * a multiple of 2s for unprivileged processes.
+ * @param {boolean} [options.full=false] - `full` stall of all non-idle tasks
+ * rather than `some`.
+ * @param {string} [options.memoryEvents] - memory.events to be watched on
+ * fallback, defaults to the one of the cgroup of the process.
+ * @param {Function} callback - `(pressure)`, the `{ some, full }` of PSI, or
+ * the `{ low, high, max, oom, oom_kill }` of memory.events.
+ * @returns {module:@yoda/system~MemoryPressureWatcher} null if neither is
+ * available, callers shall poll then.
+ */
+exports.watchMemoryPressure = function watchMemoryPressure (options, callback) {
+  if (typeof options === 'function') {
+    callback = options
+    options = {}
+  }
+  options = Object.assign({ stall: 150, window: 2000, full: false }, options)
+  var onpressure = (id, pressure) => callback(pressure)
+  var source = 'psi'
+  var id = native.watchMemoryPressure(!!options.full,
+    Math.round(options.stall * 1000), Math.round(options.window * 1000), onpressure)
+  if (id < 0) {
+    source = 'memory.events'
+    var path = options.memoryEvents || getMemoryEventsPath()
+    id = path ? native.watchMemoryEvents(path, onpressure) : -1
+  }
+  if (id < 0) {
+    return null
+  }
+  return {
+    source: source,
+    close: () => native.unwatchMemoryPressure(id)
+  }
+}
+
 exports.CLOCK_REALTIME = native.CLOCK_REALTIME
 exports.CLOCK_MONOTONIC = native.CLOCK_MONOTONIC
 exports.CLOCK_PROCESS_CPUTIME_ID = native.CLOCK_PROCESS_CPUTIME_ID
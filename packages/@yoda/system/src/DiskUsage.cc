@@ -0,0 +1,88 @@
+#include "SystemNative.h"
+#include <common.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <string>
+#include <vector>
+
+typedef pool_job_carrier<std::string, double, napi_float64_array>
+    disk_usage_carrier;
+
+static void query_disk_usage(const char* path, double* out) {
+  struct statvfs info = {};
+  if (statvfs(path, &info) != 0) {
+    out[0] = -errno;
+    for (int i = 1; i < DISK_USAGE_STRIDE; ++i) {
+      out[i] = -1;
+    }
+    return;
+  }
+  out[0] = 0;
+  out[1] = (double)info.f_bavail * info.f_frsize;
+  out[2] = (double)info.f_bfree * info.f_frsize;
+  out[3] = (double)info.f_blocks * info.f_frsize;
+  out[4] = (double)info.f_files;
+  out[5] = (double)info.f_ffree;
+}
+
+/**
+ * statvfs may block for long on slow storage under heavy writes, e.g. eMMC
+ * while downloading OTA images, so it's never called on the loop thread.
+ */
+static void DoQueryDiskUsage(napi_env env, void* data) {
+  disk_usage_carrier* c = static_cast<disk_usage_carrier*>(data);
+  c->_result.resize(c->_input.size() * DISK_USAGE_STRIDE);
+  for (size_t i = 0; i < c->_input.size(); ++i) {
+    query_disk_usage(c->_input[i].c_str(),
+                     &c->_result[i * DISK_USAGE_STRIDE]);
+  }
+}
+
+/**
+ * queryDiskUsage(paths, callback), queries the disk usage of the paths in
+ * one job of the thread pool. `callback(err, usage)` receives a Float64Array
+ * of `DISK_USAGE_STRIDE` of each path.
+ */
+napi_value QueryDiskUsage(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+  bool is_array;
+  NAPI_CALL(env, napi_is_array(env, argv[0], &is_array));
+  if (!is_array) {
+    napi_throw_type_error(env, nullptr, "The first argument must be an array.");
+    return NULL;
+  }
+  napi_valuetype type;
+  NAPI_CALL(env, napi_typeof(env, argv[1], &type));
+  if (type != napi_function) {
+    napi_throw_type_error(env, nullptr,
+                          "The second argument must be a function.");
+    return NULL;
+  }
+
+  uint32_t length;
+  NAPI_CALL(env, napi_get_array_length(env, argv[0], &length));
+  std::vector<std::string> paths(length);
+  for (uint32_t i = 0; i < length; i++) {
+    napi_value nval_path;
+    size_t pathlen;
+    NAPI_CALL(env, napi_get_element(env, argv[0], i, &nval_path));
+    if (napi_get_value_string_utf8(env, nval_path, NULL, 0, &pathlen) !=
+        napi_ok) {
+      napi_throw_type_error(env, nullptr, "Paths must be strings.");
+      return NULL;
+    }
+    paths[i].resize(pathlen + 1);
+    NAPI_CALL(env, napi_get_value_string_utf8(env, nval_path, &paths[i][0],
+                                              pathlen + 1, &pathlen));
+    paths[i].resize(pathlen);
+  }
+
+  disk_usage_carrier* the_carrier = new disk_usage_carrier;
+  the_carrier->_input.swap(paths);
+  return the_carrier->queue(env, argv[1], "queryDiskUsage",
+                            DoQueryDiskUsage);
+}
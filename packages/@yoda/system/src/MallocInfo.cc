@@ -0,0 +1,148 @@
+#include "SystemNative.h"
+#include <common.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif // defined(__GLIBC__)
+
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define HAVE_MALLINFO2
+#endif
+
+static void set_named_double(napi_env env, napi_value obj, const char* key,
+                             double value) {
+  napi_value nval;
+  if (napi_create_double(env, value, &nval) == napi_ok) {
+    napi_set_named_property(env, obj, key, nval);
+  }
+}
+
+#if defined(__GLIBC__)
+/**
+ * Parses a `<tag type="..." count="..." size="..."/>` line of malloc_info,
+ * `count` is left untouched if absent.
+ */
+static bool read_info_line(const char* line, const char* tag,
+                           const char* type, double* count, double* size) {
+  char pattern[32];
+  snprintf(pattern, sizeof(pattern), "<%s type=\"%s\"", tag, type);
+  const char* pos = strstr(line, pattern);
+  if (pos == NULL) {
+    return false;
+  }
+  pos += strlen(pattern);
+  const char* attr = strstr(pos, "count=\"");
+  if (attr != NULL && count != NULL) {
+    *count = strtod(attr + 7, NULL);
+  }
+  attr = strstr(pos, "size=\"");
+  if (attr != NULL && size != NULL) {
+    *size = strtod(attr + 6, NULL);
+  }
+  return true;
+}
+
+/**
+ * Parses the per-arena details of malloc_info(3) into `arenas`, returns the
+ * total mmap-ed chunks through `mmap_count` and `mmap_size`.
+ */
+static void read_arenas(napi_env env, napi_value arenas, double* mmap_count,
+                        double* mmap_size) {
+  char* xml = NULL;
+  size_t len = 0;
+  FILE* stream = open_memstream(&xml, &len);
+  if (stream == NULL) {
+    return;
+  }
+  int r = malloc_info(0, stream);
+  fclose(stream);
+  if (r != 0 || xml == NULL) {
+    free(xml);
+    return;
+  }
+
+  napi_value arena = NULL;
+  uint32_t idx = 0;
+  double fast_count = 0, fast_size = 0, rest_count = 0, rest_size = 0;
+  double current = 0, max = 0, aspace = 0;
+  int nr;
+  char* saveptr = NULL;
+  for (char* line = strtok_r(xml, "\n", &saveptr); line != NULL;
+       line = strtok_r(NULL, "\n", &saveptr)) {
+    if (sscanf(line, " <heap nr=\"%d\">", &nr) == 1) {
+      if (napi_create_object(env, &arena) != napi_ok) {
+        arena = NULL;
+        continue;
+      }
+      set_named_double(env, arena, "id", nr);
+      fast_count = fast_size = rest_count = rest_size = 0;
+      current = max = aspace = 0;
+      continue;
+    }
+    if (arena == NULL) {
+      /** totals of all arenas follow the last heap */
+      read_info_line(line, "total", "mmap", mmap_count, mmap_size);
+      continue;
+    }
+    if (strstr(line, "</heap>") != NULL) {
+      set_named_double(env, arena, "fastbinCount", fast_count);
+      set_named_double(env, arena, "fastbin", fast_size);
+      set_named_double(env, arena, "freeCount", rest_count);
+      set_named_double(env, arena, "free", rest_size);
+      set_named_double(env, arena, "current", current);
+      set_named_double(env, arena, "max", max);
+      set_named_double(env, arena, "aspace", aspace);
+      napi_set_element(env, arenas, idx++, arena);
+      arena = NULL;
+      continue;
+    }
+    read_info_line(line, "total", "fast", &fast_count, &fast_size) ||
+        read_info_line(line, "total", "rest", &rest_count, &rest_size) ||
+        read_info_line(line, "system", "current", NULL, &current) ||
+        read_info_line(line, "system", "max", NULL, &max) ||
+        read_info_line(line, "aspace", "total", NULL, &aspace);
+  }
+  free(xml);
+}
+#endif // defined(__GLIBC__)
+
+/**
+ * object mallocStats(), the statistics of mallinfo2(3) in bytes, with the
+ * per-arena details parsed from malloc_info(3). Returns null if not built
+ * against glibc.
+ */
+napi_value MallocStats(napi_env env, napi_callback_info info) {
+  napi_value returnVal;
+#if defined(__GLIBC__)
+#if defined(HAVE_MALLINFO2)
+  struct mallinfo2 mi = mallinfo2();
+#else
+  /** the int fields wrap beyond 2GB, which is unlikely on devices */
+  struct mallinfo mi = mallinfo();
+#endif // defined(HAVE_MALLINFO2)
+  napi_value arenas;
+  double mmap_count = mi.hblks, mmap_size = mi.hblkhd;
+  NAPI_CALL(env, napi_create_object(env, &returnVal));
+  NAPI_CALL(env, napi_create_array(env, &arenas));
+  read_arenas(env, arenas, &mmap_count, &mmap_size);
+
+  /** non-mmap-ed space allocated from the system */
+  set_named_double(env, returnVal, "arena", (double)mi.arena);
+  set_named_double(env, returnVal, "mmapCount", mmap_count);
+  set_named_double(env, returnVal, "mmap", mmap_size);
+  set_named_double(env, returnVal, "inUse", (double)mi.uordblks);
+  set_named_double(env, returnVal, "freeCount", (double)mi.ordblks);
+  set_named_double(env, returnVal, "free", (double)mi.fordblks);
+  set_named_double(env, returnVal, "fastbinCount", (double)mi.smblks);
+  set_named_double(env, returnVal, "fastbin", (double)mi.fsmblks);
+  /** the releasable top-most chunk, trimmed beyond M_TRIM_THRESHOLD */
+  set_named_double(env, returnVal, "keepcost", (double)mi.keepcost);
+  NAPI_CALL(env, napi_set_named_property(env, returnVal, "arenas", arenas));
+#else
+  NAPI_CALL(env, napi_get_null(env, &returnVal));
+#endif // defined(__GLIBC__)
+  return returnVal;
+}
@@ -0,0 +1,299 @@
+#include "SystemNative.h"
+#include <common.h>
+#include <uv.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+
+#define PSI_MEMORY_PATH "/proc/pressure/memory"
+
+/**
+ * A PSI trigger on /proc/pressure/memory, or a watch on a cgroup v2
+ * memory.events file. Both are polled on the loop thread, no thread is
+ * involved.
+ */
+struct pressure_watcher {
+  int32_t _id;
+  int _fd;
+  bool _psi;
+  std::string _path;
+  napi_env _env;
+  napi_ref _callback;
+  union {
+    uv_poll_t poll;
+    uv_fs_event_t fs_event;
+  } _handle;
+};
+
+static std::map<int32_t, pressure_watcher*> watchers;
+static int32_t next_watcher_id = 1;
+
+static void set_named_double(napi_env env, napi_value obj, const char* key,
+                             double value) {
+  napi_value nval;
+  if (napi_create_double(env, value, &nval) == napi_ok) {
+    napi_set_named_property(env, obj, key, nval);
+  }
+}
+
+/**
+ * Parses the `some` or `full` line of a PSI file into `avg10`, `avg60`,
+ * `avg300` and `total`.
+ */
+static void read_psi_line(napi_env env, napi_value obj, const char* content,
+                          const char* kind) {
+  const char* line = strstr(content, kind);
+  double avg10 = 0, avg60 = 0, avg300 = 0, total = 0;
+  if (line == NULL ||
+      sscanf(line + strlen(kind), " avg10=%lf avg60=%lf avg300=%lf total=%lf",
+             &avg10, &avg60, &avg300, &total) != 4) {
+    return;
+  }
+  napi_value nval;
+  if (napi_create_object(env, &nval) != napi_ok) {
+    return;
+  }
+  set_named_double(env, nval, "avg10", avg10);
+  set_named_double(env, nval, "avg60", avg60);
+  set_named_double(env, nval, "avg300", avg300);
+  /** microseconds */
+  set_named_double(env, nval, "total", total);
+  napi_set_named_property(env, obj, kind, nval);
+}
+
+/**
+ * The pressure of PSI as `{ some, full }`, or the counters of memory.events
+ * as `{ low, high, max, oom, oom_kill }`.
+ */
+static napi_value read_pressure(napi_env env, pressure_watcher* watcher) {
+  char buf[1024];
+  napi_value obj;
+  NAPI_CALL(env, napi_create_object(env, &obj));
+  if (read_proc_file(watcher->_path.c_str(), buf, sizeof(buf)) <= 0) {
+    return obj;
+  }
+  if (watcher->_psi) {
+    read_psi_line(env, obj, buf, "some");
+    read_psi_line(env, obj, buf, "full");
+    return obj;
+  }
+  static const char* keys[] = { "low", "high", "max", "oom", "oom_kill" };
+  for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); ++i) {
+    char* line = buf;
+    size_t keylen = strlen(keys[i]);
+    while (line != NULL && *line != '\0') {
+      if (strncmp(line, keys[i], keylen) == 0 && line[keylen] == ' ') {
+        set_named_double(env, obj, keys[i], strtod(line + keylen + 1, NULL));
+        break;
+      }
+      line = strchr(line, '\n');
+      line = line == NULL ? NULL : line + 1;
+    }
+  }
+  return obj;
+}
+
+static void notify(pressure_watcher* watcher) {
+  napi_env env = watcher->_env;
+  napi_handle_scope scope;
+  napi_value global, cb, argv[2];
+  NAPI_CALL_RETURN_VOID(env, napi_open_handle_scope(env, &scope));
+  NAPI_CALL_RETURN_VOID(env, napi_get_global(env, &global));
+  NAPI_CALL_RETURN_VOID(env, napi_get_reference_value(env, watcher->_callback,
+                                                      &cb));
+  NAPI_CALL_RETURN_VOID(env, napi_create_int32(env, watcher->_id, &argv[0]));
+  argv[1] = read_pressure(env, watcher);
+  if (argv[1] != NULL) {
+    NAPI_CALL_RETURN_VOID(env, napi_make_callback(env, nullptr, global, cb, 2,
+                                                  argv, nullptr));
+  }
+  NAPI_CALL_RETURN_VOID(env, napi_close_handle_scope(env, scope));
+}
+
+static void OnPsiEvent(uv_poll_t* handle, int status, int events) {
+  pressure_watcher* watcher = static_cast<pressure_watcher*>(handle->data);
+  if (status == 0 && (events & UV_PRIORITIZED)) {
+    notify(watcher);
+  }
+}
+
+static void OnMemoryEvents(uv_fs_event_t* handle, const char* filename,
+                           int events, int status) {
+  pressure_watcher* watcher = static_cast<pressure_watcher*>(handle->data);
+  if (status == 0) {
+    notify(watcher);
+  }
+}
+
+static void OnWatcherClose(uv_handle_t* handle) {
+  pressure_watcher* watcher = static_cast<pressure_watcher*>(handle->data);
+  if (watcher->_fd >= 0) {
+    close(watcher->_fd);
+  }
+  delete watcher;
+}
+
+static napi_value create_errno(napi_env env, int err) {
+  napi_value returnVal;
+  NAPI_CALL(env, napi_create_int32(env, -err, &returnVal));
+  return returnVal;
+}
+
+static pressure_watcher* create_watcher(napi_env env, napi_value callback,
+                                        bool psi, const char* path) {
+  pressure_watcher* watcher = new pressure_watcher;
+  watcher->_id = next_watcher_id++;
+  watcher->_fd = -1;
+  watcher->_psi = psi;
+  watcher->_path = path;
+  watcher->_env = env;
+  if (napi_create_reference(env, callback, 1, &watcher->_callback) !=
+      napi_ok) {
+    delete watcher;
+    return NULL;
+  }
+  return watcher;
+}
+
+static void destroy_watcher(napi_env env, pressure_watcher* watcher) {
+  napi_delete_reference(env, watcher->_callback);
+  if (watcher->_fd >= 0) {
+    close(watcher->_fd);
+  }
+  delete watcher;
+}
+
+/**
+ * number watchMemoryPressure(full, stallUs, windowUs, callback), registers
+ * a PSI trigger that fires once the tasks stalled on memory for `stallUs`
+ * within any `windowUs`. `callback(id, pressure)` is invoked on the loop
+ * thread. Returns the id of the watcher, or a negative errno, e.g. -ENOENT
+ * on kernels without PSI.
+ */
+napi_value WatchMemoryPressure(napi_env env, napi_callback_info info) {
+  size_t argc = 4;
+  napi_value argv[4];
+  bool full;
+  int32_t stall_us, window_us;
+  napi_valuetype type;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(env, napi_typeof(env, argv[3], &type));
+  if (argc < 4 || napi_get_value_bool(env, argv[0], &full) != napi_ok ||
+      napi_get_value_int32(env, argv[1], &stall_us) != napi_ok ||
+      napi_get_value_int32(env, argv[2], &window_us) != napi_ok ||
+      type != napi_function || stall_us <= 0 || window_us < stall_us) {
+    return create_errno(env, EINVAL);
+  }
+
+  uv_loop_t* loop;
+  NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+  pressure_watcher* watcher =
+      create_watcher(env, argv[3], true, PSI_MEMORY_PATH);
+  if (watcher == NULL) {
+    return create_errno(env, ENOMEM);
+  }
+  watcher->_fd = open(PSI_MEMORY_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (watcher->_fd < 0) {
+    int err = errno;
+    destroy_watcher(env, watcher);
+    return create_errno(env, err);
+  }
+  char trigger[64];
+  int len = snprintf(trigger, sizeof(trigger), "%s %d %d",
+                     full ? "full" : "some", stall_us, window_us);
+  /** the trigger is written with the terminating null */
+  if (write(watcher->_fd, trigger, len + 1) < 0) {
+    int err = errno;
+    destroy_watcher(env, watcher);
+    return create_errno(env, err);
+  }
+  watcher->_handle.poll.data = watcher;
+  uv_poll_init(loop, &watcher->_handle.poll, watcher->_fd);
+  uv_poll_start(&watcher->_handle.poll, UV_PRIORITIZED, OnPsiEvent);
+  /** never keeps the loop alive */
+  uv_unref((uv_handle_t*)&watcher->_handle.poll);
+  watchers[watcher->_id] = watcher;
+  napi_value returnVal;
+  NAPI_CALL(env, napi_create_int32(env, watcher->_id, &returnVal));
+  return returnVal;
+}
+
+/**
+ * number watchMemoryEvents(path, callback), watches a cgroup v2
+ * memory.events file for modifications. `callback(id, events)` is invoked on
+ * the loop thread. Returns the id of the watcher, or a negative errno.
+ */
+napi_value WatchMemoryEvents(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  napi_valuetype type;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  NAPI_CALL(env, napi_typeof(env, argv[1], &type));
+  size_t pathlen;
+  if (argc < 2 || type != napi_function ||
+      napi_get_value_string_utf8(env, argv[0], NULL, 0, &pathlen) !=
+          napi_ok) {
+    return create_errno(env, EINVAL);
+  }
+  char path[pathlen + 1];
+  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[0], path, pathlen + 1,
+                                            &pathlen));
+  if (access(path, R_OK) != 0) {
+    return create_errno(env, errno);
+  }
+
+  uv_loop_t* loop;
+  NAPI_CALL(env, napi_get_uv_event_loop(env, &loop));
+  pressure_watcher* watcher = create_watcher(env, argv[1], false, path);
+  if (watcher == NULL) {
+    return create_errno(env, ENOMEM);
+  }
+  watcher->_handle.fs_event.data = watcher;
+  uv_fs_event_init(loop, &watcher->_handle.fs_event);
+  int r = uv_fs_event_start(&watcher->_handle.fs_event, OnMemoryEvents, path,
+                            0);
+  if (r != 0) {
+    uv_close((uv_handle_t*)&watcher->_handle.fs_event, OnWatcherClose);
+    napi_delete_reference(env, watcher->_callback);
+    return create_errno(env, -r);
+  }
+  uv_unref((uv_handle_t*)&watcher->_handle.fs_event);
+  watchers[watcher->_id] = watcher;
+  napi_value returnVal;
+  NAPI_CALL(env, napi_create_int32(env, watcher->_id, &returnVal));
+  return returnVal;
+}
+
+/**
+ * boolean unwatchMemoryPressure(id), closes a watcher of
+ * `watchMemoryPressure` or `watchMemoryEvents`.
+ */
+napi_value UnwatchMemoryPressure(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value argv[1];
+  int32_t id = 0;
+  napi_value returnVal;
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+  napi_get_value_int32(env, argv[0], &id);
+  auto it = watchers.find(id);
+  if (it == watchers.end()) {
+    NAPI_CALL(env, napi_get_boolean(env, false, &returnVal));
+    return returnVal;
+  }
+  pressure_watcher* watcher = it->second;
+  watchers.erase(it);
+  napi_delete_reference(env, watcher->_callback);
+  if (watcher->_psi) {
+    uv_poll_stop(&watcher->_handle.poll);
+  } else {
+    uv_fs_event_stop(&watcher->_handle.fs_event);
+  }
+  uv_close((uv_handle_t*)&watcher->_handle, OnWatcherClose);
+  NAPI_CALL(env, napi_get_boolean(env, true, &returnVal));
+  return returnVal;
+}
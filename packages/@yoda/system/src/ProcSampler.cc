@@ -0,0 +1,238 @@
+#include "SystemNative.h"
+#include <common.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* kMeminfoKeys[MEMINFO_FIELDS] = {
+  "MemTotal", "MemFree", "MemAvailable", "Buffers",
+  "Cached",   "SwapTotal", "SwapFree"
+};
+
+ssize_t read_proc_file(const char* path, char* buf, size_t size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  size_t len = 0;
+  while (len + 1 < size) {
+    ssize_t r = read(fd, buf + len, size - len - 1);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      break;
+    }
+    len += r;
+  }
+  close(fd);
+  buf[len] = '\0';
+  return len;
+}
+
+int64_t read_proc_field(const char* content, const char* key) {
+  size_t keylen = strlen(key);
+  const char* it = content;
+  while (it != NULL && *it != '\0') {
+    if (strncmp(it, key, keylen) == 0 && it[keylen] == ':') {
+      return strtoll(it + keylen + 1, NULL, 10);
+    }
+    it = strchr(it, '\n');
+    if (it != NULL) {
+      ++it;
+    }
+  }
+  return -1;
+}
+
+typedef pool_job_carrier<int32_t, int32_t, napi_int32_array>
+    memory_sample_carrier;
+typedef pool_job_carrier<int32_t, double, napi_float64_array>
+    cpu_sample_carrier;
+
+/**
+ * Reads the pids of the array, elements other than numbers are read as -1.
+ */
+static napi_status read_pids(napi_env env, napi_value array,
+                             std::vector<int32_t>& pids) {
+  uint32_t length;
+  napi_status status = napi_get_array_length(env, array, &length);
+  if (status != napi_ok) {
+    return status;
+  }
+  pids.resize(length);
+  for (uint32_t i = 0; i < length; i++) {
+    napi_value nval_pid;
+    status = napi_get_element(env, array, i, &nval_pid);
+    if (status != napi_ok) {
+      return status;
+    }
+    if (napi_get_value_int32(env, nval_pid, &pids[i]) != napi_ok) {
+      pids[i] = -1;
+    }
+  }
+  return napi_ok;
+}
+
+/**
+ * Samples the processes from smaps_rollup, or statm on kernels without it
+ * in which case pss and swap are not available.
+ */
+static void sample_process(int32_t pid, int32_t* out, long page_kb) {
+  char path[64];
+  char buf[4096];
+  out[0] = pid;
+  out[1] = out[2] = out[3] = -1;
+  snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+  if (read_proc_file(path, buf, sizeof(buf)) > 0) {
+    out[1] = (int32_t)read_proc_field(buf, "Rss");
+    out[2] = (int32_t)read_proc_field(buf, "Pss");
+    out[3] = (int32_t)read_proc_field(buf, "Swap");
+    return;
+  }
+  snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+  long size, resident;
+  if (read_proc_file(path, buf, sizeof(buf)) > 0 &&
+      sscanf(buf, "%ld %ld", &size, &resident) == 2) {
+    out[1] = (int32_t)(resident * page_kb);
+  }
+}
+
+static void DoSampleMemory(napi_env env, void* data) {
+  memory_sample_carrier* c = static_cast<memory_sample_carrier*>(data);
+  c->_result.resize(MEMINFO_FIELDS + c->_input.size() * PROCESS_MEMORY_STRIDE);
+  char buf[4096];
+  int32_t* meminfo = c->_result.data();
+  if (read_proc_file("/proc/meminfo", buf, sizeof(buf)) > 0) {
+    for (int i = 0; i < MEMINFO_FIELDS; ++i) {
+      meminfo[i] = (int32_t)read_proc_field(buf, kMeminfoKeys[i]);
+    }
+  } else {
+    for (int i = 0; i < MEMINFO_FIELDS; ++i) {
+      meminfo[i] = -1;
+    }
+  }
+  long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  for (size_t i = 0; i < c->_input.size(); ++i) {
+    sample_process(c->_input[i],
+                   &c->_result[MEMINFO_FIELDS + i * PROCESS_MEMORY_STRIDE],
+                   page_kb);
+  }
+}
+
+/**
+ * sampleMemory(pids, callback), samples /proc/meminfo and the memory of the
+ * processes in one job of the thread pool. `callback(err, sample)` receives
+ * an Int32Array of `MEMINFO_FIELDS` followed by `PROCESS_MEMORY_STRIDE` of
+ * each pid.
+ */
+napi_value SampleMemory(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+  bool is_array;
+  NAPI_CALL(env, napi_is_array(env, argv[0], &is_array));
+  if (!is_array) {
+    napi_throw_type_error(env, nullptr, "The first argument must be an array.");
+    return NULL;
+  }
+  napi_valuetype type;
+  NAPI_CALL(env, napi_typeof(env, argv[1], &type));
+  if (type != napi_function) {
+    napi_throw_type_error(env, nullptr,
+                          "The second argument must be a function.");
+    return NULL;
+  }
+
+  std::vector<int32_t> pids;
+  NAPI_CALL(env, read_pids(env, argv[0], pids));
+  memory_sample_carrier* the_carrier = new memory_sample_carrier;
+  the_carrier->_input.swap(pids);
+  return the_carrier->queue(env, argv[1], "sampleMemory", DoSampleMemory);
+}
+
+/**
+ * Samples utime and stime of all threads from /proc/<pid>/stat, and the run
+ * time, run-queue delay and context switches of the main thread, which runs
+ * the event loop, from /proc/<pid>/schedstat and /proc/<pid>/status.
+ */
+static void sample_cpu(int32_t pid, double* out, double tick_ms) {
+  char path[64];
+  char buf[4096];
+  out[0] = pid;
+  for (int i = 1; i < CPU_SAMPLE_STRIDE; ++i) {
+    out[i] = -1;
+  }
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  if (read_proc_file(path, buf, sizeof(buf)) <= 0) {
+    return;
+  }
+  /** comm may contain spaces and parentheses */
+  const char* fields = strrchr(buf, ')');
+  unsigned long utime, stime;
+  if (fields == NULL ||
+      sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+             &utime, &stime) != 2) {
+    return;
+  }
+  out[1] = utime * tick_ms;
+  out[2] = stime * tick_ms;
+
+  snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+  unsigned long long run_ns, delay_ns;
+  if (read_proc_file(path, buf, sizeof(buf)) > 0 &&
+      sscanf(buf, "%llu %llu", &run_ns, &delay_ns) == 2) {
+    out[3] = run_ns / 1e6;
+    out[4] = delay_ns / 1e6;
+  }
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  if (read_proc_file(path, buf, sizeof(buf)) > 0) {
+    out[5] = read_proc_field(buf, "voluntary_ctxt_switches");
+    out[6] = read_proc_field(buf, "nonvoluntary_ctxt_switches");
+  }
+}
+
+static void DoSampleCpu(napi_env env, void* data) {
+  cpu_sample_carrier* c = static_cast<cpu_sample_carrier*>(data);
+  c->_result.resize(c->_input.size() * CPU_SAMPLE_STRIDE);
+  double tick_ms = 1000.0 / sysconf(_SC_CLK_TCK);
+  for (size_t i = 0; i < c->_input.size(); ++i) {
+    sample_cpu(c->_input[i], &c->_result[i * CPU_SAMPLE_STRIDE], tick_ms);
+  }
+}
+
+/**
+ * sampleCpu(pids, callback), samples the cpu time and the scheduler stats of
+ * the processes in one job of the thread pool. `callback(err, sample)`
+ * receives a Float64Array of `CPU_SAMPLE_STRIDE` of each pid.
+ */
+napi_value SampleCpu(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+  bool is_array;
+  NAPI_CALL(env, napi_is_array(env, argv[0], &is_array));
+  if (!is_array) {
+    napi_throw_type_error(env, nullptr, "The first argument must be an array.");
+    return NULL;
+  }
+  napi_valuetype type;
+  NAPI_CALL(env, napi_typeof(env, argv[1], &type));
+  if (type != napi_function) {
+    napi_throw_type_error(env, nullptr,
+                          "The second argument must be a function.");
+    return NULL;
+  }
+
+  std::vector<int32_t> pids;
+  NAPI_CALL(env, read_pids(env, argv[0], pids));
+  cpu_sample_carrier* the_carrier = new cpu_sample_carrier;
+  the_carrier->_input.swap(pids);
+  return the_carrier->queue(env, argv[1], "sampleCpu", DoSampleCpu);
+}
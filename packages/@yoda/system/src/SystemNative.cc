@@ -1,5 +1,5 @@
 #define _XOPEN_SOURCE
-#include <node_api.h>
+#include "SystemNative.h"
 #if not defined(BUILD_HOST)
 #include <recovery/recovery.h>
 #endif // not defined(BUILD_HOST)
@@ -252,13 +252,6 @@ static napi_value MallocTrim(napi_env env, napi_callback_info info) {
   return NULL;
 }
 
-static napi_value MallocStats(napi_env env, napi_callback_info info) {
-#if defined(__GLIBC__)
-  malloc_stats();
-#endif // defined(__GLIBC__)
-  return NULL;
-}
-
 static napi_value ClockGetTime(napi_env env, napi_callback_info info) {
   clockid_t id;
   size_t argc = 1;
@@ -303,17 +296,27 @@ static napi_value Init(napi_env env, napi_value exports) {
     DECLARE_NAPI_PROPERTY("setRecoveryMode", SetRecoveryMode),
     DECLARE_NAPI_PROPERTY("setRecoveryOk", SetRecoveryOk),
     DECLARE_NAPI_PROPERTY("diskUsage", DiskUsage),
+    DECLARE_NAPI_PROPERTY("queryDiskUsage", QueryDiskUsage),
     DECLARE_NAPI_PROPERTY("strptime", Strptime),
     DECLARE_NAPI_PROPERTY("adjustMallocSettings", AdjustMallocSettings),
     DECLARE_NAPI_PROPERTY("mallocTrim", MallocTrim),
     DECLARE_NAPI_PROPERTY("mallocStats", MallocStats),
     DECLARE_NAPI_PROPERTY("clockGetTime", ClockGetTime),
+    DECLARE_NAPI_PROPERTY("sampleMemory", SampleMemory),
+    DECLARE_NAPI_PROPERTY("sampleCpu", SampleCpu),
+    DECLARE_NAPI_PROPERTY("watchMemoryPressure", WatchMemoryPressure),
+    DECLARE_NAPI_PROPERTY("watchMemoryEvents", WatchMemoryEvents),
+    DECLARE_NAPI_PROPERTY("unwatchMemoryPressure", UnwatchMemoryPressure),
   };
   napi_define_properties(env, exports, sizeof(desc) / sizeof(*desc), desc);
 
   NAPI_SET_CONSTANT(exports, CLOCK_REALTIME);
   NAPI_SET_CONSTANT(exports, CLOCK_MONOTONIC);
   NAPI_SET_CONSTANT(exports, CLOCK_PROCESS_CPUTIME_ID);
+  NAPI_SET_CONSTANT(exports, MEMINFO_FIELDS);
+  NAPI_SET_CONSTANT(exports, PROCESS_MEMORY_STRIDE);
+  NAPI_SET_CONSTANT(exports, CPU_SAMPLE_STRIDE);
+  NAPI_SET_CONSTANT(exports, DISK_USAGE_STRIDE);
   return exports;
 }
 
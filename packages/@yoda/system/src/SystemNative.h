@@ -0,0 +1,129 @@
+#ifndef SYSTEM_NATIVE_H
+#define SYSTEM_NATIVE_H
+
+#include <node_api.h>
+#include <common.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * `[MemTotal, MemFree, MemAvailable, Buffers, Cached, SwapTotal, SwapFree]`
+ * of /proc/meminfo in kB, leading a memory sample.
+ */
+#define MEMINFO_FIELDS 7
+/**
+ * `[pid, rss, pss, swap]` in kB of each process of a memory sample, -1 if the
+ * process is gone or the field is not available.
+ */
+#define PROCESS_MEMORY_STRIDE 4
+/**
+ * `[pid, utime, stime, run, runDelay, voluntarySwitches,
+ * involuntarySwitches]` of each process of a cpu sample. Times are in
+ * milliseconds. The schedstat and the switches are of the main thread. The
+ * fields are -1 if the process is gone or the field is not available.
+ */
+#define CPU_SAMPLE_STRIDE 7
+/**
+ * `[status, available, free, total, files, filesFree]` of each path of a
+ * disk usage query. Sizes are in bytes. Status is 0 or a negative errno, in
+ * which case the other fields are -1.
+ */
+#define DISK_USAGE_STRIDE 6
+
+/**
+ * Reads the whole file at `path` into `buf`, returns the length read or -1.
+ */
+ssize_t read_proc_file(const char* path, char* buf, size_t size);
+
+/**
+ * Reads the `key: value kB` field of /proc files, returns -1 if not found.
+ */
+int64_t read_proc_field(const char* content, const char* key);
+
+/**
+ * The carrier of a job of the thread pool, which works on `_input` and hands
+ * `_result` to `callback(err, result)` as a typed array of `ArrayType`.
+ */
+template <typename Input, typename T, napi_typedarray_type ArrayType>
+struct pool_job_carrier {
+  napi_async_work _request = NULL;
+  napi_ref _callback = NULL;
+  std::vector<Input> _input;
+  std::vector<T> _result;
+
+  /**
+   * Queues the job of `execute`, the carrier is freed and the error is
+   * thrown if it could not be queued.
+   */
+  napi_value queue(napi_env env, napi_value callback, const char* name,
+                   napi_async_execute_callback execute) {
+    napi_value resource_name;
+    if (napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH,
+                                &resource_name) != napi_ok ||
+        napi_create_reference(env, callback, 1, &_callback) != napi_ok ||
+        napi_create_async_work(env, callback, resource_name, execute, After,
+                               this, &_request) != napi_ok ||
+        napi_queue_async_work(env, _request) != napi_ok) {
+      GET_AND_THROW_LAST_ERROR(env);
+      destroy(env);
+    }
+    return NULL;
+  }
+
+  static void After(napi_env env, napi_status status, void* data) {
+    pool_job_carrier* c = static_cast<pool_job_carrier*>(data);
+    c->deliver(env);
+    c->destroy(env);
+  }
+
+ private:
+  void deliver(napi_env env) {
+    napi_value argv[2];
+    NAPI_CALL_RETURN_VOID(env, napi_get_null(env, &argv[0]));
+
+    void* buffer_data;
+    napi_value buffer;
+    size_t size = _result.size() * sizeof(T);
+    NAPI_CALL_RETURN_VOID(env, napi_create_arraybuffer(env, size, &buffer_data,
+                                                       &buffer));
+    if (size > 0) {
+      memcpy(buffer_data, _result.data(), size);
+    }
+    NAPI_CALL_RETURN_VOID(env, napi_create_typedarray(env, ArrayType,
+                                                      _result.size(), buffer,
+                                                      0, &argv[1]));
+
+    napi_value callback;
+    NAPI_CALL_RETURN_VOID(env,
+                          napi_get_reference_value(env, _callback, &callback));
+    napi_value global;
+    NAPI_CALL_RETURN_VOID(env, napi_get_global(env, &global));
+
+    napi_value result;
+    NAPI_CALL_RETURN_VOID(env, napi_call_function(env, global, callback, 2,
+                                                  argv, &result));
+  }
+
+  /** frees the carrier along with its reference and async work */
+  void destroy(napi_env env) {
+    if (_callback != NULL) {
+      napi_delete_reference(env, _callback);
+    }
+    if (_request != NULL) {
+      napi_delete_async_work(env, _request);
+    }
+    delete this;
+  }
+};
+
+napi_value MallocStats(napi_env env, napi_callback_info info);
+napi_value SampleMemory(napi_env env, napi_callback_info info);
+napi_value SampleCpu(napi_env env, napi_callback_info info);
+napi_value QueryDiskUsage(napi_env env, napi_callback_info info);
+napi_value WatchMemoryPressure(napi_env env, napi_callback_info info);
+napi_value WatchMemoryEvents(napi_env env, napi_callback_info info);
+napi_value UnwatchMemoryPressure(napi_env env, napi_callback_info info);
+
+#endif // SYSTEM_NATIVE_H
@@ -89,6 +89,13 @@ class AudioFocus {
     this.api = api
     this.id = ++_id
     this.type = type || AudioFocus.Type.DEFAULT
+    /**
+     * the stream the focus plays on, e.g. `AudioManager.STREAM_PLAYBACK`,
+     * which is never ducked by a transient focus of `TRANSIENT_MAY_DUCK`
+     * of its own.
+     * @type {number}
+     */
+    this.stream = undefined
     this[symbol.state] = AudioFocus.State.INACTIVE
   }
 
@@ -107,7 +114,7 @@ class AudioFocus {
       return Promise.resolve()
     }
     register(this.api, this.id, this)
-    return this.api.request({ id: this.id, gain: this.type })
+    return this.api.request({ id: this.id, gain: this.type, stream: this.stream })
   }
 
   /**
@@ -123,7 +130,10 @@ class AudioFocus {
   onGain () {}
 
   /**
-   * replace `onLoss` listener to get notified on focus changes.
+   * replace `onLoss` listener to get notified on focus changes. On a
+   * transient loss that may duck, the media streams are already ducked by
+   * the runtime, thus the player shall keep playing without lowering its
+   * volume again.
    * @param {boolean} transient
    * @param {boolean} mayDuck
    */
@@ -1,8 +1,301 @@
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <node_api.h>
 #include <common.h>
 #include <syslog.h>
 #include <rklog/RKLog.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Records are queued into a single-producer single-consumer byte ring by the
+ * JavaScript thread without any allocation or lock, and written to rklog and
+ * syslog in batches by a background writer thread.
+ */
+#define LOG_RING_SIZE (64 * 1024)
+#define LOG_TAG_MAX 64
+#define LOG_TEXT_MAX 1280
+#define LOG_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+enum log_record_kind {
+  LOG_RECORD_PADDING = 0,
+  LOG_RECORD_PRINT = 1,
+  LOG_RECORD_SYSLOG = 2,
+};
+
+struct log_record {
+  /** aligned size of the record including the header */
+  uint16_t size;
+  uint8_t kind;
+  /** rklog level, or syslog priority */
+  uint8_t level;
+  uint16_t tag_len;
+  uint16_t text_len;
+  /** followed by the null terminated tag and text */
+};
+
+#define LOG_RECORD_MAX \
+  LOG_ALIGN(sizeof(log_record) + LOG_TAG_MAX + 1 + LOG_TEXT_MAX + 1)
+
+static char ring[LOG_RING_SIZE] __attribute__((aligned(8)));
+/** read position, owned by the consumer */
+static std::atomic<size_t> ring_head(0);
+/** write position, owned by the producer */
+static std::atomic<size_t> ring_tail(0);
+
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<uint64_t> total_written(0);
+static std::atomic<uint64_t> total_dropped(0);
+
+static std::thread writer;
+static std::mutex writer_mutex;
+static std::condition_variable writer_cond;
+static std::atomic<bool> writer_waiting(false);
+static bool writer_stopping = false;
+/** serializes the consumers, i.e. the writer thread and flushes */
+static std::mutex drain_mutex;
+
+/** the ident of the persistent openlog, syslog keeps the pointer */
+static std::string syslog_ident;
+static bool syslog_opened = false;
+
+static void write_record(log_record* record) {
+  char* tag = (char*)(record + 1);
+  char* text = tag + record->tag_len + 1;
+  if (record->kind == LOG_RECORD_PRINT) {
+    jslog(record->level, NULL, 0, tag, "%s", text);
+    return;
+  }
+  /** reopens the log only if the ident changed */
+  if (!syslog_opened || syslog_ident != tag) {
+    if (syslog_opened) {
+      closelog();
+    }
+    syslog_ident = tag;
+    openlog(syslog_ident.empty() ? NULL : syslog_ident.c_str(),
+            syslog_ident.empty() ? LOG_PID : 0, LOG_USER);
+    syslog_opened = true;
+  }
+  syslog(record->level, "%s", text);
+}
+
+/**
+ * Writes all records queued, returns the number of records written. Shall
+ * be called with `drain_mutex` held.
+ */
+static size_t drain_locked() {
+  size_t head = ring_head.load(std::memory_order_relaxed);
+  size_t tail = ring_tail.load(std::memory_order_acquire);
+  size_t count = 0;
+  while (head != tail) {
+    log_record* record = (log_record*)(ring + head % LOG_RING_SIZE);
+    if (record->kind != LOG_RECORD_PADDING) {
+      write_record(record);
+      ++count;
+    }
+    head += record->size;
+    ring_head.store(head, std::memory_order_release);
+  }
+  uint32_t lost = dropped.exchange(0);
+  if (lost > 0) {
+    total_dropped += lost;
+    jslog(4 /** warn */, NULL, 0, "logger", "%u messages dropped", lost);
+  }
+  total_written += count;
+  return count;
+}
+
+static void drain() {
+  std::lock_guard<std::mutex> guard(drain_mutex);
+  drain_locked();
+}
+
+static bool ring_empty() {
+  return ring_head.load() == ring_tail.load();
+}
+
+static void RunWriter() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  while (true) {
+    lock.unlock();
+    drain();
+    lock.lock();
+    writer_waiting = true;
+    writer_cond.wait(lock, [] {
+      return writer_stopping || !ring_empty() || dropped.load() > 0;
+    });
+    writer_waiting = false;
+    if (writer_stopping) {
+      break;
+    }
+  }
+  lock.unlock();
+  drain();
+}
+
+static void StopWriter() {
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_stopping = true;
+  }
+  writer_cond.notify_one();
+  if (writer.joinable()) {
+    writer.join();
+  }
+}
+
+static const int kCrashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE,
+                                     SIGABRT };
+static struct sigaction prev_actions[sizeof(kCrashSignals) /
+                                     sizeof(*kCrashSignals)];
+/** duplicated from stderr on start, written on crashes only */
+static int crash_fd = -1;
+
+/**
+ * Writes the records queued before the process dies to `crash_fd` as
+ * `tag: text` lines, then chains to the previous handler. Only write(2) and
+ * the lock-free positions of the ring are touched, as rklog and syslog take
+ * locks and allocate, which may deadlock in a signal handler. The ring is
+ * left as is, a record being drained by the writer may be written twice.
+ */
+static void OnCrash(int signo) {
+  size_t head = ring_head.load(std::memory_order_acquire);
+  size_t tail = ring_tail.load(std::memory_order_acquire);
+  while (crash_fd >= 0 && head != tail) {
+    log_record* record = (log_record*)(ring + head % LOG_RING_SIZE);
+    if (record->size == 0) {
+      break;
+    }
+    if (record->kind != LOG_RECORD_PADDING) {
+      char* tag = (char*)(record + 1);
+      char* text = tag + record->tag_len + 1;
+      struct iovec iov[4] = {
+        { tag, record->tag_len },
+        { (void*)": ", record->tag_len > 0 ? 2u : 0u },
+        { text, record->text_len },
+        { (void*)"\n", 1 },
+      };
+      if (writev(crash_fd, iov, 4) < 0) {
+        break;
+      }
+    }
+    head += record->size;
+  }
+  for (size_t i = 0; i < sizeof(kCrashSignals) / sizeof(*kCrashSignals);
+       ++i) {
+    if (kCrashSignals[i] == signo) {
+      sigaction(signo, &prev_actions[i], NULL);
+      break;
+    }
+  }
+  raise(signo);
+}
+
+static void StartWriter() {
+  writer = std::thread(RunWriter);
+  atexit(StopWriter);
+  crash_fd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 0);
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = OnCrash;
+  sigemptyset(&action.sa_mask);
+  for (size_t i = 0; i < sizeof(kCrashSignals) / sizeof(*kCrashSignals);
+       ++i) {
+    sigaction(kCrashSignals[i], &action, &prev_actions[i]);
+  }
+}
+
+/**
+ * Reserves a record of `LOG_RECORD_MAX` contiguous bytes, returns NULL and
+ * counts the record dropped if the ring is full.
+ */
+static log_record* reserve_record(size_t* tail) {
+  size_t head = ring_head.load(std::memory_order_acquire);
+  size_t pos = ring_tail.load(std::memory_order_relaxed);
+  size_t offset = pos % LOG_RING_SIZE;
+  size_t padding = 0;
+  if (LOG_RING_SIZE - offset < LOG_RECORD_MAX) {
+    padding = LOG_RING_SIZE - offset;
+  }
+  if (LOG_RING_SIZE - (pos - head) < padding + LOG_RECORD_MAX) {
+    ++dropped;
+    return NULL;
+  }
+  if (padding > 0) {
+    log_record* pad = (log_record*)(ring + offset);
+    pad->size = (uint16_t)padding;
+    pad->kind = LOG_RECORD_PADDING;
+    pos += padding;
+  }
+  *tail = pos;
+  return (log_record*)(ring + pos % LOG_RING_SIZE);
+}
+
+static void commit_record(log_record* record, size_t tail) {
+  record->size = (uint16_t)LOG_ALIGN(sizeof(log_record) + record->tag_len +
+                                     1 + record->text_len + 1);
+  ring_tail.store(tail + record->size);
+  if (writer_waiting.load()) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_cond.notify_one();
+  }
+}
+
+/**
+ * Queues a record of `kind` with the tag and text of the JavaScript values,
+ * which are copied into the ring directly.
+ */
+static napi_status queue_record(napi_env env, uint8_t kind, int32_t level,
+                                napi_value tag, napi_value text) {
+  static std::once_flag started;
+  std::call_once(started, StartWriter);
+
+  size_t tail;
+  log_record* record = reserve_record(&tail);
+  if (record == NULL) {
+    return napi_ok;
+  }
+  record->kind = kind;
+  record->level = (uint8_t)level;
+  char* tag_buf = (char*)(record + 1);
+  size_t len = 0;
+  napi_valuetype type = napi_undefined;
+  if (tag != NULL) {
+    napi_typeof(env, tag, &type);
+  }
+  if (type == napi_string) {
+    napi_status status = napi_get_value_string_utf8(env, tag, tag_buf,
+                                                    LOG_TAG_MAX + 1, &len);
+    if (status != napi_ok) {
+      return status;
+    }
+  }
+  tag_buf[len] = '\0';
+  record->tag_len = (uint16_t)len;
+
+  char* text_buf = tag_buf + len + 1;
+  len = 0;
+  napi_status status = napi_get_value_string_utf8(env, text, text_buf,
+                                                  LOG_TEXT_MAX + 1, &len);
+  if (status != napi_ok) {
+    return status;
+  }
+  text_buf[len] = '\0';
+  record->text_len = (uint16_t)len;
+  commit_record(record, tail);
+  return napi_ok;
+}
 
 static napi_value Syslog(napi_env env, napi_callback_info info) {
   size_t argc = 3;
@@ -14,36 +307,10 @@ static napi_value Syslog(napi_env env, napi_callback_info info) {
     return NULL;
   }
 
-  napi_valuetype ident_type;
-  char* ident = NULL;
-  NAPI_CALL(env, napi_typeof(env, argv[0], &ident_type));
-  if (ident_type == napi_string) {
-    size_t ident_len = 0;
-    NAPI_CALL(env,
-              napi_get_value_string_utf8(env, argv[0], NULL, 0, &ident_len));
-    ident = (char*)malloc(sizeof(char) * (ident_len + 1));
-    NAPI_CALL(env, napi_get_value_string_utf8(env, argv[0], ident,
-                                              ident_len + 1, &ident_len));
-    ident[ident_len] = '\0';
-  }
-
   int priority = 0;
   NAPI_CALL(env, napi_get_value_int32(env, argv[1], &priority));
-
-  size_t msg_len = 0;
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[2], NULL, 0, &msg_len));
-  char msg[msg_len + 1];
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[2], msg, msg_len + 1,
-                                            &msg_len));
-  msg[msg_len] = '\0';
-
-  openlog(ident, ident == NULL ? LOG_PID : 0, LOG_USER);
-  syslog(priority, "%s", msg);
-  closelog();
-
-  if (ident != NULL) {
-    free(ident);
-  }
+  NAPI_CALL(env, queue_record(env, LOG_RECORD_SYSLOG, priority, argv[0],
+                              argv[2]));
   return NULL;
 }
 
@@ -59,22 +326,243 @@ static napi_value Print(napi_env env, napi_callback_info info) {
 
   int32_t level = -1;
   NAPI_CALL(env, napi_get_value_int32(env, argv[0], &level));
+  NAPI_CALL(env, queue_record(env, LOG_RECORD_PRINT, level, argv[1], argv[2]));
+  return NULL;
+}
+
+/**
+ * flush(), writes the records queued on the calling thread, e.g. before the
+ * process is killed.
+ */
+static napi_value Flush(napi_env env, napi_callback_info info) {
+  drain();
+  return NULL;
+}
+
+/**
+ * object getStats(), `{ written, dropped, pending }` of the records.
+ */
+static napi_value GetStats(napi_env env, napi_callback_info info) {
+  napi_value obj, nval;
+  NAPI_CALL(env, napi_create_object(env, &obj));
+  NAPI_CALL(env, napi_create_double(env, (double)total_written.load(), &nval));
+  NAPI_CALL(env, napi_set_named_property(env, obj, "written", nval));
+  NAPI_CALL(env, napi_create_double(env, (double)(total_dropped.load() +
+                                                  dropped.load()),
+                                    &nval));
+  NAPI_CALL(env, napi_set_named_property(env, obj, "dropped", nval));
+  NAPI_CALL(env, napi_create_double(env, (double)(ring_tail.load() -
+                                                  ring_head.load()),
+                                    &nval));
+  NAPI_CALL(env, napi_set_named_property(env, obj, "pending", nval));
+  return obj;
+}
+
+/**
+ * The log levels shared by all processes through a memory mapped file of
+ * `LOG_LEVEL_ENTRY` sized entries. Entry 0 is the header, its byte 0 is the
+ * level of all tags. The others are claimed by tags on their first level set
+ * and never released, each holds the level at byte 0, 0 if not set, and the
+ * NUL terminated tag name afterwards. The generation in the header is bumped
+ * once an entry is claimed, so readers know to look their tags up again.
+ *
+ * The file is writable by its owner only, levels are read-only to processes
+ * of other users and local to the process if the file could not be mapped.
+ * Changes are made with the file locked by `flock()`.
+ */
+#define LOG_LEVELS_PATH "/var/run/yoda-logger.levels"
+#define LOG_LEVELS_SIZE 16384
+#define LOG_LEVEL_ENTRY 64
+#define LOG_LEVEL_GENERATION_OFFSET 4
+#define LOG_LEVEL_MAGIC_OFFSET 8
+#define LOG_LEVEL_MAGIC 0x594c5631 /** YLV1 */
+/** stored for level `none` as 0 means not set */
+#define LOG_LEVEL_SILENT 6
+
+static uint8_t* levels = NULL;
+/** -1 if the levels are local to the process */
+static int levels_fd = -1;
+static bool levels_writable = false;
+
+static void lock_levels() {
+  if (levels_fd >= 0) {
+    while (flock(levels_fd, LOCK_EX) != 0 && errno == EINTR) {
+    }
+  }
+}
+
+static void unlock_levels() {
+  if (levels_fd >= 0) {
+    flock(levels_fd, LOCK_UN);
+  }
+}
+
+/**
+ * The level of all tags the table is seeded with, from `YODA_LOG_LEVEL` of
+ * the process creating it, which is expected to match the level rklog is
+ * configured with. Either a level name or its value, 0 if not set.
+ */
+static uint8_t configured_level() {
+  static const char* names[] = { "none", "verbose", "debug",
+                                 "info", "warn",    "error" };
+  const char* value = getenv("YODA_LOG_LEVEL");
+  if (value == NULL || value[0] == '\0') {
+    return 0;
+  }
+  for (int level = 0; level < 6; ++level) {
+    if (strcmp(value, names[level]) == 0 ||
+        (value[0] == '0' + level && value[1] == '\0')) {
+      return level == 0 ? LOG_LEVEL_SILENT : level;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Initializes the table unless initialized already, with the levels locked.
+ */
+static void seed_levels() {
+  uint32_t magic;
+  memcpy(&magic, levels + LOG_LEVEL_MAGIC_OFFSET, sizeof(magic));
+  if (magic == LOG_LEVEL_MAGIC) {
+    return;
+  }
+  memset(levels, 0, LOG_LEVELS_SIZE);
+  levels[0] = configured_level();
+  magic = LOG_LEVEL_MAGIC;
+  memcpy(levels + LOG_LEVEL_MAGIC_OFFSET, &magic, sizeof(magic));
+}
 
-  size_t s1 = 0;
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[1], NULL, 0, &s1));
-  char* tag = (char*)malloc(s1 + 1);
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[1], tag, s1 + 1, &s1));
-  tag[s1] = 0;
-
-  size_t s2 = 0;
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[2], NULL, 0, &s2));
-  char* text = (char*)malloc(s2 + 1);
-  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[2], text, s2 + 1, &s2));
-  text[s2] = 0;
-
-  jslog(level, NULL, 0, tag, "%s", text);
-  free(tag);
-  free(text);
+static void map_levels() {
+  static uint8_t local_levels[LOG_LEVELS_SIZE];
+  levels = local_levels;
+  levels_writable = true;
+  int fd = open(LOG_LEVELS_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  bool writable = fd >= 0;
+  if (fd < 0) {
+    fd = open(LOG_LEVELS_PATH, O_RDONLY | O_CLOEXEC);
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fd >= 0 && fstat(fd, &st) == 0 &&
+      (st.st_size >= LOG_LEVELS_SIZE ||
+       (writable && ftruncate(fd, LOG_LEVELS_SIZE) == 0))) {
+    addr = mmap(NULL, LOG_LEVELS_SIZE,
+                writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd,
+                0);
+  }
+  if (addr == MAP_FAILED) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    seed_levels();
+    return;
+  }
+  levels = (uint8_t*)addr;
+  levels_fd = fd;
+  levels_writable = writable;
+  if (writable) {
+    lock_levels();
+    seed_levels();
+    unlock_levels();
+  }
+}
+
+/**
+ * Finds the entry of the tag, or claims a free one if `claim`, with the
+ * levels locked. Returns 0 if not found or the table is full.
+ */
+static size_t find_level_entry(const char* tag, bool claim) {
+  for (size_t offset = LOG_LEVEL_ENTRY; offset < LOG_LEVELS_SIZE;
+       offset += LOG_LEVEL_ENTRY) {
+    char* name = (char*)levels + offset + 1;
+    if (name[0] == '\0') {
+      /** entries are claimed in order, none is found after a free one */
+      if (!claim) {
+        return 0;
+      }
+      /** the first byte last, lock-free readers skip a partial name */
+      strcpy(name + 1, tag + 1);
+      name[0] = tag[0];
+      uint32_t generation;
+      memcpy(&generation, levels + LOG_LEVEL_GENERATION_OFFSET,
+             sizeof(generation));
+      ++generation;
+      memcpy(levels + LOG_LEVEL_GENERATION_OFFSET, &generation,
+             sizeof(generation));
+      return offset;
+    }
+    if (strcmp(name, tag) == 0) {
+      return offset;
+    }
+  }
+  return 0;
+}
+
+/**
+ * ArrayBuffer getLevels(), the shared log levels, which are read on each log
+ * and written by `setLevel` of any process.
+ */
+static napi_value GetLevels(napi_env env, napi_callback_info info) {
+  if (levels == NULL) {
+    map_levels();
+  }
+  napi_value buffer;
+  NAPI_CALL(env, napi_create_external_arraybuffer(env, levels,
+                                                  LOG_LEVELS_SIZE, NULL, NULL,
+                                                  &buffer));
+  return buffer;
+}
+
+/**
+ * setLevel(tag, level), sets the stored level of the tag, or of all tags if
+ * the tag is null. Throws if the levels are read-only to the process, the
+ * tag is too long or no entry is left for it.
+ */
+static napi_value SetLevel(napi_env env, napi_callback_info info) {
+  size_t argc = 2;
+  napi_value argv[2];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+  int32_t level = 0;
+  NAPI_CALL(env, napi_get_value_int32(env, argv[1], &level));
+  if (levels == NULL) {
+    map_levels();
+  }
+  if (!levels_writable) {
+    NAPI_CALL(env, napi_throw_error(env, NULL,
+                                    "log levels are read-only to the "
+                                    "process"));
+    return NULL;
+  }
+
+  napi_valuetype type;
+  NAPI_CALL(env, napi_typeof(env, argv[0], &type));
+  if (type != napi_string) {
+    levels[0] = (uint8_t)level;
+    return NULL;
+  }
+  char tag[LOG_LEVEL_ENTRY];
+  size_t length = 0;
+  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[0], NULL, 0, &length));
+  if (length == 0 || length >= LOG_LEVEL_ENTRY - 1) {
+    NAPI_CALL(env, napi_throw_range_error(env, NULL,
+                                          "log tag should be of 1 to 62 "
+                                          "bytes"));
+    return NULL;
+  }
+  NAPI_CALL(env, napi_get_value_string_utf8(env, argv[0], tag, sizeof(tag),
+                                            &length));
+  lock_levels();
+  /** a level reset does not claim an entry */
+  size_t offset = find_level_entry(tag, level != 0);
+  if (offset != 0) {
+    levels[offset] = (uint8_t)level;
+  }
+  unlock_levels();
+  if (offset == 0 && level != 0) {
+    NAPI_CALL(env, napi_throw_error(env, NULL, "no log level entry left"));
+  }
   return NULL;
 }
 
@@ -101,10 +589,15 @@ static napi_value EnableCloud(napi_env env, napi_callback_info info) {
 }
 
 static napi_value Init(napi_env env, napi_value exports) {
-  napi_property_descriptor desc[] = { DECLARE_NAPI_PROPERTY("syslog", Syslog),
-                                      DECLARE_NAPI_PROPERTY("print", Print),
-                                      DECLARE_NAPI_PROPERTY("enableCloud",
-                                                            EnableCloud) };
+  napi_property_descriptor desc[] = {
+    DECLARE_NAPI_PROPERTY("syslog", Syslog),
+    DECLARE_NAPI_PROPERTY("print", Print),
+    DECLARE_NAPI_PROPERTY("flush", Flush),
+    DECLARE_NAPI_PROPERTY("getStats", GetStats),
+    DECLARE_NAPI_PROPERTY("getLevels", GetLevels),
+    DECLARE_NAPI_PROPERTY("setLevel", SetLevel),
+    DECLARE_NAPI_PROPERTY("enableCloud", EnableCloud)
+  };
   NAPI_CALL(env, napi_define_properties(env, exports,
                                         sizeof(desc) / sizeof(*desc), desc));
   return exports;
@@ -22,6 +22,25 @@ try {
   ]
   native = {
     enableCloud: function () {},
+    flush: function () {},
+    getStats: function () {
+      return { written: 0, dropped: 0, pending: 0 }
+    },
+    getLevels: function () {
+      /** not shared across processes */
+      return new ArrayBuffer(16384)
+    },
+    setLevel: function (tag, level) {
+      if (tag == null) {
+        sharedLevels[0] = level
+        return
+      }
+      var offset = levelEntryOf(tag)
+      if (offset === 0 && level !== 0) {
+        offset = claimLevelEntry(tag)
+      }
+      sharedLevels[offset] = level
+    },
     print: function native (lvl, tag, line) {
       var fn = consoleLevels[lvl]
       var level = Object.keys(logLevels)[lvl - 1]
@@ -39,12 +58,106 @@ var logLevels = {
   'error': 5
 }
 
+/**
+ * The log levels shared by all processes, in entries of `LevelEntrySize`
+ * bytes. Byte 0 is the level of all tags, the other entries are claimed by
+ * tags with their own levels and hold the level followed by the tag name.
+ * A log is printed only if its level is not less than the level of its tag,
+ * or of all tags if not set.
+ */
+var sharedLevels = new Uint8Array(native.getLevels())
+/** bumped once an entry is claimed, tags are looked up again then */
+var levelGeneration = new Uint32Array(sharedLevels.buffer, 4, 1)
+var LevelEntrySize = 64
+/** stored for level `none` as `0` means not set */
+var LevelSilent = logLevels.error + 1
+
+/**
+ * Returns the offset of the entry of the tag, 0 if the tag has none.
+ */
+function levelEntryOf (name) {
+  var bytes = Buffer.from(name)
+  if (bytes.length >= LevelEntrySize - 1) {
+    return 0
+  }
+  for (var offset = LevelEntrySize; offset < sharedLevels.length; offset += LevelEntrySize) {
+    /** entries are claimed in order */
+    if (sharedLevels[offset + 1] === 0) {
+      return 0
+    }
+    var i = 0
+    while (i < bytes.length && sharedLevels[offset + 1 + i] === bytes[i]) {
+      ++i
+    }
+    if (i === bytes.length && sharedLevels[offset + 1 + i] === 0) {
+      return offset
+    }
+  }
+  return 0
+}
+
+/**
+ * Claims a free entry for the tag in the local levels, see `setLevel` of
+ * the addon for the shared ones.
+ */
+function claimLevelEntry (name) {
+  var bytes = Buffer.from(name)
+  if (bytes.length === 0 || bytes.length >= LevelEntrySize - 1) {
+    throw new RangeError('log tag should be of 1 to 62 bytes')
+  }
+  for (var offset = LevelEntrySize; offset < sharedLevels.length; offset += LevelEntrySize) {
+    if (sharedLevels[offset + 1] === 0) {
+      sharedLevels.set(bytes, offset + 1)
+      ++levelGeneration[0]
+      return offset
+    }
+  }
+  throw new Error('no log level entry left')
+}
+
+/**
+ * Returns the level of the logger, looking its tag up again only once an
+ * entry has been claimed since.
+ */
+function levelOf (logger) {
+  var generation = levelGeneration[0]
+  if (logger.levelGeneration !== generation) {
+    logger.levelGeneration = generation
+    logger.levelEntry = levelEntryOf(logger.name)
+  }
+  /** entry 0 holds the level of all tags */
+  return sharedLevels[logger.levelEntry] || sharedLevels[0]
+}
+
+function levelValueOf (level) {
+  if (typeof level === 'string') {
+    level = logLevels[level]
+  }
+  if (typeof level !== 'number' || !(level >= logLevels.none && level <= logLevels.error)) {
+    throw new Error(`log level should between [${logLevels.none},${logLevels.error}]`)
+  }
+  return level === logLevels.none ? LevelSilent : level
+}
+
 /**
  * @constructor
  * @param {String} name - the logger name
  */
 function Logger (name) {
   this.name = name || 'default'
+  this.levelEntry = 0
+  this.levelGeneration = -1
+}
+
+/**
+ * Check if logs of the level would be printed, so that expensive arguments
+ * could be skipped.
+ *
+ * @param {string} level
+ * @returns {boolean}
+ */
+Logger.prototype.isLevelEnabled = function isLevelEnabled (level) {
+  return logLevels[level] >= levelOf(this)
 }
 
 function createLoggerFunction (level) {
@@ -53,6 +166,10 @@ function createLoggerFunction (level) {
     level = 3 // info
   }
   return function printlog () {
+    /** returns before any formatting if the level is disabled */
+    if (level < levelOf(this)) {
+      return
+    }
     var line = ''
     if (arguments.length === 1) {
       line = util.formatValue(arguments[0])
@@ -145,7 +262,76 @@ module.exports.setGlobalUploadLevel = function (level, authorization) {
 
 module.exports.levels = logLevels
 
+/**
+ * Set the log level of a tag, or of all tags. It takes effect immediately in
+ * all processes of the user owning the levels, which are read-only to the
+ * others. Up to 255 tags could have their own levels.
+ *
+ * @example
+ * var setLevel = require('logger').setLevel
+ * setLevel('warn')
+ * setLevel('debug', 'scheduler')
+ *
+ * @function setLevel
+ * @param {string|number} level - `none` to disable the logs.
+ * @param {string} [tag] - all tags if omitted.
+ * @throws {error} level out of range
+ * @throws {error} levels read-only to the process, or no entry left for tag
+ * @throws {RangeError} tag longer than 62 bytes
+ */
+module.exports.setLevel = function setLevel (level, tag) {
+  native.setLevel(tag == null ? null : String(tag), levelValueOf(level))
+}
+
+/**
+ * Reset the log level of a tag to the level of all tags.
+ *
+ * @function resetLevel
+ * @param {string} tag
+ */
+module.exports.resetLevel = function resetLevel (tag) {
+  native.setLevel(String(tag), 0)
+}
+
+/**
+ * Get the effective log level of a tag, or of all tags.
+ *
+ * @function getLevel
+ * @param {string} [tag]
+ * @returns {string} name of the level.
+ */
+module.exports.getLevel = function getLevel (tag) {
+  var value = sharedLevels[tag == null ? 0 : levelEntryOf(String(tag))]
+  value = value || sharedLevels[0]
+  if (value === LevelSilent) {
+    return 'none'
+  }
+  return Object.keys(logLevels)[Math.max(value, logLevels.verbose)]
+}
+
 module.exports.syslog = function syslog (message, priority, identity) {
   priority = priority == null ? /** LOG_DEBUG */7 : priority
   native.syslog(identity, priority, message)
 }
+
+/**
+ * Write the logs queued to the background writer on the calling thread,
+ * e.g. before the process is killed. Logs are flushed on exit and on crash
+ * signals otherwise.
+ *
+ * @function flush
+ */
+module.exports.flush = function flush () {
+  native.flush()
+}
+
+/**
+ * Get the statistics of the logs of the process.
+ *
+ * @function getStats
+ * @returns {object} `{ written, dropped, pending }`, where `dropped` are the
+ * logs dropped due to a full queue, and `pending` are the bytes queued.
+ */
+module.exports.getStats = function getStats () {
+  return native.getStats()
+}
@@ -13,10 +13,7 @@ module.exports = function awake (light, data, callback) {
       stop: () => light.stop(false)
     }
   } else {
-    light.transition(from, to, 100, 15, (r, g, b, last) => {
-      light.fill(r, g, b)
-      light.render()
-    })
+    light.transition(from, to, 100, 15)
     return {
       stop: () => light.stop(true)
     }
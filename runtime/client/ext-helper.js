@@ -7,6 +7,8 @@ var flora = require('@yoda/flora')
 var endoscope = require('@yoda/endoscope')
 var FloraExporter = require('@yoda/endoscope/exporter/flora')
 var pony = require('@yoda/oh-my-little-pony')
+var property = require('@yoda/property')
+var system = require('@yoda/system')
 var mkdirpSync = require('@yoda/util/fs').mkdirpSync
 
 var apiSymbol = Symbol.for('yoda#api')
@@ -22,6 +24,7 @@ function terminate () {
    * FIXME: https://github.com/yodaos-project/ShadowNode/issues/373
    * force process to exit without any proceeding.
    */
+  require('logger').flush()
   process.kill(process.pid, 'SIGKILL')
 }
 
@@ -49,6 +52,11 @@ function main (target, descriptorPath, runner) {
   var appId = pkg.name
   logger = require('logger')(`entry-${appId}`)
   endoscope.addExporter(new FloraExporter('yodaos.endoscope.export'))
+  /** malloc statistics of apps are reported only if an interval is set */
+  var mallocStatsInterval = Number(property.get('sys.malloc_stats.interval', 'persist'))
+  if (mallocStatsInterval > 0) {
+    system.reportMallocStats(mallocStatsInterval, { name: appId })
+  }
 
   var main = `${target}/${pkg.main || 'app.js'}`
 
@@ -1,5 +1,6 @@
 'use strict'
 var EventEmitter = require('events')
+var inputLatency = require('@yoda/input/latency')
 
 /**
  * interface Descriptor {
@@ -72,6 +73,9 @@ var PropertyDescriptions = {
   event: function Event (name, descriptor, namespace, nsDescriptor, bridge) {
     /** Should use namespace descriptor as this since property descriptor is a plain object */
     bridge.subscribe(nsDescriptor.name, name, function onEvent () {
+      if (nsDescriptor.name === 'keyboard') {
+        inputLatency.observe('app', name, arguments[0])
+      }
       EventEmitter.prototype.emit.apply(
         namespace,
         [ name ].concat(Array.prototype.slice.call(arguments, 0))
@@ -1,6 +1,7 @@
 'use strict'
 var EventEmitter = require('events')
 var logger = require('logger')('@ipc')
+var inputLatency = require('@yoda/input/latency')
 var agent = null
 var FAUNA_TIMEOUT = 10000
 
@@ -121,6 +122,9 @@ var PropertyDescriptions = {
     descriptor.subscribed = true
     var channel = `event:${nsDescriptor.name ? nsDescriptor.name + ':' : ''}${name}`
     messageRegistry[channel] = function onEvent (params) {
+      if (nsDescriptor.name === 'keyboard') {
+        inputLatency.observe('app', name, params[0])
+      }
       EventEmitter.prototype.emit.apply(namespace, [ name ].concat(params))
     }
 
@@ -13,6 +13,13 @@ var endoscope = require('@yoda/endoscope')
 var appLaunchDurationHistogram = new endoscope.Histogram('yodaos:runtime:app_launch_duration', [ 'type', 'mode', 'appId' ])
 var appSuspendDurationHistogram = new endoscope.Histogram('yodaos:runtime:app_suspend_duration', [ 'appId', 'force', 'gcore' ])
 var appNotRespondingCounter = new endoscope.Counter('yodaos:runtime:app_not_responding', [ 'appId', 'pid' ])
+var appCpuHistogram = new endoscope.Histogram('yodaos:runtime:app_cpu', [ 'appId', 'stat' ])
+var appStarvedCounter = new endoscope.Counter('yodaos:runtime:app_starved', [ 'appId', 'pid' ])
+
+/** seconds without alive reports that an app is considered not responding */
+var AnrTimeout = 15
+/** seconds that an app starved on cpu is tolerated without alive reports */
+var AnrStarvedTimeout = 60
 
 module.exports = AppScheduler
 function AppScheduler (runtime) {
@@ -29,6 +36,8 @@ function AppScheduler (runtime) {
   this.appSuspensionFutures = {}
 
   this.anrSentinelTimer = null
+  /** pid -> cpu sample of the last sentinel round */
+  this.cpuMemo = {}
 }
 
 AppScheduler.prototype.init = function init () {
@@ -288,22 +297,87 @@ AppScheduler.prototype.suspendApp = function suspendApp (appId, options) {
 }
 
 AppScheduler.prototype.anrSentinel = function anrSentinel () {
-  var now = system.clockGetTime(system.CLOCK_MONOTONIC).sec
-  return Promise.all(
-    Object.keys(this.appMap)
-      .map(appId => {
-        var bridge = this.appMap[appId]
-        var lastReportTimestamp = bridge.lastReportTimestamp
-        if (isNaN(lastReportTimestamp)) {
-          return
-        }
-        var delta = now - lastReportTimestamp
-        if (delta < 15 /** 15s */) {
+  var pids = Object.keys(this.appMap)
+    .map(appId => this.appMap[appId].pid)
+    .filter(pid => pid > 0)
+  return this.sampleCpu(pids)
+    .then(usages => {
+      var now = system.clockGetTime(system.CLOCK_MONOTONIC).sec
+      return Promise.all(
+        Object.keys(this.appMap)
+          .map(appId => {
+            var bridge = this.appMap[appId]
+            var usage = usages[bridge.pid]
+            var lastReportTimestamp = bridge.lastReportTimestamp
+            if (isNaN(lastReportTimestamp)) {
+              return
+            }
+            var delta = now - lastReportTimestamp
+            if (delta < AnrTimeout) {
+              return
+            }
+            if (delta < AnrStarvedTimeout && isStarved(usage)) {
+              logger.warn(`ANR: app(${appId}) has not been reported alive for ${delta}s, but it's starved on cpu (run ${usage.run}ms, waited ${usage.runDelay}ms).`)
+              appStarvedCounter.inc({ appId: appId, pid: bridge.pid })
+              return
+            }
+            logger.warn(`ANR: app(${appId}) has not been reported alive for ${delta}s.`)
+            appNotRespondingCounter.inc({ appId: appId, pid: bridge.pid })
+            return this.suspendApp(appId, { gcore: true })
+          })
+      )
+    })
+}
+
+/**
+ * Sample the cpu of app processes, and observe the usage since the last
+ * sample.
+ *
+ * @private
+ * @param {number[]} pids
+ * @returns {Promise<object>} pid -> usage since the last sample, processes
+ * sampled for the first time are omitted.
+ */
+AppScheduler.prototype.sampleCpu = function sampleCpu (pids) {
+  return new Promise(resolve => {
+    system.sampleCpu(pids, (err, sample) => {
+      if (err) {
+        logger.warn('unexpected error on sampling cpu', err.stack)
+        return resolve({})
+      }
+      var processes = system.decodeCpuSample(sample)
+      var usages = {}
+      Object.keys(processes).forEach(pid => {
+        var curr = processes[pid]
+        var prev = this.cpuMemo[pid]
+        if (prev == null) {
           return
         }
-        logger.warn(`ANR: app(${appId}) has not been reported alive for ${delta}s.`)
-        appNotRespondingCounter.inc({ appId: appId, pid: bridge.pid })
-        return this.suspendApp(appId, { gcore: true })
+        var usage = usages[pid] = {}
+        Object.keys(curr).forEach(key => {
+          usage[key] = curr[key] - prev[key]
+        })
+        var appId = this.pidAppIdMap[pid]
+        ;['utime', 'stime', 'runDelay', 'involuntarySwitches'].forEach(stat => {
+          appCpuHistogram.observe({ appId: appId, stat: stat }, usage[stat])
+        })
       })
-  )
+      this.cpuMemo = processes
+      resolve(usages)
+    })
+  })
+}
+
+/**
+ * An app is starved if its main thread waited on the run queue longer than
+ * it ran, i.e. it's runnable but not scheduled, rather than hung in a loop
+ * or blocked.
+ *
+ * @private
+ */
+function isStarved (usage) {
+  if (usage == null || !(usage.runDelay >= 0)) {
+    return false
+  }
+  return usage.runDelay > usage.run
 }
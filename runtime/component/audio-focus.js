@@ -1,5 +1,7 @@
 var _ = require('@yoda/util')._
 var assert = require('assert')
+var Flora = require('@yoda/flora')
+var AudioManager = require('@yoda/audio').AudioManager
 
 var endoscope = require('@yoda/endoscope')
 var focusShiftMetric = new endoscope.Counter(
@@ -8,6 +10,12 @@ var focusShiftMetric = new endoscope.Counter(
 )
 
 var FocusShiftChannel = 'yodaos.audio-focus.on-focus-shift'
+/**
+ * Persisted flora message of `[ hasTransientFocus, hasLastingFocus ]` for
+ * services out of the runtime, e.g. otad yields its download to interactive
+ * traffic.
+ */
+var FocusStateChannel = 'yodaos.audio-focus.state'
 
 var RequestType = {
   DEFAULT: 0b000,
@@ -16,6 +24,11 @@ var RequestType = {
   MAY_DUCK: 0b100
 }
 
+/**
+ * Streams ducked while a transient focus that may duck is held.
+ */
+var DuckingStreams = [ AudioManager.STREAM_AUDIO, AudioManager.STREAM_PLAYBACK ]
+
 var RequestStatus = {
   REQUEST_NOT_MATCH: -3,
   DELAYED: -2,
@@ -38,6 +51,7 @@ var RequestStatus = {
  * @property {number} mayDuck
  * @property {number} transient
  * @property {boolean} acceptsDelay
+ * @property {number} [stream] - the stream the requester plays on.
  */
 
 class AudioFocus {
@@ -48,6 +62,8 @@ class AudioFocus {
 
     this.transientRequest = null
     this.lastingRequest = null
+    this.publishedState = null
+    this.duckedStreams = []
   }
 
   init () {
@@ -70,11 +86,15 @@ class AudioFocus {
    */
   request (req) {
     var gain = req.gain || 0
+    var stream = req.stream
     req = Object.assign(_.pick(req, 'id', 'appId'), {
       transient: (gain & RequestType.TRANSIENT) > 0,
       exclusive: (gain & RequestType.EXCLUSIVE) > 0,
       mayDuck: (gain & RequestType.MAY_DUCK) > 0
     })
+    if (stream != null) {
+      req.stream = stream
+    }
     if (this.guardRequest(req)) {
       return RequestStatus.REQUEST_NOT_MATCH
     }
@@ -110,12 +130,14 @@ class AudioFocus {
       this.recoverLastingRequest()
       this.component.broadcast.dispatch(FocusShiftChannel, [ this.lastingRequest, req ])
       focusShiftMetric.inc(this.lastingRequest)
+      this.publishState()
       return
     }
     if (this.lastingRequest && this.lastingRequest.appId === appId && this.lastingRequest.id === id) {
       req = this.lastingRequest
       this.lastingRequest = null
       this.castRequest(req)
+      this.publishState()
     }
   }
 
@@ -141,6 +163,7 @@ class AudioFocus {
     if (transientRequest || lastingRequest) {
       this.component.broadcast.dispatch(FocusShiftChannel, [ null, transientRequest || lastingRequest ])
       focusShiftMetric.inc(null)
+      this.publishState()
     }
   }
 
@@ -192,6 +215,7 @@ class AudioFocus {
     this.descriptor.audioFocus.emitToApp(req.appId, 'gain', [ req.id ])
     this.component.broadcast.dispatch(FocusShiftChannel, [ req, prev ])
     focusShiftMetric.inc(req)
+    this.publishState()
   }
 
   /**
@@ -215,6 +239,48 @@ class AudioFocus {
     this.descriptor.audioFocus.emitToApp(req.appId, 'gain', [ req.id ])
     this.component.broadcast.dispatch(FocusShiftChannel, [ req, prev ])
     focusShiftMetric.inc(req)
+    this.publishState()
+  }
+
+  /**
+   * @private
+   */
+  publishState () {
+    this.updateDucking()
+    var state = [ this.transientRequest ? 1 : 0, this.lastingRequest ? 1 : 0 ]
+    if (this.publishedState && this.publishedState[0] === state[0] && this.publishedState[1] === state[1]) {
+      return
+    }
+    this.publishedState = state
+    this.component.flora.post(FocusStateChannel, state, Flora.MSGTYPE_PERSIST)
+  }
+
+  /**
+   * Ducks the media streams with native volume ramps while a transient focus
+   * that may duck is held over a lasting focus, and restores them once it's
+   * gone. The stream of the transient requester is never ducked.
+   *
+   * Apps losing the focus with `mayDuck` are expected to keep playing as is,
+   * lowering their own volumes in `onLoss` would stack on the ducking.
+   *
+   * @private
+   */
+  updateDucking () {
+    var streams = []
+    if (this.lastingRequest != null && _.get(this.transientRequest, 'mayDuck') === true) {
+      var requester = this.transientRequest.stream
+      streams = DuckingStreams.filter(it => it !== requester)
+    }
+    var prev = this.duckedStreams
+    var unducked = prev.filter(it => streams.indexOf(it) < 0)
+    var ducked = streams.filter(it => prev.indexOf(it) < 0)
+    this.duckedStreams = streams
+    if (unducked.length > 0) {
+      AudioManager.unduck({ streams: unducked })
+    }
+    if (ducked.length > 0) {
+      AudioManager.duck({ streams: ducked })
+    }
   }
 
   /**
@@ -235,12 +301,14 @@ class AudioFocus {
       this.recoverLastingRequest()
       this.component.broadcast.dispatch(FocusShiftChannel, [ this.lastingRequest, req ])
       focusShiftMetric.inc(this.lastingRequest)
+      this.publishState()
       return
     }
     if (this.lastingRequest && this.lastingRequest.appId === appId) {
       req = this.lastingRequest
       this.lastingRequest = null
       this.castRequest(req)
+      this.publishState()
     }
   }
 }
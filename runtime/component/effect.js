@@ -33,6 +33,7 @@ inherits(Light, EventEmitter)
  * @param {object} [data] user's data for light
  * @param {object} [option]
  * @param {boolean} [option.shouldResume] should resume this light
+ * @param {boolean} [option.overlay] composite this light over the one being rendered
  * @return {Promise}
  */
 Light.prototype.play = function (appId, uri, data, option) {
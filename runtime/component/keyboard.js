@@ -1,5 +1,6 @@
 var logger = require('logger')('keyboard')
 var _ = require('@yoda/util')._
+var latency = require('@yoda/input/latency')
 
 var config = require('../lib/config').getConfig('keyboard.json')
 
@@ -22,6 +23,11 @@ function KeyboardHandler (runtime) {
 
 KeyboardHandler.prototype.init = function init () {
   this.input = require('@yoda/input')(_.get(this.config, 'config', {}))
+  /**
+   * debounce, long press timing and preventSubsequent are resolved by the
+   * input handler once configured, events are marked as `resolved`.
+   */
+  this.input.configure(this.config)
   this.listen()
 }
 
@@ -145,16 +151,8 @@ KeyboardHandler.prototype.onKeydown = function onKeydown (event) {
     logger.info(`No handler registered for keydown '${event.keyCode}'.`)
     return
   }
-  var debounce = _.get(descriptor, 'debounce', this.debounce)
-  if (debounce) {
-    if (descriptor.guard) {
-      logger.info(`discarding event keydown ${event.keyCode}`)
-      return
-    }
-    descriptor.guard = true
-    setTimeout(() => {
-      descriptor.guard = false
-    }, debounce)
+  if (this.debounced(descriptor, event, `event keydown ${event.keyCode}`)) {
+    return
   }
   return this.execute(descriptor)
 }
@@ -186,27 +184,23 @@ KeyboardHandler.prototype.onKeyup = function onKeyup (event) {
     logger.info(`No handler registered for keyup '${event.keyCode}'.`)
     return
   }
-  var debounce = _.get(descriptor, 'debounce', this.debounce)
-  if (debounce) {
-    if (descriptor.guard) {
-      logger.info(`discarding event keyup ${event.keyCode}`)
-      return
-    }
-    descriptor.guard = true
-    setTimeout(() => {
-      descriptor.guard = false
-    }, debounce)
+  if (this.debounced(descriptor, event, `event keyup ${event.keyCode}`)) {
+    return
   }
   return this.execute(descriptor)
 }
 
 KeyboardHandler.prototype.onLongpress = function onLongpress (event) {
-  if (this.currentKeyCode !== event.keyCode) {
+  /** resolved long presses are raised for held keys only */
+  if (!event.resolved && this.currentKeyCode !== event.keyCode) {
     logger.info(`longpress: ${event.keyCode}, keyTime: ${event.keyTime}, skipped for not matched keyCode.`)
     return
   }
-  var timeDelta = event.keyTime - this.firstLongPressTime
-  timeDelta = Math.round(timeDelta / this.longpressWindow) * this.longpressWindow
+  var timeDelta = event.timeDelta
+  if (!event.resolved) {
+    timeDelta = event.keyTime - this.firstLongPressTime
+    timeDelta = Math.round(timeDelta / this.longpressWindow) * this.longpressWindow
+  }
   logger.info(`longpress: ${event.keyCode}, keyTime: ${event.keyTime}, timeDelta: ${timeDelta}`)
 
   if (this.preventSubsequent) {
@@ -236,7 +230,8 @@ KeyboardHandler.prototype.onLongpress = function onLongpress (event) {
     logger.info(`Time delta is not ready for key longpress '${event.keyCode}'.`)
     return
   }
-  if (descriptor.preventSubsequent) {
+  /** subsequent events of resolved long presses are never emitted */
+  if (descriptor.preventSubsequent && !event.resolved) {
     this.preventSubsequent = true
   }
   return this.execute(descriptor)
@@ -258,16 +253,8 @@ KeyboardHandler.prototype.onSlide = function onSlide (event) {
   if (descriptor == null) {
     descriptor = _.get(this.config, `${event.keyCode}.slide-${event.orientation}`)
   }
-  var debounce = _.get(descriptor, 'debounce', this.debounce)
-  if (debounce) {
-    if (descriptor.guard) {
-      logger.info(`discarding slide ${event.keyCode}`)
-      return
-    }
-    descriptor.guard = true
-    setTimeout(() => {
-      descriptor.guard = false
-    }, debounce)
+  if (this.debounced(descriptor, event, `slide ${event.keyCode}`)) {
+    return
   }
   return this.execute(descriptor)
 }
@@ -289,20 +276,35 @@ KeyboardHandler.prototype.onGesture = function onGesture (gesture, event) {
     }
     logger.info(`Using fallback handler for gesture(${gesture}) '${event.keyCode}'.`)
   }
-  var debounce = _.get(descriptor, 'debounce', this.debounce)
-  if (debounce) {
-    if (descriptor.guard) {
-      logger.info(`discarding gesture(${gesture}) ${event.keyCode}`)
-      return
-    }
-    descriptor.guard = true
-    setTimeout(() => {
-      descriptor.guard = false
-    }, debounce)
+  if (this.debounced(descriptor, event, `gesture(${gesture}) ${event.keyCode}`)) {
+    return
   }
   return this.execute(descriptor)
 }
 
+/**
+ * Debounces events not resolved by the input handler.
+ * @returns {boolean} true if the event shall be discarded
+ */
+KeyboardHandler.prototype.debounced = function debounced (descriptor, event, name) {
+  if (event.resolved) {
+    return false
+  }
+  var debounce = _.get(descriptor, 'debounce', this.debounce)
+  if (!debounce) {
+    return false
+  }
+  if (descriptor.guard) {
+    logger.info(`discarding ${name}`)
+    return true
+  }
+  descriptor.guard = true
+  setTimeout(() => {
+    descriptor.guard = false
+  }, debounce)
+  return false
+}
+
 KeyboardHandler.prototype.listenerWrap = function listenerWrap (eventName, fn, args) {
   var self = this
   return function (event) {
@@ -312,6 +314,7 @@ KeyboardHandler.prototype.listenerWrap = function listenerWrap (eventName, fn, a
         if (delegation) {
           return
         }
+        latency.observe('keyboard', eventName, event)
         try {
           fn.apply(self, (args || []).concat(Array.prototype.slice.call(fnArgs, 0)))
         } catch (err) {
@@ -1,10 +1,7 @@
-var childProcess = require('child_process')
-var promisify = require('util').promisify
+var system = require('@yoda/system')
 var logger = require('logger')('memory-sentinel')
 var config = require('../lib/config').getConfig('memory-sentinel.json')
 
-var execAsync = promisify(childProcess.exec)
-
 var MemoryWarningChannel = 'yodaos.memory-sentinel.low-memory-warning'
 
 class MemorySentinel {
@@ -20,6 +17,12 @@ class MemorySentinel {
     this.fatalDeviceLWM = -1
 
     this.memMemo = null
+    /** MemAvailable sampled along with memMemo */
+    this.availableMemo = null
+
+    this.patrolTimer = null
+    this.patrolling = null
+    this.pressureWatcher = null
 
     this.config = Object.assign({
       'enabled': true,
@@ -35,7 +38,17 @@ class MemorySentinel {
       'warningDeviceLowWaterMark': 0,
       'fatalDeviceLowWaterMark': 0,
 
-      'patrolInterval': 5000
+      'patrolInterval': 5000,
+
+      /**
+       * Patrols on memory pressure events in addition to the polls of
+       * `patrolInterval`, which are kept for the high water marks of apps as
+       * an app may grow without pressuring the device. Stall and window are
+       * in milliseconds.
+       */
+      'pressureWatch': true,
+      'pressureStall': 150,
+      'pressureWindow': 2000
     }, config)
   }
 
@@ -45,14 +58,44 @@ class MemorySentinel {
     }
     this.component.broadcast.registerBroadcastChannel(MemoryWarningChannel)
     this.loadDeviceInfo()
-    setInterval(() => {
-      this.loadAppMemInfo()
-        .then(() => this.compelHighWaterMark())
-        .then(() => this.compelFreeAvailableMemory())
-        .then(() => {
-          this.memMemo = null
-        })
-    }, this.config.patrolInterval)
+    if (this.config.pressureWatch) {
+      this.pressureWatcher = system.watchMemoryPressure({
+        stall: this.config.pressureStall,
+        window: this.config.pressureWindow
+      }, () => this.patrol())
+    }
+    if (this.pressureWatcher) {
+      logger.info(`watching memory pressure by ${this.pressureWatcher.source}`)
+    }
+    this.patrolTimer = setInterval(() => this.patrol(), this.config.patrolInterval)
+  }
+
+  deinit () {
+    clearInterval(this.patrolTimer)
+    if (this.pressureWatcher) {
+      this.pressureWatcher.close()
+      this.pressureWatcher = null
+    }
+  }
+
+  /**
+   * Patrol the memory of apps and the device, a patrol is skipped while the
+   * previous one is still in progress.
+   */
+  patrol () {
+    if (this.patrolling) {
+      return this.patrolling
+    }
+    this.patrolling = this.loadAppMemInfo()
+      .then(() => this.compelHighWaterMark())
+      .then(() => this.compelFreeAvailableMemory())
+      .catch(err => logger.error('unexpected error on patrolling', err.stack))
+      .then(() => {
+        this.memMemo = null
+        this.availableMemo = null
+        this.patrolling = null
+      })
+    return this.patrolling
   }
 
   /**
@@ -146,38 +189,57 @@ class MemorySentinel {
     }, null)
   }
 
+  /**
+   * Sample the meminfo and the processes in one native job.
+   * @param {number[]} pids
+   * @returns {Promise<module:@yoda/system~MemorySample>}
+   */
+  sampleMemory (pids) {
+    return new Promise((resolve, reject) => {
+      system.sampleMemory(pids, (err, sample) => {
+        if (err) {
+          return reject(err)
+        }
+        resolve(system.decodeMemorySample(sample))
+      })
+    })
+  }
+
   getProcessMemoryUsage (pid) {
-    return execAsync(`awk '/VmRSS:/{ rss = $2 } END { print rss }' /proc/${pid}/status`)
-      .then(stdout => Number(stdout))
+    return this.sampleMemory([ pid ])
+      .then(sample => {
+        var mem = sample.processes[pid]
+        if (mem == null) {
+          throw new Error(`No such process(${pid})`)
+        }
+        return mem.rss
+      })
   }
 
   getAvailableMemory () {
-    return execAsync(`awk '/MemAvailable:/{ mem = $2 } END { print mem }' /proc/meminfo`)
-      .then(stdout => Number(stdout))
+    if (this.availableMemo != null) {
+      return Promise.resolve(this.availableMemo)
+    }
+    return this.sampleMemory([])
+      .then(sample => sample.meminfo.available)
   }
 
   loadAppMemInfo () {
     this.memMemo = {}
     var pids = Object.keys(this.appScheduler.pidAppIdMap)
 
-    var step = (idx) => {
-      if (idx >= pids.length) {
-        return Promise.resolve()
-      }
-      var pid = pids[idx]
-      return this.getProcessMemoryUsage(pid)
-        .then(
-          mem => {
-            this.memMemo[pid] = mem
-          },
-          err => {
-            logger.warn(`unexpected error on load process(${pid}) memory info`, err.stack)
-          }
-        )
-        .then(() => step(idx + 1))
-    }
-
-    return step(0)
+    return this.sampleMemory(pids)
+      .then(
+        sample => {
+          Object.keys(sample.processes).forEach(pid => {
+            this.memMemo[pid] = sample.processes[pid].rss
+          })
+          this.availableMemo = sample.meminfo.available
+        },
+        err => {
+          logger.warn('unexpected error on sampling memory', err.stack)
+        }
+      )
   }
 
   loadDeviceInfo () {
@@ -193,13 +255,13 @@ class MemorySentinel {
     if (this.config.fatalDeviceLowWaterMark > 0) {
       this.fatalDeviceLWM = this.config.fatalDeviceLowWaterMark
     }
-    return new Promise(resolve => {
-      childProcess.exec(`awk '/MemTotal:/{ ttl = $2 } END { print ttl }' /proc/meminfo`, (err, stdout) => {
-        if (err) {
+    return this.sampleMemory([])
+      .then(sample => {
+        var memTotal = this.memTotal = sample.meminfo.total
+        if (!(memTotal > 0)) {
           logger.error('Unable to read /proc/meminfo.', new Error('Fatal Error'))
           return process.exit(1)
         }
-        var memTotal = this.memTotal = Number(stdout)
         if (!(isFinite(this.backgroundAppHWM) && this.backgroundAppHWM > 0)) {
           this.backgroundAppHWM = Math.floor(memTotal * this.config.backgroundAppHighWaterMarkRatio)
         }
@@ -212,9 +274,7 @@ class MemorySentinel {
         if (!(isFinite(this.fatalDeviceLWM) && this.fatalDeviceLWM > 0)) {
           this.fatalDeviceLWM = Math.floor(memTotal * this.config.fatalDeviceLowWaterMarkRatio)
         }
-        resolve()
       })
-    })
   }
 }
 
@@ -28,7 +28,8 @@ class AudioFocusDescriptor extends Descriptor {
     var req = {
       id: id,
       appId: appId,
-      gain: gain
+      gain: gain,
+      stream: _.get(options, 'stream')
     }
 
     return this.component.audioFocus.request(req)
@@ -66,6 +66,8 @@ EffectDescriptor.methods = {
    * @param {object} [options]
    * @param {number} [options.zIndex] number of layers to play. default minimum layer
    * @param {boolean} [options.shouldResume]
+   * @param {boolean} [options.overlay] - composite the effect over the one being
+   *   played rather than pre-empting it.
    * @returns {Promise<void>}
    */
   play: {
@@ -45,6 +45,7 @@ var MediaPlayer = require('@yoda/multimedia').MediaPlayer
 var Sounder = require('@yoda/multimedia').Sounder
 var property = require('@yoda/property')
 var light = require('@yoda/light')
+var program = require('@yoda/light/program')
 var logger = require('logger')('effects')
 var path = require('path')
 var EventEmitter = require('events')
@@ -86,71 +87,19 @@ class Common {
   static setAlphaFactor (alpha) {
     Common.alphaFactor = alpha
   }
-
-  /**
-   * save the pixel result
-   * @param {number} pos - index of led
-   * @param {number} r - color.r
-   * @param {number} g - color.g
-   * @param {number} b - color.b
-   * @param {number} a - color.a
-   */
-  static setPixel (pos, r, g, b, a) {
-    if (pos < Common.ledStatus.length - 1) {
-      Common.ledStatus[pos].setRGBA(r, g, b, a)
-    }
-  }
-
-  /**
-   * save the fill result
-   * @param {number} r - color.r
-   * @param {number} g - color.g
-   * @param {number} b - color.b
-   * @param {number} a - color.a
-   */
-  static setFill (r, g, b, a) {
-    for (var i = 0; i < Common.ledStatus.length; ++i) {
-      Common.ledStatus[i].setRGBA(r, g, b, a)
-    }
-  }
-
-  /**
-   * init the led config
-   * @param config
-   */
-  static initLedStatus (config) {
-    Common.ledStatus = []
-    for (var i = 0; i < config.leds; ++i) {
-      Common.ledStatus.push(new Color(0, 0, 0, 1))
-    }
-  }
 }
 Common.alphaFactor = 1
-Common.ledStatus = []
 
 /**
- * Color class for light
+ * Write a pixel to a compositor layer, the alpha factor is applied by the
+ * compositor.
  */
-class Color {
-  constructor (colorObj) {
-    if (typeof colorObj.r === 'number') {
-      this.setRGBA(colorObj.r, colorObj.g, colorObj.b, colorObj.a)
-    }
-  }
-
-  /**
-   * set rgba
-   * @param {number} r
-   * @param {number} g
-   * @param {number} b
-   * @param {number} a
-   */
-  setRGBA (r, g, b, a) {
-    this.r = r
-    this.g = g
-    this.b = b
-    this.a = a
-  }
+function setLayerPixel (layer, pos, r, g, b, a) {
+  var offset = pos * 4
+  layer[offset] = r
+  layer[offset + 1] = g
+  layer[offset + 2] = b
+  layer[offset + 3] = (typeof a === 'number' && a >= 0 && a <= 1) ? Math.round(a * 255) : 255
 }
 
 module.exports = LightRenderingContextManager
@@ -173,7 +122,6 @@ function LightRenderingContextManager () {
   this.id = 0
   this.ledsConfig = light.getProfile()
   this.context = new LightRenderingContext()
-  Common.initLedStatus(this.ledsConfig)
 }
 
 /**
@@ -198,9 +146,7 @@ LightRenderingContextManager.prototype.getContext = function getContext () {
 LightRenderingContextManager.prototype.setGlobalAlphaFactor = function (alphaFactor) {
   logger.info(`global alpha factor has been set ${alphaFactor}`)
   Common.setAlphaFactor(alphaFactor)
-  for (var i = 0; i < Common.ledStatus.length; ++i) {
-    this.context.pixel(i, Common.ledStatus[i].r, Common.ledStatus[i].g, Common.ledStatus[i].b, Common.ledStatus[i].a)
-  }
+  light.setCorrection({ alphaFactor: alphaFactor })
   this.context.render()
 }
 
@@ -213,6 +159,29 @@ LightRenderingContextManager.prototype.clearLight = function () {
   this.context.clear()
   this.context.render()
 }
+
+/**
+ * Show a compositor layer above the base layer of contexts.
+ * @memberof yodaRT.light.LightRenderingContextManager
+ * @method showLayer
+ * @param {number} layer
+ */
+LightRenderingContextManager.prototype.showLayer = function (layer) {
+  light.getLayer(layer).fill(0)
+  light.setLayerVisible(layer, true)
+}
+
+/**
+ * Clear and hide a compositor layer.
+ * @memberof yodaRT.light.LightRenderingContextManager
+ * @method hideLayer
+ * @param {number} layer
+ */
+LightRenderingContextManager.prototype.hideLayer = function (layer) {
+  light.getLayer(layer).fill(0)
+  light.setLayerVisible(layer, false)
+  light.compose()
+}
 /**
  * @memberof yodaRT.light
  * @class LightRenderingContext
@@ -224,6 +193,9 @@ function LightRenderingContext () {
   this._handleId = 0
   this._handle = {}
   this._soundPlayer = null
+  this._animations = {}
+  /** the compositor layer the context renders to */
+  this._layer = 0
   this.ledsConfig = light.getProfile()
 }
 
@@ -341,6 +313,9 @@ LightRenderingContext.prototype.stop = function () {
   for (var i in this._handle) {
     clearTimeout(this._handle[i])
   }
+  for (var id in this._animations) {
+    light.stopAnimation(Number(id))
+  }
   if (this._soundPlayer) {
     this._soundPlayer.stop()
     this._soundPlayer = null
@@ -358,7 +333,7 @@ LightRenderingContext.prototype.render = function () {
   if (this._getCurrentId() !== this._id) {
     return
   }
-  return light.write()
+  return light.compose()
 }
 
 /**
@@ -372,8 +347,8 @@ LightRenderingContext.prototype.clear = function () {
   if (this._getCurrentId() !== this._id) {
     return
   }
-  Common.setFill(0, 0, 0, 0)
-  return light.clear()
+  light.getLayer(this._layer).fill(0)
+  return light
 }
 
 /**
@@ -392,8 +367,10 @@ LightRenderingContext.prototype.pixel = function (pos, r, g, b, a) {
   if (this._getCurrentId() !== this._id) {
     return
   }
-  Common.setPixel(pos, r, g, b, a)
-  return light.pixel(pos, r, g, b, Common.ApplyAlphaFactor(a))
+  if (pos >= 0 && pos < this.ledsConfig.leds) {
+    setLayerPixel(light.getLayer(this._layer), pos, r, g, b, a)
+  }
+  return light
 }
 
 /**
@@ -411,8 +388,11 @@ LightRenderingContext.prototype.fill = function (r, g, b, a) {
   if (this._getCurrentId() !== this._id) {
     return
   }
-  Common.setFill(r, g, b, a)
-  return light.fill(r, g, b, Common.ApplyAlphaFactor(a))
+  var layer = light.getLayer(this._layer)
+  for (var i = 0; i < this.ledsConfig.leds; ++i) {
+    setLayerPixel(layer, i, r, g, b, a)
+  }
+  return light
 }
 
 /**
@@ -436,6 +416,32 @@ LightRenderingContext.prototype.requestAnimationFrame = function (cb, interval)
   }, interval)
 }
 
+/**
+ * Play a program on the native animator, frames are rendered into the layer
+ * of the context at the maximum fps of the light without involving the event
+ * loop. The global alpha factor is applied by the compositor.
+ *
+ * @method animate
+ * @instance
+ * @memberof yodaRT.light.LightRenderingContext
+ * @param {module:@yoda/light/program~Program} program - see `@yoda/light/program`
+ * for gradient, breathing and rotation programs.
+ * @return {Promise<boolean>} resolves with if the program has been completed
+ *         rather than stopped.
+ */
+LightRenderingContext.prototype.animate = function (program) {
+  if (this._getCurrentId() !== this._id) {
+    return Promise.resolve(false)
+  }
+  return new Promise((resolve, reject) => {
+    var id = light.animate(program, completed => {
+      delete this._animations[id]
+      resolve(completed)
+    }, null, this._layer)
+    this._animations[id] = true
+  })
+}
+
 /**
  * @callback yodaRT.light.LightRenderingContext~renderCallback
  * @param {number} r - the REG color.
@@ -446,6 +452,8 @@ LightRenderingContext.prototype.requestAnimationFrame = function (cb, interval)
 
 /**
  * Make a transition. the fourth parameter will be true in callback when transition end.
+ * Without `cb`, all the leds are transited by the native animator, otherwise
+ * frames are computed on the event loop as `cb` decides the pixels.
  *
  * @method transition
  * @instance
@@ -454,7 +462,7 @@ LightRenderingContext.prototype.requestAnimationFrame = function (cb, interval)
  * @param {yodaRT.light.Color} to - Specify the end color of the transition.
  * @param {number} duration - Specify the duration of the transition.
  * @param {number} fps - Specify the fps of the transition.
- * @param {yodaRT.light.LightRenderingContext~renderCallback} cb - a function to
+ * @param {yodaRT.light.LightRenderingContext~renderCallback} [cb] - a function to
  *        receive rgb color in transitions.
  * @return {Promise<null>} when the last is computed, resolve the promise.
  */
@@ -462,6 +470,9 @@ LightRenderingContext.prototype.transition = function (from, to, duration, fps,
   if (this._getCurrentId() !== this._id) {
     return Promise.resolve()
   }
+  if (typeof cb !== 'function') {
+    return this.animate(program.gradient(from, to, duration)).then(() => {})
+  }
   var self = this
   // transform fps to the number of frame
   fps = Math.ceil(duration * fps / 1000)
@@ -518,6 +529,8 @@ LightRenderingContext.prototype.transition = function (from, to, duration, fps,
 
 /**
  * Make a breathing effect. The fourth parameter will be true in callback when breathing end.
+ * Without `cb`, all the leds breathe by the native animator, otherwise frames
+ * are computed on the event loop as `cb` decides the pixels.
  * @method breathing
  * @instance
  * @memberof yodaRT.light.LightRenderingContext
@@ -526,7 +539,7 @@ LightRenderingContext.prototype.transition = function (from, to, duration, fps,
  * @param {number} b - Blue value of the breathing effect.
  * @param {number} duration - Specify the duration of the transition.
  * @param {number} fps - Specify the fps of the transition.
- * @param {yodaRT.light.LightRenderingContext~renderCallback} cb - a function to receive rgb
+ * @param {yodaRT.light.LightRenderingContext~renderCallback} [cb] - a function to receive rgb
  *        color in breathing.
  * @return {Promise<null>} when the last is computed, resolve the promise.
  */
@@ -534,6 +547,10 @@ LightRenderingContext.prototype.breathing = function (r, g, b, duration, fps, cb
   if (this._getCurrentId() !== this._id) {
     return Promise.resolve()
   }
+  if (typeof cb !== 'function') {
+    return this.animate(program.breathing({ r: r, g: g, b: b }, duration))
+      .then(() => {})
+  }
   var self = this
   // transform fps to the number of frame
   fps = Math.ceil(duration * fps / 1000 / 2)
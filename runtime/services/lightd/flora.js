@@ -2,8 +2,13 @@ var logger = require('logger')('light-flora')
 var inherits = require('util').inherits
 
 var FloraComp = require('@yoda/flora/comp')
+var pacing = require('@yoda/light/pacing')
 var floraConfig = require('../../lib/config').getConfig('flora-config.json')
 
+var endoscope = require('@yoda/endoscope')
+var FloraExporter = require('@yoda/endoscope/exporter/flora')
+endoscope.addExporter(new FloraExporter('yodaos.endoscope.export'))
+
 var SETPICKUPURI = '/opt/light/setPickup.js'
 
 module.exports = Flora
@@ -66,6 +71,18 @@ Flora.prototype.handlers = {
   }
 }
 
+Flora.prototype.remoteMethods = {
+  'yodaos.lightd.dump-pacing': function DumpPacing (reqMsg, res) {
+    var path = reqMsg[0]
+    try {
+      res.end(0, [ JSON.stringify(pacing.dump(path)) ])
+    } catch (err) {
+      logger.error('unexpected error on dumping pacing', err.stack)
+      res.end(500, [ err.message ])
+    }
+  }
+}
+
 /**
  * Initialize flora client.
  */
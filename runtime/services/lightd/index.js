@@ -11,6 +11,10 @@ var Sounder = require('@yoda/multimedia').Sounder
 
 var Service = require('./service')
 var Flora = require('./flora')
+var pacing = require('@yoda/light/pacing')
+
+/** interval of collecting the frame pacing into endoscope */
+var PACING_COLLECT_INTERVAL = 10 * 1000
 
 var dbusService = Dbus.registerService('session', 'com.service.light')
 var dbusObject = dbusService.createObject('/rokid/light')
@@ -34,6 +38,7 @@ if (property.get('player.lightd.holdcon', 'persist') !== '0') {
 var service = new Service()
 var flora = new Flora(service)
 flora.init()
+setInterval(() => pacing.collect(), PACING_COLLECT_INTERVAL)
 
 dbusApis.addMethod('play', {
   in: ['s', 's', 's', 's'],
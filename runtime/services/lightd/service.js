@@ -9,6 +9,14 @@ var helper = require('./helper')
 var LIGHT_SOURCE = '/opt/light/'
 var maxUserspaceLayers = 3
 var maxSystemspaceLayers = 100
+/**
+ * Overlays are composited above the light being rendered on layers of the
+ * native compositor: userspace ones on 1 to 3 by their z-index, systemspace
+ * ones on 4 to 7, the higher the priority the higher the layer.
+ */
+var userspaceOverlayLayer = 1
+var systemspaceOverlayLayer = 4
+var maxOverlayLayer = 7
 
 function Light () {
   this.manager = new LightRenderingContextManager()
@@ -33,6 +41,8 @@ function Light () {
   this.nextResumeTimer = null
   this.degree = 0
   this.uriHandlers = {}
+  /** layer -> { appId, uri, context, handle } */
+  this.overlays = {}
   this.init()
 }
 
@@ -102,6 +112,59 @@ Light.prototype.stopPrev = function (keepLastFrame) {
   logger.log(`stop currently light complete with keepLastFrame: [${keepLastFrame}]`)
 }
 
+/**
+ * Render a light over the one being rendered rather than pre-empting it, it
+ * replaces the overlay on the same layer.
+ */
+Light.prototype.loadOverlay = function (appId, uri, data, isSystemUri, zIndex, callback) {
+  var layer = isSystemUri
+    ? Math.max(systemspaceOverlayLayer, maxOverlayLayer - zIndex)
+    : Math.min(userspaceOverlayLayer + zIndex, systemspaceOverlayLayer - 1)
+  this.stopOverlay(layer)
+
+  var handle = this.uriHandlers[uri]
+  if (handle === undefined) {
+    handle = this.uriHandlers[uri] = require(uri)
+  }
+  var overlay = { appId: appId, uri: uri, context: this.manager.getContext(), handle: null }
+  var context = overlay.context
+  context._layer = layer
+  context._getCurrentId = () => {
+    return this.overlays[layer] === overlay ? context._id : -1
+  }
+  this.overlays[layer] = overlay
+  this.manager.showLayer(layer)
+  logger.log(`overlay ${uri} of ${appId} on layer ${layer}`)
+  overlay.handle = handle(context, data || {}, () => {
+    setTimeout(() => {
+      if (this.overlays[layer] === overlay) {
+        this.stopOverlay(layer)
+      }
+      callback && callback()
+    }, 0)
+  })
+  return true
+}
+
+Light.prototype.stopOverlay = function (layer) {
+  var overlay = this.overlays[layer]
+  if (overlay == null) {
+    return
+  }
+  delete this.overlays[layer]
+  try {
+    if (typeof overlay.handle === 'function') {
+      overlay.handle()
+    } else if (overlay.handle && typeof overlay.handle.stop === 'function') {
+      overlay.handle.stop()
+    }
+  } catch (error) {
+    logger.error(`try to call hook: stop overlay '${overlay.uri}' error. belong to '${overlay.appId}'`)
+  }
+  overlay.context.stop()
+  this.manager.hideLayer(layer)
+}
+
 Light.prototype.clearPrev = function () {
   this.prev = null
   this.prevZIndex = null
@@ -129,6 +192,9 @@ Light.prototype.loadfile = function (appId, uri, data, option, callback) {
       zIndex = zIndex < 0 ? 0 : zIndex
       logger.log(`The light of URI: [${uri}] is belong to userspace`)
     }
+    if (option.overlay === true) {
+      return this.loadOverlay(appId, uri, data, isSystemUri, zIndex, callback)
+    }
     // update layers by uri
     if (!option.shouldResume) {
       this.removeLayerByUri(uri)
@@ -405,6 +471,12 @@ Light.prototype.mockPlayer = function (context) {
  * @param {string} [uri] - stop given light resource, if not specified, stop all light bound to the app
  */
 Light.prototype.stopFile = function (appId, uri) {
+  Object.keys(this.overlays).forEach(layer => {
+    var overlay = this.overlays[layer]
+    if (overlay.appId === appId && (!uri || overlay.uri === uri)) {
+      this.stopOverlay(layer)
+    }
+  })
   var isFind = false
   // systemspace is always higher than userspace
   for (var j = 0; j < this.systemspaceZIndex.length; j++) {
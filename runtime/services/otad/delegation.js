@@ -13,6 +13,8 @@ class Delegation {
       checkIntegrity: null,
       notify: null
     }
+    /** bytes/s of the image download, 0 for unlimited */
+    this.rateLimit = 0
     argv = argv || []
     while (argv.length > 0) {
       var $1 = argv.shift()
@@ -32,6 +34,9 @@ class Delegation {
         case '--notify':
           this.programs.notify = argv.shift()
           break
+        case '--rate-limit':
+          this.rateLimit = Number(argv.shift()) || 0
+          break
       }
     }
   }
@@ -16,6 +16,7 @@ var wget = require('./wget')
 var compose = yodaUtil.compose
 var systemVersionProp = 'ro.build.version.release'
 var additionalAvailableSpaceConstraintKey = 'ota.constraint.additional_available_space_kb'
+var md5Pattern = /^[0-9a-f]{32}$/i
 
 /**
  * Calculate if there is available disk space left for pending image to be downloaded.
@@ -37,30 +38,34 @@ function checkDiskAvailability (imageSize, destPath, callback) {
     } else {
       downloadedSize = stat.size
     }
-    var diskUsage = system.diskUsage(constants.upgradeDir)
-    var left = diskUsage.available - imageSize + downloadedSize
-    var additionalAvailableSpaceConstraint = manifest.getDefaultValue(additionalAvailableSpaceConstraintKey) * 1024
-    if (isNaN(additionalAvailableSpaceConstraint)) {
-      additionalAvailableSpaceConstraint = 5 * 1024 * 1024
-    }
-    logger.info(`requesting additional available space ${additionalAvailableSpaceConstraint}kB, left after download ${left / 1024}kB`)
-    if (left < additionalAvailableSpaceConstraint) {
-      /**
-       * no space left for new image, try remove existed images
-       * TODO: monkey army, remove arbitrary low prioritized files
-       */
-      return fs.readdir(constants.upgradeDir, (_, files) => {
-        if (files && files.length) {
-          files = files.filter(it => path.extname(it) === '.img')
-          if (files.length) {
-            return common.cleanImages(() => checkDiskAvailability(imageSize, destPath, callback))
+    system.diskUsageAsync(constants.upgradeDir, function onDiskUsage (err, diskUsage) {
+      if (err) {
+        return callback(err)
+      }
+      var left = diskUsage.available - imageSize + downloadedSize
+      var additionalAvailableSpaceConstraint = manifest.getDefaultValue(additionalAvailableSpaceConstraintKey) * 1024
+      if (isNaN(additionalAvailableSpaceConstraint)) {
+        additionalAvailableSpaceConstraint = 5 * 1024 * 1024
+      }
+      logger.info(`requesting additional available space ${additionalAvailableSpaceConstraint}kB, left after download ${left / 1024}kB`)
+      if (left < additionalAvailableSpaceConstraint) {
+        /**
+         * no space left for new image, try remove existed images
+         * TODO: monkey army, remove arbitrary low prioritized files
+         */
+        return fs.readdir(constants.upgradeDir, (_, files) => {
+          if (files && files.length) {
+            files = files.filter(it => path.extname(it) === '.img')
+            if (files.length) {
+              return common.cleanImages(() => checkDiskAvailability(imageSize, destPath, callback))
+            }
           }
-        }
-        callback(new Error(
-          `Disk space not available for new ota image, expect ${imageSize} bytes, got ${diskUsage.available} bytes`))
-      })
-    }
-    callback(null, true)
+          callback(new Error(
+            `Disk space not available for new ota image, expect ${imageSize} bytes, got ${diskUsage.available} bytes`))
+        })
+      }
+      callback(null, true)
+    }) /** system.diskUsageAsync */
   }) /** fs.stat */
 }
 
@@ -88,8 +93,23 @@ function downloadImage (delegate, info, callback) {
       info.status = 'downloading'
       persistance.writeInfo(info, cb)
     },
-    cb => wget.download(info.imageUrl, dest, { noCheckCertificate: true, continue: true }, cb),
-    cb => {
+    cb => wget.download(info.imageUrl, dest, {
+      noCheckCertificate: true,
+      continue: true,
+      background: true,
+      rateLimit: delegate.rateLimit
+    }, cb),
+    (cb, result) => {
+      /**
+       * the native downloader hashes the image while streaming, which stands
+       * in for the integrity check unless a vendor program is configured, as
+       * it may check more than the md5, e.g. signatures.
+       */
+      var hasIntegrityProgram = delegate.programs != null && delegate.programs.checkIntegrity != null
+      if (!hasIntegrityProgram && result && result.md5 && md5Pattern.test(info.integrity)) {
+        logger.info(`ota image successfully downloaded with md5 ${result.md5}`)
+        return cb(null, result.md5 === info.integrity.toLowerCase())
+      }
       logger.info('ota image successfully downloaded, calculating hash')
       delegate.checkIntegrity(dest, info.integrity, cb)
     },
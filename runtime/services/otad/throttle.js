@@ -0,0 +1,119 @@
+var EventEmitter = require('events').EventEmitter
+var flora = require('@yoda/flora')
+var logger = require('logger')('otad/throttle')
+
+var AudioFocusStateChannel = 'yodaos.audio-focus.state'
+var HttpInteractiveChannel = 'yodaos.httpsession.interactive'
+var ThrottleStateChannel = 'yodaos.otad.throttle'
+
+/**
+ * A process may die with interactive requests in flight, treat its report as
+ * stale after the max request timeout.
+ */
+var HttpInteractiveTTL = 60 * 1000
+
+/**
+ * Watches the interactive traffic of the device, i.e. an audio focus is held
+ * or an interactive httpsession request is in flight in any process. Emits
+ * `change` with `(interactive)` on transitions.
+ *
+ * @private
+ */
+class InteractiveTraffic extends EventEmitter {
+  constructor (agent) {
+    super()
+    this.agent = agent
+    this.audioFocus = false
+    /** pid -> expiry of the in-flight interactive requests */
+    this.httpRequests = {}
+    this.interactive = false
+    this.timer = null
+
+    agent.subscribe(AudioFocusStateChannel, msg => {
+      this.audioFocus = msg[0] > 0 || msg[1] > 0
+      this.update()
+    })
+    agent.subscribe(HttpInteractiveChannel, msg => {
+      var pid = msg[0]
+      if (msg[1] > 0) {
+        this.httpRequests[pid] = Date.now() + HttpInteractiveTTL
+      } else {
+        delete this.httpRequests[pid]
+      }
+      this.update()
+    })
+  }
+
+  update () {
+    var now = Date.now()
+    Object.keys(this.httpRequests).forEach(pid => {
+      if (this.httpRequests[pid] <= now) {
+        logger.warn(`interactive requests of process(${pid}) expired`)
+        delete this.httpRequests[pid]
+      }
+    })
+    var pids = Object.keys(this.httpRequests)
+    clearTimeout(this.timer)
+    this.timer = null
+    if (pids.length > 0) {
+      var expiry = Math.min.apply(Math, pids.map(it => this.httpRequests[it]))
+      this.timer = setTimeout(() => this.update(), expiry - now)
+    }
+
+    var interactive = this.audioFocus || pids.length > 0
+    if (interactive === this.interactive) {
+      return
+    }
+    this.interactive = interactive
+    this.emit('change', interactive)
+  }
+
+  close () {
+    clearTimeout(this.timer)
+    this.agent.unsubscribe(AudioFocusStateChannel)
+    this.agent.unsubscribe(HttpInteractiveChannel)
+  }
+}
+
+/**
+ * Shapes a native download in background: the rate is capped by
+ * `options.rateLimit`, and the download yields to interactive traffic. The
+ * throttle state is published to `yodaos.otad.throttle` on transitions and
+ * on each `publish()`.
+ *
+ * @private
+ * @param {module:@yoda/ota/downloader~Download} task
+ * @param {object} options
+ * @param {number} [options.rateLimit]
+ */
+class BackgroundThrottle {
+  constructor (task, options) {
+    this.task = task
+    this.agent = new flora.Agent('unix:/var/run/flora.sock')
+    this.traffic = new InteractiveTraffic(this.agent)
+    this.traffic.on('change', interactive => {
+      logger.info(interactive ? 'yielding to interactive traffic' : 'interactive traffic settled')
+      task.setThrottle({ yielding: interactive })
+      this.publish()
+    })
+    task.setThrottle({ rateLimit: options.rateLimit || 0 })
+    this.agent.start()
+  }
+
+  publish () {
+    var state = this.task.getThrottle()
+    if (state == null) {
+      return
+    }
+    this.agent.post(ThrottleStateChannel, [ JSON.stringify(state) ], flora.MSGTYPE_PERSIST)
+    return state
+  }
+
+  close () {
+    this.traffic.close()
+    this.agent.close()
+  }
+}
+
+module.exports.InteractiveTraffic = InteractiveTraffic
+module.exports.BackgroundThrottle = BackgroundThrottle
@@ -2,17 +2,34 @@ var childProcess = require('child_process')
 var Url = require('url')
 var http = require('http')
 var https = require('https')
+var logger = require('logger')('otad/wget')
+
+var downloader
+var BackgroundThrottle
+try {
+  downloader = require('@yoda/ota/downloader')
+  BackgroundThrottle = require('./throttle').BackgroundThrottle
+} catch (err) {
+  logger.warn('native downloader not available, fallback to wget', err.message)
+}
 
 /**
  * @typedef DownloadOptions
  * @property {number} [timeout=15] timeout in seconds
  * @property {boolean} [noCheckCertificate]
  * @property {boolean} [continue]
+ * @property {number} [connections] parallel range connections of the native downloader
+ * @property {boolean} [background] shapes the native download in background,
+ * which yields to interactive traffic
+ * @property {number} [rateLimit] bytes/s of the native download in background
  */
 
 module.exports.download = download
 module.exports.fetchImageSize = fetchImageSize
 /**
+ * Downloads the image with the native downloader if available, which yields
+ * the md5 digest of the image computed while streaming as the result.
+ * Otherwise spawns `wget`, and the result is undefined.
  *
  * @private
  * @param {string} url
@@ -21,6 +38,37 @@ module.exports.fetchImageSize = fetchImageSize
  * @param {Function} callback
  */
 function download (url, dest, options, callback) {
+  if (downloader) {
+    var lastLogged = 0
+    var throttle = null
+    var task = downloader.download(url, dest, {
+      connections: options.connections,
+      timeout: options.timeout,
+      noCheckCertificate: options.noCheckCertificate
+    }, function onDone (err, result) {
+      if (throttle) {
+        throttle.close()
+      }
+      callback(err, result)
+    })
+    if (options.background) {
+      throttle = new BackgroundThrottle(task, { rateLimit: options.rateLimit })
+    }
+    task.on('progress', (downloaded, total) => {
+      var now = Date.now()
+      if (now - lastLogged >= 5000) {
+        lastLogged = now
+        var state = throttle && throttle.publish()
+        logger.info(`downloaded ${downloaded} of ${total} bytes`,
+          state ? `at ${state.rate || 'unlimited'} bytes/s${state.yielding ? ', yielding' : ''}` : '')
+      }
+    })
+    return
+  }
+  wgetDownload(url, dest, options, callback)
+}
+
+function wgetDownload (url, dest, options, callback) {
   var args = []
   if (options.noCheckCertificate) {
     args = args.concat('--no-check-certificate')
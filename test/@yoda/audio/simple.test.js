@@ -119,3 +119,50 @@ test('set audio to linear shape', (t) => {
   t.equal(AudioManager.setVolumeShaper(AudioManager.LINEAR_RAMP), true)
   t.end()
 })
+
+test('get all volumes', (t) => {
+  AudioManager.setVolume(AudioManager.STREAM_TTS, 30)
+  AudioManager.setMute(true)
+  var volumes = AudioManager.getAllVolumes()
+  t.ok(volumes instanceof Int32Array)
+  t.strictEqual(volumes.length, 2 + AudioManager.VOLUME_STREAMS.length)
+  t.strictEqual(volumes[0], 1)
+  var idx = AudioManager.VOLUME_STREAMS.indexOf(AudioManager.STREAM_TTS)
+  t.ok(idx >= 0)
+  t.ok(volumes[2 + idx] >= 0 && volumes[2 + idx] <= 100)
+  AudioManager.setMute(false)
+  t.strictEqual(AudioManager.getAllVolumes()[0], 0)
+  t.end()
+})
+
+test('set volume curve in bulk', (t) => {
+  t.doesNotThrow(() => AudioManager.setVolumeCurve(new Int32Array([ 0, 50, 100 ])))
+  t.doesNotThrow(() => AudioManager.setVolumeCurve([ 0, 10, 30, 60, 100 ]))
+  t.throws(() => AudioManager.setVolumeCurve([ 0 ]), RangeError)
+  t.throws(() => AudioManager.setVolumeCurve([ 0, 50, 40 ]), RangeError)
+  t.throws(() => AudioManager.setVolumeCurve([ 0, 0.5, 1 ]), RangeError)
+  t.throws(() => AudioManager.setVolumeCurve(new Float32Array([ 0, 1 ])), RangeError)
+  t.equal(AudioManager.setVolumeShaper(AudioManager.LINEAR_RAMP), true)
+  t.end()
+})
+
+test('set stream volume curve', (t) => {
+  AudioManager.setVolume(AudioManager.STREAM_TTS, 50)
+  AudioManager.setStreamVolumeCurve(AudioManager.STREAM_TTS, [ 0, 100 ])
+  var idx = AudioManager.VOLUME_STREAMS.indexOf(AudioManager.STREAM_TTS)
+  t.strictEqual(AudioManager.getAllVolumes()[2 + idx], 50)
+  t.throws(() => AudioManager.setStreamVolumeCurve(AudioManager.STREAM_TTS, [ 0, 101 ]), RangeError)
+  t.throws(() => AudioManager.setStreamVolumeCurve(-1, [ 0, 100 ]), TypeError)
+  AudioManager.setStreamVolumeCurve(AudioManager.STREAM_TTS, null)
+  t.end()
+})
+
+test('stream volume curve should map the volumes set afterwards', (t) => {
+  var idx = AudioManager.VOLUME_STREAMS.indexOf(AudioManager.STREAM_TTS)
+  AudioManager.setStreamVolumeCurve(AudioManager.STREAM_TTS, [ 0, 50 ])
+  AudioManager.setVolume(AudioManager.STREAM_TTS, 80)
+  t.strictEqual(AudioManager.getAllVolumes()[2 + idx], 80)
+  AudioManager.setStreamVolumeCurve(AudioManager.STREAM_TTS, null)
+  t.strictEqual(AudioManager.getAllVolumes()[2 + idx], 80)
+  t.end()
+})
@@ -16,3 +16,18 @@ test('should record histogram', t => {
   endoscope.removeExporter(exporter)
   t.end()
 })
+
+test('should observe histogram value', t => {
+  t.plan(3)
+  var exporter = bootstrap.exporter((it) => {
+    t.strictEqual(it.name, 'example_metric_histogram')
+    t.deepEqual(it.labels, { method: 'POST', url: '/path' })
+    t.strictEqual(it.value, 42)
+  })
+  endoscope.addExporter(exporter)
+  var metric = new endoscope.Histogram('example_metric_histogram', { labels: [ 'method', 'url' ] })
+  metric.observe({ method: 'POST', url: '/path', foo: 'bar' }, 42)
+  metric.observe({ method: 'POST', url: '/path' }, -1)
+  endoscope.removeExporter(exporter)
+  t.end()
+})
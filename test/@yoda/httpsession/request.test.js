@@ -1,6 +1,7 @@
 'use strict'
 
 var test = require('tape')
+var http = require('http')
 var httpsession = require('@yoda/httpsession')
 
 test('https post', (t) => {
@@ -43,3 +44,109 @@ test('https status code', (t) => {
     t.end()
   })
 })
+
+test('identical gets in flight share one transaction', (t) => {
+  var bodies = []
+  var onResponse = (error, resp) => {
+    t.equal(typeof error, 'undefined', 'the error should be undefined')
+    bodies.push(resp.body)
+    if (bodies.length === 2) {
+      t.equal(bodies[0], bodies[1], 'the uuid should be shared')
+      t.end()
+    }
+  }
+  var first = httpsession.request('https://httpbin.org/uuid', onResponse)
+  var second = httpsession.request('https://httpbin.org/uuid', onResponse)
+  t.notEqual(first, second, 'each request should get its own handle')
+  t.ok(first && second)
+})
+
+test('aborting one waiter keeps the shared transaction', (t) => {
+  var settled = 0
+  var done = () => {
+    if (++settled === 2) {
+      t.end()
+    }
+  }
+  var aborted = httpsession.request('https://httpbin.org/get?what=shared', (error) => {
+    t.equal(error.message.indexOf('canceled') >= 0, true, 'the aborted one should be canceled')
+    done()
+  })
+  httpsession.request('https://httpbin.org/get?what=shared', (error, resp) => {
+    t.equal(typeof error, 'undefined', 'the error should be undefined')
+    t.equal(resp.code, 200, 'the status code should be 200')
+    done()
+  })
+  httpsession.abort(aborted)
+})
+
+test('response carries timing', (t) => {
+  httpsession.request('https://httpbin.org/get?what=timing', { coalesce: false }, (error, resp) => {
+    t.equal(typeof error, 'undefined', 'the error should be undefined')
+    t.equal(typeof resp.timing.total, 'number', 'total should be a number')
+    t.equal(typeof resp.timing.dispatch, 'number', 'dispatch should be a number')
+    t.equal(resp.timing.coalesced, false, 'the request should not be coalesced')
+    t.end()
+  })
+})
+
+test('response carries the phases of the transaction', (t) => {
+  var port = 18182
+  var url = `http://127.0.0.1:${port}/`
+  var server = http.createServer((req, res) => res.end(req.url))
+  server.listen(port, '127.0.0.1', () => {
+    httpsession.request(url + 'first', { coalesce: false }, (error, resp) => {
+      t.equal(typeof error, 'undefined', 'the error should be undefined')
+      ;[ 'dns', 'connect', 'tls', 'firstByte', 'transfer' ].forEach(phase => {
+        t.ok(resp.timing[phase] >= 0, `${phase} should be a duration`)
+      })
+      t.equal(resp.timing.tls, 0, 'plain http should take no tls')
+      httpsession.request(url + 'second', { coalesce: false }, (error, resp) => {
+        t.equal(typeof error, 'undefined', 'the error should be undefined')
+        t.equal(resp.timing.reused, true, 'the connection should be reused')
+        t.equal(resp.timing.connect, 0, 'a reused connection should not connect')
+        server.close()
+        t.end()
+      })
+    })
+  })
+})
+
+test('requests are dispatched by priority when competing for a host slot', (t) => {
+  var port = 18181
+  var url = `http://127.0.0.1:${port}/`
+  var server = http.createServer((req, res) => {
+    setTimeout(() => res.end(req.url), 200)
+  })
+  server.listen(port, '127.0.0.1', () => {
+    var done = []
+    var normalQueue
+    httpsession.setLimits({ interactive: 8, normal: 4, background: 4, host: 1 })
+    httpsession.request(url + 'background-1', { priority: 'background', coalesce: false }, () => {
+      done.push('background-1')
+    })
+    httpsession.request(url + 'background-2', { priority: 'background', coalesce: false }, (error, resp) => {
+      t.equal(typeof error, 'undefined', 'the error should be undefined')
+      done.push('background-2')
+      t.deepEqual(done, [ 'background-1', 'normal', 'background-2' ], 'background-2 should wait for normal')
+      t.ok(resp.timing.queue > normalQueue, 'background-2 should be queued longer')
+      httpsession.setLimits({ interactive: 8, normal: 4, background: 1, host: 4 })
+      server.close()
+      t.end()
+    })
+    httpsession.request(url + 'normal', { priority: 'normal', coalesce: false }, (error, resp) => {
+      t.equal(typeof error, 'undefined', 'the error should be undefined')
+      t.deepEqual(done, [ 'background-1' ], 'normal should overtake the queued background-2')
+      normalQueue = resp.timing.queue
+      done.push('normal')
+    })
+    var stats = httpsession.stats()
+    t.equal(stats.background.running, 1, 'background-1 should hold the host slot')
+    t.equal(stats.background.pending, 1, 'background-2 should be queued')
+    t.equal(stats.normal.pending, 1, 'normal should be queued')
+
+    httpsession.request(url + 'interactive', { priority: 'interactive', coalesce: false }, () => {})
+    stats = httpsession.stats()
+    t.equal(stats.interactive.running, 1, 'interactive should not wait for the host slot')
+  })
+})
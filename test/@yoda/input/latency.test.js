@@ -0,0 +1,22 @@
+'use strict'
+
+var test = require('tape')
+var bootstrap = require('../endoscope/bootstrap')
+var endoscope = require('@yoda/endoscope')
+var latency = require('@yoda/input/latency')
+
+test('should observe latency since the monotonic event time', t => {
+  t.plan(3)
+  var exporter = bootstrap.exporter((it) => {
+    t.strictEqual(it.name, 'yodaos:input:key_latency')
+    t.deepEqual(it.labels, { stage: 'keyboard', event: 'keydown' })
+    t.strictEqual(it.value, 15)
+  })
+  endoscope.addExporter(exporter)
+  var now = latency.monotonicNow()
+  latency.observe('keyboard', 'keydown', { keyCode: 1, monotonicTime: now - 15 }, now)
+  /** events without monotonic time are skipped */
+  latency.observe('keyboard', 'keydown', { keyCode: 1 }, now)
+  endoscope.removeExporter(exporter)
+  t.end()
+})
@@ -0,0 +1,63 @@
+'use strict'
+
+var test = require('tape')
+var resolver = require('@yoda/input/resolver')
+
+var Events = resolver.Events
+
+function rulesOf (compiled) {
+  var rules = []
+  for (var i = 0; i < compiled.rules.length; i += 4) {
+    rules.push(compiled.rules.slice(i, i + 4))
+  }
+  return rules
+}
+
+test('should compile debounce of descriptors and fallbacks', t => {
+  var compiled = resolver.compile({
+    config: { debounce: 400, longpressWindow: 250 },
+    '113': {
+      click: { debounce: 1000 },
+      keyup: {}
+    },
+    '114': {
+      keydown: { debounce: 0 },
+      longpress: { repeat: true }
+    },
+    fallbacks: {
+      dbclick: {}
+    }
+  })
+  t.strictEqual(compiled.longpressWindow, 250)
+  t.deepEqual(rulesOf(compiled), [
+    [ 0, 113, Events.keyup, 400 ],
+    [ 0, 113, Events.click, 1000 ],
+    [ 0, -1, Events.dbclick, 400 ]
+  ])
+  t.end()
+})
+
+test('should compile prevent subsequent of long presses', t => {
+  var compiled = resolver.compile({
+    '113': {
+      'longpress-2000': { timeDelta: 2000, preventSubsequent: false },
+      'longpress-7000': { timeDelta: 7000, preventSubsequent: true },
+      /** never matched by the keyboard component */
+      'longpress-3000': { preventSubsequent: true }
+    },
+    '114': {
+      longpress: { repeat: true, timeDelta: 1000, preventSubsequent: true },
+      'longpress-500': { timeDelta: 500, preventSubsequent: true }
+    },
+    '115': {
+      longpress: { timeDelta: 500, preventSubsequent: true }
+    }
+  })
+  t.strictEqual(compiled.longpressWindow, 500)
+  t.deepEqual(rulesOf(compiled), [
+    [ 1, 113, Events.longpress, 7000 ],
+    [ 2, 114, Events.longpress, 1000 ],
+    [ 1, 115, Events.longpress, 500 ]
+  ])
+  t.end()
+})
@@ -0,0 +1,42 @@
+'use strict'
+
+var test = require('tape')
+var fs = require('fs')
+var os = require('os')
+var path = require('path')
+var trace = require('@yoda/input/trace')
+
+function keyEvents (count, interval) {
+  var entries = []
+  for (var i = 0; i < count; ++i) {
+    entries.push({ time: i * interval, event: [ 0, i % 2 === 0 ? 1 : 0, 0, 114, 0, 0, 0, 0, 0 ] })
+  }
+  return entries
+}
+
+test('should encode and decode trace', t => {
+  var entries = keyEvents(3, 1.5)
+  t.deepEqual(trace.decode(trace.encode(entries)), entries)
+  t.throws(() => trace.decode(Buffer.from('not a trace')), /malformed input trace/)
+  t.end()
+})
+
+test('should replay trace through batches and count drops', t => {
+  var tracePath = path.join(os.tmpdir(), `input-${Date.now()}.trace`)
+  fs.writeFileSync(tracePath, trace.encode(keyEvents(300, 0)))
+  var wrap = new trace.StandInWrap()
+  var delivered = 0
+  wrap.onevents = (batch, count, dropped, dispatchedAt) => {
+    t.ok(batch.length >= count * 9, 'batch should hold all events')
+    t.strictEqual(batch[3], 114)
+    delivered += count
+  }
+  wrap.onreplay = (injected, dropped) => {
+    t.strictEqual(injected, 256)
+    t.strictEqual(dropped, 44)
+    t.strictEqual(delivered, injected)
+    fs.unlinkSync(tracePath)
+    t.end()
+  }
+  t.strictEqual(wrap.replay(tracePath, 0), 0)
+})
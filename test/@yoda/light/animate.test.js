@@ -0,0 +1,37 @@
+'use strict'
+
+var test = require('tape')
+var light = require('@yoda/light')
+var program = require('@yoda/light/program')
+
+test('programs of different layers should play at once', t => {
+  t.plan(4)
+  var base = program.breathing({ r: 0, g: 0, b: 255 }, 300, 1)
+  var overlay = program.gradient({ r: 0, g: 0, b: 0 }, { r: 255, g: 0, b: 0 }, 200)
+  var startedAt = Date.now()
+  light.animate(base, completed => {
+    t.ok(completed, 'the base program should complete')
+    t.ok(Date.now() - startedAt >= 300)
+  }, null, 0)
+  light.animate(overlay, completed => {
+    t.ok(completed, 'the overlay should complete')
+    t.ok(Date.now() - startedAt >= 200)
+  }, null, 1)
+})
+
+test('a program should replace the one of its layer only', t => {
+  t.plan(3)
+  var ended = []
+  light.animate(program.breathing({ r: 0, g: 255, b: 0 }, 1000, 0), completed => {
+    ended.push('base')
+    t.notOk(completed, 'the base program should be stopped')
+  }, null, 0)
+  light.animate(program.breathing({ r: 255, g: 0, b: 0 }, 1000, 0), completed => {
+    ended.push('replaced')
+    t.notOk(completed, 'the replaced overlay should not complete')
+  }, null, 1)
+  light.animate(program.gradient({ r: 0, g: 0, b: 0 }, { r: 255, g: 255, b: 255 }, 200), () => {
+    t.deepEqual(ended, [ 'replaced' ])
+    light.stopAnimation(null, 0)
+  }, null, 1)
+})
@@ -0,0 +1,46 @@
+'use strict'
+
+var test = require('tape')
+var light = require('@yoda/light')
+
+test('frame should be shared with pixel and fill', t => {
+  var profile = light.getProfile()
+  var frame = light.frame
+  t.ok(frame instanceof Uint8Array)
+  t.strictEqual(frame.length, profile.leds * profile.format)
+
+  light.fill(10, 20, 30)
+  t.deepEqual(Array.from(frame.subarray(0, 3)), [ 10, 20, 30 ])
+  light.pixel(1, 255, 0, 0)
+  t.deepEqual(Array.from(frame.subarray(profile.format, profile.format + 3)), [ 255, 0, 0 ])
+  light.clear()
+  t.ok(frame.every(it => it === 0))
+  t.throws(() => light.pixel(profile.leds, 0, 0, 0), RangeError)
+  t.end()
+})
+
+test('frame written in place should be rendered', t => {
+  var frame = light.frame
+  for (var i = 0; i < frame.length; ++i) {
+    frame[i] = i % 3 === 1 ? 255 : 0
+  }
+  t.ok(light.write())
+  light.clear().write()
+  t.end()
+})
+
+test('unchanged frames should be skipped', t => {
+  light.fill(0, 0, 255).write()
+  var stats = light.getDrawStats()
+  light.write()
+  var next = light.getDrawStats()
+  t.strictEqual(next.submitted, stats.submitted)
+  t.strictEqual(next.skipped, stats.skipped + 1)
+
+  light.pixel(0, 255, 0, 0).write()
+  next = light.getDrawStats()
+  t.strictEqual(next.submitted, stats.submitted + 1)
+  t.strictEqual(next.dirtyLeds, stats.dirtyLeds + 1)
+  light.clear().write()
+  t.end()
+})
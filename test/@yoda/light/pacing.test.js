@@ -0,0 +1,30 @@
+'use strict'
+
+var test = require('tape')
+var light = require('@yoda/light')
+var pacing = require('@yoda/light/pacing')
+
+test('frames should be traced in order', t => {
+  light.fill(0, 255, 0).write()
+  light.write()
+  var entries = pacing.trace()
+  t.ok(entries.length >= 2)
+  var last = entries[entries.length - 1]
+  var prev = entries[entries.length - 2]
+  t.strictEqual(last.seq, prev.seq + 1)
+  t.ok(last.skipped)
+  t.notOk(prev.skipped)
+  t.ok(last.time >= prev.time)
+  t.ok(last.interval >= 0)
+  light.clear().write()
+  t.end()
+})
+
+test('dump should carry the stats', t => {
+  var result = pacing.dump()
+  t.strictEqual(typeof result.stats.late, 'number')
+  t.strictEqual(typeof result.stats.dropped, 'number')
+  t.ok(Array.isArray(result.trace))
+  pacing.collect()
+  t.end()
+})
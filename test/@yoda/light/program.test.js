@@ -0,0 +1,44 @@
+'use strict'
+
+var test = require('tape')
+var program = require('@yoda/light/program')
+
+var profile = { leds: 4, format: 3 }
+
+test('should pack color keyframes', t => {
+  var packed = program.pack(program.breathing({ r: 255, g: 128, b: 0, a: 0.5 }, 1000, 0), profile)
+  var frames = packed[0]
+  t.strictEqual(frames.length, 3 * 12)
+  t.deepEqual(packed.slice(1), [ [ 0, 500, 1000 ], 1000, 0, true, 0, 1 ])
+  t.deepEqual(Array.from(frames.subarray(0, 12)), new Array(12).fill(0))
+  t.deepEqual(Array.from(frames.subarray(12, 15)), [ 127, 64, 0 ])
+  t.deepEqual(Array.from(frames.subarray(21, 24)), [ 127, 64, 0 ])
+  t.end()
+})
+
+test('should pack rotation of a frame', t => {
+  var frame = new Uint8Array(12)
+  frame.set([ 255, 255, 255 ], 0)
+  var packed = program.pack(program.rotation(frame, profile.leds, 100, 2, true), profile)
+  t.deepEqual(Array.from(packed[0]), Array.from(frame))
+  t.deepEqual(packed.slice(1), [ [ 0 ], 400, 2, false, 100, -1 ])
+  t.end()
+})
+
+test('should apply alpha factor to colors', t => {
+  var packed = program.pack(program.gradient({ r: 100, g: 100, b: 100 }, { r: 200, g: 0, b: 0, a: 1 }, 300),
+    profile, alpha => (typeof alpha === 'number' ? alpha : 1) * 0.5)
+  t.deepEqual(Array.from(packed[0].subarray(0, 3)), [ 50, 50, 50 ])
+  t.deepEqual(Array.from(packed[0].subarray(12, 15)), [ 100, 0, 0 ])
+  t.end()
+})
+
+test('should reject malformed programs', t => {
+  t.throws(() => program.pack({ keyframes: [], duration: 100 }, profile), TypeError)
+  t.throws(() => program.pack({ keyframes: [ { at: 0, frame: new Uint8Array(3) } ], duration: 100 }, profile), TypeError)
+  t.throws(() => program.pack({
+    keyframes: [ { at: 100, frame: { r: 0, g: 0, b: 0 } }, { at: 0, frame: { r: 0, g: 0, b: 0 } } ],
+    duration: 100
+  }, profile), TypeError)
+  t.end()
+})
@@ -3,6 +3,7 @@
 var test = require('tape')
 var sys = require('@yoda/system')
 var logger = require('logger')('system-test')
+var mm = require('../../helper/mock')
 
 test('module->system: verifyOtaImage', t => {
   // TODO: function not implemented
@@ -111,3 +112,106 @@ test.skip('module->system: reboot', t => {
   t.ok(result)
   t.end()
 })
+
+test('module->system: sampleMemory', t => {
+  sys.sampleMemory([ process.pid, 65535 ], (err, sample) => {
+    t.error(err)
+    t.ok(sample instanceof Int32Array)
+    t.strictEqual(sample.length, sys.MEMINFO_FIELDS + 2 * sys.PROCESS_MEMORY_STRIDE)
+    var decoded = sys.decodeMemorySample(sample)
+    t.ok(decoded.meminfo.total > 0)
+    t.ok(decoded.meminfo.available > 0)
+    t.ok(decoded.processes[process.pid].rss > 0)
+    t.looseEqual(decoded.processes[65535], null)
+    t.end()
+  })
+})
+
+test('module->system: watchMemoryPressure', t => {
+  var watcher = sys.watchMemoryPressure({ stall: 150, window: 2000 }, () => {})
+  if (watcher == null) {
+    t.skip('neither PSI nor cgroup v2 memory.events is available')
+    return t.end()
+  }
+  t.ok(watcher.source === 'psi' || watcher.source === 'memory.events')
+  t.strictEqual(watcher.close(), true)
+  t.strictEqual(watcher.close(), false)
+  t.end()
+})
+
+test('module->system: mallocStats', t => {
+  var stats = sys.mallocStats()
+  t.ok(stats.arena > 0)
+  t.ok(stats.inUse > 0)
+  t.ok(stats.inUse <= stats.arena + stats.mmap)
+  t.ok(Array.isArray(stats.arenas))
+  t.ok(stats.arenas.length > 0)
+  t.strictEqual(stats.arenas[0].id, 0)
+  t.ok(stats.arenas[0].current > 0)
+  t.end()
+})
+
+test('module->system: reportMallocStats', t => {
+  var endoscope = require('@yoda/endoscope')
+  var stats = {}
+  var exporter = {
+    export: metric => {
+      if (metric.name === 'yodaos:system:malloc') {
+        stats[`${metric.labels.arena}:${metric.labels.stat}`] = metric.value
+      }
+    }
+  }
+  endoscope.addExporter(exporter)
+  var reporter = sys.reportMallocStats(1000, { name: 'test' })
+  reporter.report()
+  reporter.close()
+  endoscope.removeExporter(exporter)
+  t.ok(stats['all:inUse'] > 0)
+  t.ok(stats['0:current'] > 0)
+  t.end()
+})
+
+test('module->system: sampleCpu', t => {
+  sys.sampleCpu([ process.pid, 65535 ], (err, sample) => {
+    t.error(err)
+    t.ok(sample instanceof Float64Array)
+    t.strictEqual(sample.length, 2 * sys.CPU_SAMPLE_STRIDE)
+    var decoded = sys.decodeCpuSample(sample)
+    t.ok(decoded[process.pid].utime >= 0)
+    t.ok(decoded[process.pid].stime >= 0)
+    t.ok(decoded[process.pid].voluntarySwitches >= 0)
+    t.looseEqual(decoded[65535], null)
+    t.end()
+  })
+})
+
+test('module->system: queryDiskUsage', t => {
+  var paths = [ '/', '/aaa/dddd' ]
+  sys.queryDiskUsage(paths, (err, usage) => {
+    t.error(err)
+    t.ok(usage instanceof Float64Array)
+    t.strictEqual(usage.length, 2 * sys.DISK_USAGE_STRIDE)
+    var decoded = sys.decodeDiskUsage(usage, paths)
+    t.ok(decoded['/'].total > decoded['/'].free)
+    t.ok(decoded['/'].files > 0)
+    t.ok(decoded['/aaa/dddd'] instanceof Error)
+    t.end()
+  })
+})
+
+test('module->system: diskUsageAsync', t => {
+  sys.diskUsageAsync('/', { ttl: 60 * 1000 }, (err, usage) => {
+    t.error(err)
+    t.strictEqual(typeof usage.available, 'number')
+    mm.mockReturns(sys, 'queryDiskUsage', () => t.fail('unreachable path'))
+    sys.diskUsageAsync('/', { ttl: 60 * 1000 }, (err, cached) => {
+      mm.restore()
+      t.error(err)
+      t.deepEqual(cached, usage)
+      sys.diskUsageAsync('/aaa/dddd', err => {
+        t.ok(err instanceof Error)
+        t.end()
+      })
+    })
+  })
+})
@@ -123,3 +123,56 @@ test('should not suspend app by force if anr not enabled', t => {
       t.end()
     })
 })
+
+test('should not suspend app starved on cpu', t => {
+  var appId = '@test'
+  var tt = bootstrap()
+  mm.mockReturns(tt.runtime, 'appDidExit')
+  mm.mockReturns(tt.component.appLoader, 'getTypeOfApp', 'test')
+  mm.mockReturns(tt.component.appLoader, 'getAppManifest', {
+    appHome: 'foobar'
+  })
+  var scheduler = tt.component.appScheduler
+
+  var now = system.clockGetTime(system.CLOCK_MONOTONIC).sec
+  var runDelay = 0
+  mm.mockCallback(system, 'sampleCpu', (pids, callback) => {
+    var sample = new Float64Array(pids.length * system.CPU_SAMPLE_STRIDE)
+    pids.forEach((pid, idx) => {
+      sample.set([ pid, 100, 10, 110, runDelay, 10, 10 ], idx * system.CPU_SAMPLE_STRIDE)
+    })
+    callback(null, sample)
+  })
+  scheduler.createApp(appId)
+    .then(() => {
+      now += 1
+      mm.mockReturns(system, 'clockGetTime', { sec: now })
+      return scheduler.anrSentinel()
+    })
+    .then(() => {
+      now += 15
+      runDelay += 10 * 1000
+      mm.mockReturns(system, 'clockGetTime', { sec: now })
+      return scheduler.anrSentinel()
+    })
+    .then(() => {
+      t.notLooseEqual(scheduler.appMap[appId], null)
+      t.strictEqual(scheduler.appStatus[appId], 'running')
+
+      now += 60
+      runDelay += 10 * 1000
+      mm.mockReturns(system, 'clockGetTime', { sec: now })
+      return scheduler.anrSentinel()
+    })
+    .then(() => {
+      t.ok(scheduler.appMap[appId] == null)
+      t.strictEqual(scheduler.appStatus[appId], 'exited')
+      mm.restore()
+      t.end()
+    })
+    .catch(err => {
+      t.error(err)
+      mm.restore()
+      t.end()
+    })
+})
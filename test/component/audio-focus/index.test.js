@@ -531,3 +531,45 @@ test('identical focus re-requesting', t => {
   t.deepEqual(eventSeq, expected)
   t.end()
 })
+
+test('transient request that may duck should duck lasting request', t => {
+  var tt = bootstrap()
+  var comp = tt.component.audioFocus
+  var desc = tt.descriptor.audioFocus
+  var AudioManager = require('@yoda/audio').AudioManager
+  var seq = []
+  mm.mockReturns(desc, 'emitToApp', function () {})
+  mm.mockReturns(AudioManager, 'duck', () => seq.push('duck'))
+  mm.mockReturns(AudioManager, 'unduck', () => seq.push('unduck'))
+
+  comp.request({ id: 1, appId: 'test', gain: 0b000 /** default */ })
+  comp.request({ id: 2, appId: 'test', gain: 0b101 /** transient may duck */ })
+  t.deepEqual(seq, [ 'duck' ])
+  comp.request({ id: 3, appId: 'test', gain: 0b101 /** transient may duck */ })
+  t.deepEqual(seq, [ 'duck' ])
+  comp.abandon('test', 3)
+  t.deepEqual(seq, [ 'duck', 'unduck' ])
+  mm.restore()
+  t.end()
+})
+
+test('transient request that may duck should not duck its own stream', t => {
+  var tt = bootstrap()
+  var comp = tt.component.audioFocus
+  var desc = tt.descriptor.audioFocus
+  var AudioManager = require('@yoda/audio').AudioManager
+  var seq = []
+  mm.mockReturns(desc, 'emitToApp', function () {})
+  mm.mockReturns(AudioManager, 'duck', options => seq.push([ 'duck' ].concat(options.streams)))
+  mm.mockReturns(AudioManager, 'unduck', options => seq.push([ 'unduck' ].concat(options.streams)))
+
+  comp.request({ id: 1, appId: 'test', gain: 0b000 /** default */ })
+  comp.request({ id: 2, appId: 'test', gain: 0b101 /** transient may duck */, stream: AudioManager.STREAM_PLAYBACK })
+  t.deepEqual(seq, [ [ 'duck', AudioManager.STREAM_AUDIO ] ])
+  comp.request({ id: 3, appId: 'test', gain: 0b101 /** transient may duck */ })
+  t.deepEqual(seq[1], [ 'duck', AudioManager.STREAM_PLAYBACK ])
+  comp.abandon('test', 3)
+  t.deepEqual(seq[2], [ 'unduck', AudioManager.STREAM_AUDIO, AudioManager.STREAM_PLAYBACK ])
+  mm.restore()
+  t.end()
+})
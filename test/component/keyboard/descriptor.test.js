@@ -503,3 +503,64 @@ test('longpress: interrupted with a new key code', t => {
   /** 2. while previous key keyup during second key long pressing */
   keyboard.input.emit('longpress', { keyCode: 244, keyTime: 1000 })
 })
+
+test('longpress: resolved time delta', t => {
+  t.plan(2)
+  var tt = setUp()
+  var keyboard = tt.keyboard
+  var runtime = tt.runtime
+
+  keyboard.listen()
+
+  keyboard.config = {
+    '233': {
+      'longpress-2000': {
+        timeDelta: 2000,
+        preventSubsequent: true,
+        runtimeMethod: 'foobar'
+      },
+      keyup: {
+        runtimeMethod: 'keyup'
+      }
+    }
+  }
+
+  runtime.foobar = function () {
+    t.pass('invoked')
+  }
+  runtime.keyup = function () {
+    t.fail('keyup of a resolved long press shall not be prevented by keyboard')
+  }
+
+  /** keydown may have been debounced by the input handler */
+  keyboard.input.emit('longpress', { keyCode: 233, keyTime: 1999, timeDelta: 1500, resolved: true })
+  keyboard.input.emit('longpress', { keyCode: 233, keyTime: 2100, timeDelta: 2000, resolved: true })
+  setTimeout(() => {
+    t.strictEqual(keyboard.preventSubsequent, false)
+  }, 10)
+})
+
+test('shall not debounce resolved events', t => {
+  t.plan(2)
+  var tt = setUp()
+  var keyboard = tt.keyboard
+  var runtime = tt.runtime
+
+  keyboard.listen()
+
+  keyboard.config = {
+    '233': {
+      click: {
+        debounce: 1000,
+        runtimeMethod: 'foobar'
+      }
+    }
+  }
+
+  runtime.foobar = function () {
+    t.pass('invoked')
+  }
+
+  keyboard.input.emit('click', { keyCode: 233, resolved: true })
+  keyboard.input.emit('click', { keyCode: 233, resolved: true })
+})
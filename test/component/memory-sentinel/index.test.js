@@ -74,7 +74,7 @@ test('should fail on getting non-existence process memory usage', t => {
       t.ok(err != null)
       t.throws(() => {
         throw err
-      }, /^Error: Command failed/)
+      }, /^Error: No such process/)
       t.end()
     })
 })
@@ -71,3 +71,102 @@ test('throw error when enable upload without a valid authorization', (t) => {
     setGlobalUploadLevel(levels.error)
   }, 'missing cloudgw authorization')
 })
+
+test('flush and get stats', (t) => {
+  logger.info('foobar')
+  t.doesNotThrow(() => {
+    require('logger').flush()
+  })
+  var stats = require('logger').getStats()
+  t.strictEqual(typeof stats.written, 'number')
+  t.strictEqual(typeof stats.dropped, 'number')
+  t.strictEqual(stats.pending, 0)
+  t.end()
+})
+
+test('skip formatting if level disabled', (t) => {
+  var util = require('util')
+  var loggerModule = require('logger')
+  /**
+   * the levels are shared by all processes, their raw bytes are restored as
+   * 0 means not set and entries claimed are never released
+   */
+  var shared = null
+  try {
+    shared = new Uint8Array(require('logger/logger.node').getLevels())
+  } catch (e) {
+    /** not shared on host */
+  }
+  var saved = shared && shared.slice()
+  var format = util.format
+  var formatted = 0
+  util.format = function () {
+    ++formatted
+    return format.apply(util, arguments)
+  }
+  try {
+    loggerModule.setLevel('warn')
+    t.strictEqual(loggerModule.getLevel(), 'warn')
+    t.strictEqual(loggerModule.getLevel('log'), 'warn')
+    t.notOk(logger.isLevelEnabled('info'))
+    t.ok(logger.isLevelEnabled('error'))
+    logger.info('foo', 'bar', 'baz')
+    t.strictEqual(formatted, 0)
+    logger.warn('foo', 'bar', 'baz')
+    t.strictEqual(formatted, 1)
+
+    loggerModule.setLevel('verbose', 'log')
+    t.strictEqual(loggerModule.getLevel('log'), 'verbose')
+    logger.info('foo', 'bar', 'baz')
+    t.strictEqual(formatted, 2)
+    loggerModule.resetLevel('log')
+    t.strictEqual(loggerModule.getLevel('log'), 'warn')
+
+    loggerModule.setLevel('none')
+    logger.error('foo', 'bar', 'baz')
+    t.strictEqual(formatted, 2)
+
+    t.throws(() => {
+      loggerModule.setLevel(levels.error + 1)
+    }, /log level should between/)
+  } finally {
+    util.format = format
+    if (shared) {
+      shared.set(saved)
+    }
+  }
+  t.end()
+})
+
+test('levels of tags should be kept apart', (t) => {
+  var loggerModule = require('logger')
+  var shared = null
+  try {
+    shared = new Uint8Array(require('logger/logger.node').getLevels())
+  } catch (e) {
+    /** not shared on host */
+  }
+  var saved = shared && shared.slice()
+  var other = require('logger')('scheduler')
+  try {
+    loggerModule.setLevel('info')
+    loggerModule.setLevel('error', 'log')
+    t.strictEqual(loggerModule.getLevel('log'), 'error')
+    t.strictEqual(loggerModule.getLevel('scheduler'), 'info')
+    t.notOk(logger.isLevelEnabled('warn'))
+    t.ok(other.isLevelEnabled('warn'))
+
+    loggerModule.setLevel('verbose', 'scheduler')
+    t.ok(other.isLevelEnabled('verbose'))
+    t.strictEqual(loggerModule.getLevel('log'), 'error')
+
+    t.throws(() => {
+      loggerModule.setLevel('debug', new Array(64).join('x'))
+    }, RangeError)
+  } finally {
+    if (shared) {
+      shared.set(saved)
+    }
+  }
+  t.end()
+})
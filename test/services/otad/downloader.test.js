@@ -0,0 +1,133 @@
+var test = require('tape')
+var fs = require('fs')
+var os = require('os')
+var path = require('path')
+var crypto = require('crypto')
+
+var downloader = require('@yoda/ota/downloader')
+var createServer = require('./fixture/range-server')
+
+var content = Buffer.alloc(3 * 1024 * 1024 + 123)
+for (var i = 0; i < content.length; ++i) {
+  content[i] = (i * 7 + (i >> 10)) & 0xff
+}
+var expectedMd5 = crypto.createHash('md5').update(content).digest('hex')
+
+function serve (options, fn) {
+  var server = createServer(content, options)
+  server.listen(0, '127.0.0.1', () => {
+    var dest = path.join(os.tmpdir(), `downloader-${Date.now()}.img`)
+    fn(server, `http://127.0.0.1:${server.address().port}/image.img`, dest, () => {
+      server.close()
+      try { fs.unlinkSync(dest) } catch (_) {}
+      try { fs.unlinkSync(`${dest}.progress`) } catch (_) {}
+    })
+  })
+}
+
+test('should download image over parallel ranges and hash while streaming', t => {
+  serve({}, (server, url, dest, done) => {
+    var progress = 0
+    var task = downloader.download(url, dest, { connections: 4 }, (err, result) => {
+      t.error(err)
+      t.strictEqual(result.size, content.length)
+      t.strictEqual(result.md5, expectedMd5)
+      t.ok(fs.readFileSync(dest).equals(content), 'image should be identical')
+      t.notOk(fs.existsSync(`${dest}.progress`), 'checkpoint should be removed')
+      t.ok(progress > 0, 'progress should be emitted')
+      t.strictEqual(server.requests.filter(it => it !== 'bytes=0-0').length, 4)
+      done()
+      t.end()
+    })
+    task.on('progress', (downloaded, total) => {
+      progress++
+      t.strictEqual(total, content.length)
+    })
+  })
+})
+
+test('should download image from servers without range support', t => {
+  serve({ noRange: true }, (server, url, dest, done) => {
+    downloader.download(url, dest, { connections: 4 }, (err, result) => {
+      t.error(err)
+      t.strictEqual(result.md5, expectedMd5)
+      done()
+      t.end()
+    })
+  })
+})
+
+test('should resume ranges from checkpoint', t => {
+  serve({ dropAfter: 300 * 1024 }, (server, url, dest, done) => {
+    var options = { connections: 4, retries: 0, checkpointInterval: 64 * 1024 }
+    downloader.download(url, dest, options, (err) => {
+      t.ok(err, 'interrupted download should fail')
+      t.ok(fs.existsSync(`${dest}.progress`), 'checkpoint should be persisted')
+      server.requests = []
+      server.close()
+      serve({}, (server, url2, _, done2) => {
+        /** same path served by another host */
+        downloader.download(url2, dest, options, (err, result) => {
+          t.error(err)
+          t.strictEqual(result.md5, expectedMd5)
+          t.ok(server.requests.filter(it => it !== 'bytes=0-0').every(it => !/^bytes=(0|786462|1572924|2359386)-/.test(it)),
+            'ranges should not restart from their beginning')
+          done2()
+          done()
+          t.end()
+        })
+      })
+    })
+  })
+})
+
+test('should abort download', t => {
+  serve({ chunkDelay: 50 }, (server, url, dest, done) => {
+    var task = downloader.download(url, dest, {}, (err) => {
+      t.strictEqual(err.code, 'ECANCELED')
+      done()
+      t.end()
+    })
+    task.once('progress', () => task.abort())
+  })
+})
+
+test('should shape download with rate limit', t => {
+  serve({}, (server, url, dest, done) => {
+    var startedAt = Date.now()
+    var task = downloader.download(url, dest, { rateLimit: 1024 * 1024 }, (err, result) => {
+      t.error(err)
+      t.strictEqual(result.md5, expectedMd5)
+      t.ok(Date.now() - startedAt >= 2000, 'download should be shaped by the rate limit')
+      done()
+      t.end()
+    })
+    task.once('progress', () => {
+      var state = task.getThrottle()
+      t.strictEqual(state.rate, 1024 * 1024)
+      t.strictEqual(state.yielding, false)
+    })
+  })
+})
+
+test('should yield to interactive traffic', t => {
+  serve({}, (server, url, dest, done) => {
+    var startedAt = Date.now()
+    var task = downloader.download(url, dest, { yielding: true, yieldRate: 64 * 1024 }, (err, result) => {
+      t.error(err)
+      t.strictEqual(result.md5, expectedMd5)
+      t.ok(Date.now() - startedAt < 10000, 'download should resume the full rate')
+      done()
+      t.end()
+    })
+    setTimeout(() => {
+      var state = task.getThrottle()
+      t.strictEqual(state.rate, 64 * 1024)
+      t.strictEqual(state.yielding, true)
+      t.ok(state.throttled > 0, 'download should be throttled')
+      t.ok(state.downloaded < 256 * 1024, 'download should be slowed down')
+      task.setThrottle({ yielding: false })
+      t.strictEqual(task.getThrottle().rate, 0)
+    }, 1000)
+  })
+})
@@ -0,0 +1,58 @@
+'use strict'
+
+var http = require('http')
+
+/**
+ * A local http server serving `content` with byte range support.
+ *
+ * @param {Buffer} content
+ * @param {object} [options]
+ * @param {boolean} [options.noRange] - ignore range requests.
+ * @param {number} [options.dropAfter] - destroy each response after sending
+ * the bytes, to simulate interrupted connections.
+ * @param {number} [options.chunkSize=16384] - bytes of each write.
+ * @param {number} [options.chunkDelay=0] - milliseconds between writes.
+ */
+module.exports = function createServer (content, options) {
+  options = Object.assign({ chunkSize: 16 * 1024, chunkDelay: 0 }, options)
+  var server = http.createServer((req, res) => {
+    var start = 0
+    var end = content.length - 1
+    var range = /^bytes=(\d+)-(\d*)$/.exec(req.headers.range || '')
+    server.requests.push(req.headers.range || null)
+    if (range && !options.noRange) {
+      start = Number(range[1])
+      end = range[2] ? Math.min(Number(range[2]), end) : end
+      if (start > end) {
+        res.writeHead(416, { 'Content-Range': `bytes */${content.length}` })
+        return res.end()
+      }
+      res.writeHead(206, {
+        'Accept-Ranges': 'bytes',
+        'Content-Range': `bytes ${start}-${end}/${content.length}`,
+        'Content-Length': end - start + 1
+      })
+    } else {
+      res.writeHead(200, { 'Content-Length': content.length })
+    }
+
+    var offset = start
+    var sent = 0
+    function next () {
+      if (offset > end) {
+        return res.end()
+      }
+      if (options.dropAfter != null && sent >= options.dropAfter) {
+        return res.destroy()
+      }
+      var len = Math.min(options.chunkSize, end - offset + 1)
+      res.write(content.slice(offset, offset + len))
+      offset += len
+      sent += len
+      setTimeout(next, options.chunkDelay)
+    }
+    next()
+  })
+  server.requests = []
+  return server
+}
@@ -49,11 +49,11 @@ test('should throw if disk space not available', t => {
     t.fail('unreachable path')
   })
 
-  mock.mockReturns(system, 'diskUsage', (path) => {
+  mock.mockCallback(system, 'diskUsageAsync', (path, callback) => {
     t.ok(/\/data\/upgrade/.test(path), path)
-    return {
+    callback(null, {
       available: 100 /** 100 Bytes */
-    }
+    })
   })
   ota.runInCurrentContext(delegation, function onOTA (err, info) {
     t.throws(() => { throw err }, 'Disk space not available')
@@ -79,11 +79,11 @@ test('should skip fetching image size if ota info has it', t => {
     t.fail('unreachable path')
   })
 
-  mock.mockReturns(system, 'diskUsage', (path) => {
+  mock.mockCallback(system, 'diskUsageAsync', (path, callback) => {
     t.ok(/\/data\/upgrade/.test(path), path)
-    return {
+    callback(null, {
       available: 100 /** 100 Bytes */
-    }
+    })
   })
   ota.runInCurrentContext(delegation, function onOTA (err, info) {
     t.throws(() => { throw err }, 'Disk space not available')
@@ -110,3 +110,21 @@ test('should download image and validate checksum', t => {
     t.end()
   })
 })
+
+test('should delegate integrity check to vendor program even if md5 hashed', t => {
+  var delegation = new Delegation()
+  delegation.programs.checkIntegrity = '/usr/bin/check-integrity'
+  mock.mockCallback(delegation, 'checkIntegrity', null, true)
+  mock.mockCallback(wget, 'download', null, { md5: '00000000000000000000000000000000' })
+  ota.downloadImage(delegation, {
+    imageUrl: 'https://example.com',
+    version: 'foobar',
+    integrity: '99d7bdf3ecf03f3fd081d7b835c7347f'
+  }, function onDownload (err, result) {
+    t.error(err)
+    t.ok(result)
+
+    mock.restore()
+    t.end()
+  })
+})
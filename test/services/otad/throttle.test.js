@@ -0,0 +1,43 @@
+var test = require('tape')
+
+var helper = require('../../helper')
+var InteractiveTraffic = require(`${helper.paths.runtime}/services/otad/throttle`).InteractiveTraffic
+
+function createAgent () {
+  var handlers = {}
+  return {
+    handlers: handlers,
+    subscribe: (name, fn) => { handlers[name] = fn },
+    unsubscribe: (name) => { delete handlers[name] }
+  }
+}
+
+test('should be interactive while audio focus is held', t => {
+  var agent = createAgent()
+  var traffic = new InteractiveTraffic(agent)
+  var changes = []
+  traffic.on('change', it => changes.push(it))
+
+  agent.handlers['yodaos.audio-focus.state']([ 1, 0 ])
+  agent.handlers['yodaos.audio-focus.state']([ 0, 1 ])
+  agent.handlers['yodaos.audio-focus.state']([ 0, 0 ])
+  t.deepEqual(changes, [ true, false ])
+  traffic.close()
+  t.end()
+})
+
+test('should be interactive until all processes settled their requests', t => {
+  var agent = createAgent()
+  var traffic = new InteractiveTraffic(agent)
+  var changes = []
+  traffic.on('change', it => changes.push(it))
+
+  agent.handlers['yodaos.httpsession.interactive']([ 100, 1 ])
+  agent.handlers['yodaos.httpsession.interactive']([ 101, 2 ])
+  agent.handlers['yodaos.httpsession.interactive']([ 100, 0 ])
+  t.strictEqual(traffic.interactive, true)
+  agent.handlers['yodaos.httpsession.interactive']([ 101, 0 ])
+  t.deepEqual(changes, [ true, false ])
+  traffic.close()
+  t.end()
+})
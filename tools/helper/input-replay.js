@@ -0,0 +1,142 @@
+'use strict'
+
+/**
+ * Records, synthesizes and replays input event traces through the keyboard
+ * component, and reports the key latency and dropped events.
+ */
+
+var fs = require('fs')
+var path = require('path')
+var util = require('util')
+
+if (typeof util.formatValue !== 'function') {
+  /** ShadowNode only, used by logger */
+  util.formatValue = util.inspect
+}
+
+var argv = process.argv.slice(2)
+var command = argv.shift()
+var tracePath = argv.shift()
+var options = {
+  speed: 1,
+  duration: 10,
+  count: 1000,
+  interval: 1,
+  keyCode: 114
+}
+while (argv.length > 0) {
+  var key = argv.shift().replace(/^--/, '')
+  options[key] = Number(argv.shift())
+}
+
+var runtimeRoot = process.env.YODA_RUN_MODE === 'host'
+  ? path.join(__dirname, '../../runtime')
+  : '/usr/yoda'
+
+switch (command) {
+  case 'record':
+    record()
+    break
+  case 'synth':
+    synth()
+    break
+  case 'replay':
+    replay()
+    break
+  default:
+    console.error(`unknown command '${command}'`)
+    process.exit(1)
+}
+
+function record () {
+  var input = require('@yoda/input')()
+  input.record(tracePath)
+  console.log(`recording to ${tracePath} for ${options.duration}s`)
+  setTimeout(() => {
+    input.record(null)
+    input.disconnect()
+    process.exit(0)
+  }, options.duration * 1000)
+}
+
+/**
+ * Synthesizes a storm of keydown/keyup pairs, `interval` milliseconds apart.
+ */
+function synth () {
+  var trace = require('@yoda/input/trace')
+  var entries = []
+  for (var i = 0; i < options.count; ++i) {
+    var time = i * options.interval
+    var sec = Math.floor(time / 1000)
+    var usec = Math.round((time % 1000) * 1000)
+    /** [type, value, action, key_code, tv_sec, tv_usec, mono_sec, mono_usec, time_delta] */
+    entries.push({ time: time, event: [ 0, i % 2 === 0 ? 1 : 0, 0, options.keyCode, sec, usec, 0, 0, 0 ] })
+  }
+  fs.writeFileSync(tracePath, trace.encode(entries))
+  console.log(`synthesized ${entries.length} events to ${tracePath}`)
+}
+
+function replay () {
+  var endoscope = require('@yoda/endoscope')
+  var KeyboardHandler = require(path.join(runtimeRoot, 'component/keyboard'))
+
+  var stages = {}
+  endoscope.addExporter({
+    export: metric => {
+      if (metric.name !== 'yodaos:input:key_latency') {
+        return
+      }
+      var stage = metric.labels.stage
+      stages[stage] = stages[stage] || []
+      stages[stage].push(metric.value)
+    }
+  })
+
+  var handler = new KeyboardHandler(createRuntime())
+  handler.init()
+  var startedAt = Date.now()
+  handler.input.replay(tracePath, { speed: options.speed }, (err, result) => {
+    if (err) {
+      console.error(err.message)
+      process.exit(1)
+    }
+    /** waits for the delegated handlers */
+    setImmediate(() => {
+      console.log(`replayed in ${Date.now() - startedAt}ms, injected ${result.injected}, dropped ${result.dropped}`)
+      Object.keys(stages).forEach(stage => {
+        var values = stages[stage].sort((a, b) => a - b)
+        var pick = p => values[Math.min(values.length - 1, Math.floor(values.length * p))].toFixed(2)
+        console.log(`${stage}: count ${values.length}, p50 ${pick(0.5)}ms, p95 ${pick(0.95)}ms, p99 ${pick(0.99)}ms, max ${values[values.length - 1].toFixed(2)}ms`)
+      })
+      handler.deinit()
+      process.exit(0)
+    })
+  })
+}
+
+/**
+ * A runtime with no apps and noop runtime methods, so that only the keyboard
+ * pipeline is measured.
+ */
+function createRuntime () {
+  var noop = () => Promise.resolve()
+  var runtime = {
+    openUrl: noop,
+    component: {
+      dispatcher: { delegate: () => Promise.resolve(false) },
+      visibility: { getKeyAndVisibleAppId: () => undefined },
+      appScheduler: { getAppById: () => null }
+    },
+    descriptor: {}
+  }
+  var config = require(path.join(runtimeRoot, 'lib/config')).getConfig('keyboard.json')
+  Object.keys(config).forEach(keyCode => {
+    Object.keys(config[keyCode]).forEach(event => {
+      var method = config[keyCode][event].runtimeMethod
+      if (method) {
+        runtime[method] = noop
+      }
+    })
+  })
+  return runtime
+}